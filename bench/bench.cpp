@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+
+namespace
+{
+struct Benchmark
+{
+    std::string name;
+    svm::bench::bench_func_t func;
+    std::int64_t arg;
+};
+
+struct Result
+{
+    std::string name;
+    std::int64_t iterations;
+    double real_ns;
+    double cpu_ns;
+    double bytes_per_second;
+    double items_per_second;
+    std::string label;
+};
+
+struct Options
+{
+    std::string filter = ".*";
+    double min_time = 0.5;
+    bool json_stdout = false;
+    std::string out_path;
+};
+
+std::vector<Benchmark>& registry()
+{
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+bool parse_flag(const char* arg, const char* flag, std::string& value)
+{
+    const size_t len = std::strlen(flag);
+    if (std::strncmp(arg, flag, len) != 0 || arg[len] != '=')
+    {
+        return false;
+    }
+    value = arg + len + 1;
+    return true;
+}
+
+Options parse_options(int argc, char* argv[])
+{
+    Options opts;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string value;
+        if (parse_flag(argv[i], "--benchmark_filter", value))
+        {
+            opts.filter = value;
+        }
+        else if (parse_flag(argv[i], "--benchmark_min_time", value))
+        {
+            opts.min_time = std::stod(value);
+        }
+        else if (parse_flag(argv[i], "--benchmark_format", value))
+        {
+            opts.json_stdout = (value == "json");
+        }
+        else if (parse_flag(argv[i], "--benchmark_out", value))
+        {
+            opts.out_path = value;
+        }
+        else
+        {
+            throw std::runtime_error(std::string("unknown argument: ") + argv[i] + "\n"
+                "usage: svm_bench [--benchmark_filter=<regex>] [--benchmark_min_time=<seconds>]\n"
+                "                 [--benchmark_format=console|json] [--benchmark_out=<file.json>]");
+        }
+    }
+    return opts;
+}
+
+// Grows the iteration count until one run takes at least min_time, like Google Benchmark
+Result run(const Benchmark& bm, double min_time)
+{
+    std::int64_t iterations = 1;
+    while (true)
+    {
+        svm::bench::State state(iterations, bm.arg);
+        bm.func(state);
+
+        const double seconds = state.real_seconds();
+        if (seconds >= min_time || iterations >= 1000000000)
+        {
+            Result res;
+            res.name = bm.name;
+            res.iterations = state.iterations();
+            res.real_ns = seconds * 1e9 / res.iterations;
+            res.cpu_ns = state.cpu_seconds() * 1e9 / res.iterations;
+            res.bytes_per_second = seconds > 0 ? state.bytes_processed() / seconds : 0;
+            res.items_per_second = seconds > 0 ? state.items_processed() / seconds : 0;
+            res.label = state.label();
+            return res;
+        }
+
+        const double multiplier = (seconds <= min_time / 10) ? 10.0 : 1.4 * min_time / seconds;
+        iterations = std::max(iterations + 1, static_cast<std::int64_t>(iterations * multiplier));
+    }
+}
+
+std::string json_escape(const std::string& s)
+{
+    std::string res;
+    for (char c: s)
+    {
+        if (c == '"' || c == '\\')
+        {
+            res += '\\';
+        }
+        res += c;
+    }
+    return res;
+}
+
+void write_json(std::ostream& os, const std::vector<Result>& results, const char* executable)
+{
+    char date[64];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+
+    os << "{\n";
+    os << "  \"context\": {\n";
+    os << "    \"date\": \"" << date << "\",\n";
+    os << "    \"executable\": \"" << json_escape(executable) << "\",\n";
+    os << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+    os << "    \"library_build_type\": \"release\"\n";
+#else
+    os << "    \"library_build_type\": \"debug\"\n";
+#endif
+    os << "  },\n";
+    os << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result& r = results[i];
+        os << "    {\n";
+        os << "      \"name\": \"" << json_escape(r.name) << "\",\n";
+        os << "      \"run_name\": \"" << json_escape(r.name) << "\",\n";
+        os << "      \"run_type\": \"iteration\",\n";
+        os << "      \"iterations\": " << r.iterations << ",\n";
+        os << "      \"real_time\": " << r.real_ns << ",\n";
+        os << "      \"cpu_time\": " << r.cpu_ns << ",\n";
+        os << "      \"time_unit\": \"ns\"";
+        if (r.bytes_per_second > 0)
+        {
+            os << ",\n      \"bytes_per_second\": " << r.bytes_per_second;
+        }
+        if (r.items_per_second > 0)
+        {
+            os << ",\n      \"items_per_second\": " << r.items_per_second;
+        }
+        if (!r.label.empty())
+        {
+            os << ",\n      \"label\": \"" << json_escape(r.label) << "\"";
+        }
+        os << "\n    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n";
+    os << "}\n";
+}
+
+void print_console(const Result& r)
+{
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-48s %14.0f ns %14.0f ns %12lld",
+        r.name.c_str(), r.real_ns, r.cpu_ns, static_cast<long long>(r.iterations));
+    std::cout << line;
+    if (r.bytes_per_second > 0)
+    {
+        std::cout << "  " << r.bytes_per_second / (1024.0 * 1024.0) << " MiB/s";
+    }
+    if (r.items_per_second > 0)
+    {
+        std::cout << "  " << r.items_per_second << " items/s";
+    }
+    if (!r.label.empty())
+    {
+        std::cout << "  " << r.label;
+    }
+    std::cout << std::endl;
+}
+} // anonymous namespace
+
+namespace svm
+{
+namespace bench
+{
+State::State(std::int64_t max_iterations, std::int64_t arg)
+    : m_max_iterations(max_iterations)
+    , m_iterations(0)
+    , m_arg(arg)
+    , m_bytes(0)
+    , m_items(0)
+    , m_label()
+    , m_running(false)
+    , m_real_start()
+    , m_cpu_start()
+    , m_real_seconds(0)
+    , m_cpu_seconds(0)
+{}
+
+bool State::keep_running()
+{
+    if (m_iterations == 0 && !m_running)
+    {
+        start_timer();
+    }
+    if (m_iterations < m_max_iterations)
+    {
+        ++m_iterations;
+        return true;
+    }
+    stop_timer();
+    return false;
+}
+
+void State::pause_timing()
+{
+    stop_timer();
+}
+
+void State::resume_timing()
+{
+    start_timer();
+}
+
+std::int64_t State::arg() const
+{
+    return m_arg;
+}
+
+std::int64_t State::iterations() const
+{
+    return m_iterations;
+}
+
+void State::set_bytes_processed(std::int64_t bytes)
+{
+    m_bytes = bytes;
+}
+
+void State::set_items_processed(std::int64_t items)
+{
+    m_items = items;
+}
+
+void State::set_label(const std::string& label)
+{
+    m_label = label;
+}
+
+double State::real_seconds() const
+{
+    return m_real_seconds;
+}
+
+double State::cpu_seconds() const
+{
+    return m_cpu_seconds;
+}
+
+std::int64_t State::bytes_processed() const
+{
+    return m_bytes;
+}
+
+std::int64_t State::items_processed() const
+{
+    return m_items;
+}
+
+const std::string& State::label() const
+{
+    return m_label;
+}
+
+void State::start_timer()
+{
+    m_running = true;
+    m_real_start = clock::now();
+    m_cpu_start = std::clock();
+}
+
+void State::stop_timer()
+{
+    if (!m_running)
+    {
+        return;
+    }
+    m_running = false;
+    m_real_seconds += std::chrono::duration<double>(clock::now() - m_real_start).count();
+    m_cpu_seconds += static_cast<double>(std::clock() - m_cpu_start) / CLOCKS_PER_SEC;
+}
+
+int register_benchmark(const char* name, bench_func_t func, std::initializer_list<std::int64_t> args)
+{
+    if (args.size() == 0)
+    {
+        registry().push_back({ name, func, 0 });
+    }
+    for (std::int64_t arg: args)
+    {
+        registry().push_back({ std::string(name) + "/" + std::to_string(arg), func, arg });
+    }
+    return 0;
+}
+
+const std::shared_ptr<window::Window>& gl_window()
+{
+    static std::shared_ptr<window::Window> window(new window::Window(64, 64, "svm_bench",
+        window::backend_from_env(window::ContextBackend::hidden_window)));
+    return window;
+}
+} // namespace bench
+} // namespace svm
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        const Options opts = parse_options(argc, argv);
+        const std::regex filter(opts.filter);
+
+        std::vector<Result> results;
+        if (!opts.json_stdout)
+        {
+            std::cout << "Benchmark                                                  Time"
+                "             CPU   Iterations" << std::endl;
+        }
+        for (const Benchmark& bm: registry())
+        {
+            if (!std::regex_search(bm.name, filter))
+            {
+                continue;
+            }
+            results.push_back(run(bm, opts.min_time));
+            if (!opts.json_stdout)
+            {
+                print_console(results.back());
+            }
+        }
+
+        if (opts.json_stdout)
+        {
+            write_json(std::cout, results, argv[0]);
+        }
+        if (!opts.out_path.empty())
+        {
+            std::ofstream out(opts.out_path);
+            write_json(out, results, argv[0]);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+
+#include "window.h"
+
+namespace svm
+{
+namespace bench
+{
+// Per-run state handed to a benchmark body, modeled on Google Benchmark's so results can be
+// compared with its tooling:
+//
+//     void bm_foo(State& state)
+//     {
+//         while (state.keep_running()) { ... }
+//     }
+class State
+{
+public:
+    State(std::int64_t max_iterations, std::int64_t arg);
+
+    bool keep_running();
+
+    // Excludes setup work inside the loop from the measurement
+    void pause_timing();
+    void resume_timing();
+
+    std::int64_t arg() const;
+    std::int64_t iterations() const;
+
+    void set_bytes_processed(std::int64_t bytes);
+    void set_items_processed(std::int64_t items);
+    void set_label(const std::string& label);
+
+    double real_seconds() const;
+    double cpu_seconds() const;
+    std::int64_t bytes_processed() const;
+    std::int64_t items_processed() const;
+    const std::string& label() const;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    void start_timer();
+    void stop_timer();
+
+    std::int64_t m_max_iterations;
+    std::int64_t m_iterations;
+    std::int64_t m_arg;
+    std::int64_t m_bytes;
+    std::int64_t m_items;
+    std::string m_label;
+    bool m_running;
+    clock::time_point m_real_start;
+    std::clock_t m_cpu_start;
+    double m_real_seconds;
+    double m_cpu_seconds;
+};
+
+using bench_func_t = std::function<void(State&)>;
+
+// Registers `func` once per entry in `args` (or once without an argument), named
+// "name/arg" like Google Benchmark does
+int register_benchmark(const char* name, bench_func_t func, std::initializer_list<std::int64_t> args = {});
+
+// Shared hidden window so benchmarks that touch GL have a current context. Set SVM_GL_BACKEND to
+// run on a headless context instead.
+const std::shared_ptr<window::Window>& gl_window();
+
+template <class T>
+inline void do_not_optimize(const T& value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+} // namespace bench
+} // namespace svm
+
+#define SVM_BENCH_CONCAT_(a, b) a##b
+#define SVM_BENCH_CONCAT(a, b) SVM_BENCH_CONCAT_(a, b)
+
+#define SVM_BENCHMARK(func, ...) \
+    static const int SVM_BENCH_CONCAT(svm_bench_reg_, __LINE__) = \
+        ::svm::bench::register_benchmark(#func, func, { __VA_ARGS__ })
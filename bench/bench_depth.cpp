@@ -0,0 +1,39 @@
+#include <cstdint>
+#include <vector>
+
+#include "bench.h"
+#include "depth_map.h"
+
+using namespace svm;
+using svm::bench::State;
+
+namespace
+{
+// Image heights at 3:2; 8660 rows is about 50 MP
+#define DEPTH_HEIGHTS 2000, 4000, 8660
+
+depth::BoxModel bench_box()
+{
+    depth::BoxModel box;
+    box.top_left = glm::vec2(0.3f, 0.7f);
+    box.bot_right = glm::vec2(0.7f, 0.3f);
+    box.aspect = 1.5f;
+    box.camera = glm::vec3(14.0f, 9.0f, 40.0f);
+    return box;
+}
+
+// The depth map alone; each iteration fills width x height floats
+void bm_depth_map(State& state)
+{
+    const int height = static_cast<int>(state.arg());
+    const int width = height * 3 / 2;
+    const depth::DepthMapper mapper(bench_box(), width, height);
+    std::vector<float> depth(static_cast<std::size_t>(width) * height);
+    while (state.keep_running())
+    {
+        mapper.compute(depth.data());
+    }
+    state.set_items_processed(state.iterations() * static_cast<std::int64_t>(depth.size()));
+}
+SVM_BENCHMARK(bm_depth_map, DEPTH_HEIGHTS);
+} // anonymous namespace
@@ -0,0 +1,74 @@
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "bench.h"
+#include "edge_snap.h"
+#include "image.h"
+
+using namespace svm;
+using svm::bench::State;
+
+namespace
+{
+constexpr const int WIDTH = 1280;
+constexpr const int HEIGHT = 960;
+
+// A photo-sized image with a grid of soft-edged rooms and some noise, so there are plenty of
+// segments in every bucket a query touches
+const image::Image& test_image()
+{
+    static image::Image img;
+    if (!img.pixels)
+    {
+        img.width = WIDTH;
+        img.height = HEIGHT;
+        img.num_channels = 3;
+        img.pixels = std::shared_ptr<unsigned char>(new unsigned char[WIDTH * HEIGHT * 3],
+            std::default_delete<unsigned char[]>());
+        std::uint32_t noise = 12345;
+        for (int y = 0; y < HEIGHT; ++y)
+        {
+            for (int x = 0; x < WIDTH; ++x)
+            {
+                noise = noise * 1664525u + 1013904223u;
+                const bool wall = ((x / 80) + (y / 60)) % 2 == 0;
+                const unsigned char v = static_cast<unsigned char>((wall ? 170 : 60) + (noise >> 28));
+                unsigned char* px = img.pixels.get() + 3 * (y * WIDTH + x);
+                px[0] = px[1] = px[2] = v;
+            }
+        }
+    }
+    return img;
+}
+
+void bm_edge_index_build(State& state)
+{
+    const image::Image& img = test_image();
+    std::size_t segments = 0;
+    while (state.keep_running())
+    {
+        std::shared_ptr<const edges::EdgeIndex> index = edges::EdgeIndex::build(img, 0);
+        segments = index->num_segments();
+    }
+    state.set_bytes_processed(state.iterations() * static_cast<std::int64_t>(WIDTH) * HEIGHT);
+    state.set_label(std::to_string(segments) + " segments");
+}
+SVM_BENCHMARK(bm_edge_index_build);
+
+// One snap per cursor event while dragging a rear wall edge; this has to stay in microseconds
+void bm_edge_snap_query(State& state)
+{
+    std::shared_ptr<const edges::EdgeIndex> index = edges::EdgeIndex::build(test_image(), 0);
+    float y = 100.0f;
+    float snapped = 0;
+    while (state.keep_running())
+    {
+        bench::do_not_optimize(index->snap_horizontal(y, 200.0f, 1000.0f, 16.0f, snapped));
+        bench::do_not_optimize(snapped);
+        y = (y > HEIGHT - 100.0f) ? 100.0f : y + 7.0f;
+    }
+    state.set_items_processed(state.iterations());
+}
+SVM_BENCHMARK(bm_edge_snap_query);
+} // anonymous namespace
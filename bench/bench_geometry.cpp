@@ -0,0 +1,154 @@
+#include <memory>
+#include <vector>
+
+#include "background.h"
+#include "bench.h"
+#include "camera.h"
+#include "texture.h"
+
+using namespace svm;
+using svm::bench::State;
+
+namespace svm
+{
+namespace bench
+{
+// Background's friend, so the geometry steps can be timed without making them public
+struct BackgroundGeometry
+{
+    static void calculate_tex_2d(background::Background& bg, vertex::vertex3_element tex_uv[12],
+        const glm::vec2& top_left, const glm::vec2& bot_right, const glm::vec2& vanishing)
+    {
+        bg.calculate_tex_2d(top_left, bot_right, vanishing, tex_uv);
+    }
+
+    static void calculate_box_3d(background::Background& bg, vertex::vertex3_element box_coords[12],
+        const glm::vec2& top_left, const glm::vec2& bot_right, const glm::vec2& vanishing, float fovy)
+    {
+        bg.calculate_box_3d(top_left, bot_right, vanishing, fovy, box_coords);
+    }
+};
+} // namespace bench
+} // namespace svm
+
+namespace
+{
+const glm::vec2 TOP_LEFT(0.3f, 0.7f);
+const glm::vec2 BOT_RIGHT(0.7f, 0.35f);
+const glm::vec2 VANISHING(0.52f, 0.48f);
+constexpr float FOVY = 54.0f;
+
+// calculate_box_3d only needs the texture's dimensions, so a tiny one will do
+std::shared_ptr<texture::Texture2D> placeholder_texture()
+{
+    bench::gl_window();
+    static const unsigned char pixels[4 * 3] = {};
+    static std::shared_ptr<texture::Texture2D> tex(texture::Texture2D::from_pixels(pixels, 2, 2, 3));
+    return tex;
+}
+
+void bm_calculate_tex_2d(State& state)
+{
+    background::Background bg(placeholder_texture());
+    vertex::vertex3_element verts[12];
+    while (state.keep_running())
+    {
+        bench::BackgroundGeometry::calculate_tex_2d(bg, verts, TOP_LEFT, BOT_RIGHT, VANISHING);
+        bench::do_not_optimize(verts);
+    }
+    state.set_items_processed(state.iterations());
+}
+SVM_BENCHMARK(bm_calculate_tex_2d);
+
+void bm_calculate_box_3d(State& state)
+{
+    background::Background bg(placeholder_texture());
+    vertex::vertex3_element verts[12];
+    while (state.keep_running())
+    {
+        bench::BackgroundGeometry::calculate_box_3d(bg, verts, TOP_LEFT, BOT_RIGHT, VANISHING, FOVY);
+        bench::do_not_optimize(verts);
+    }
+    state.set_items_processed(state.iterations());
+}
+SVM_BENCHMARK(bm_calculate_box_3d);
+
+void bm_set_user_params(State& state)
+{
+    background::Background bg(placeholder_texture());
+    while (state.keep_running())
+    {
+        bg.set_user_params(TOP_LEFT, BOT_RIGHT, VANISHING, FOVY);
+    }
+    state.set_items_processed(state.iterations());
+}
+SVM_BENCHMARK(bm_set_user_params);
+
+void bm_camera_direction(State& state)
+{
+    camera::Camera cam;
+    cam.set_orientation(-90.0f, 10.0f);
+    while (state.keep_running())
+    {
+        cam.yaw_left(0.1f);
+        const glm::vec3 dir = cam.direction();
+        bench::do_not_optimize(dir);
+    }
+    state.set_items_processed(state.iterations());
+}
+SVM_BENCHMARK(bm_camera_direction);
+
+void bm_camera_view_projection(State& state)
+{
+    camera::Camera cam;
+    cam.set_position(glm::vec3(5, 10, 20));
+    cam.set_orientation(-90.0f, 10.0f);
+    // moving every frame is the common case in theater mode
+    const bool moving = state.arg() != 0;
+    while (state.keep_running())
+    {
+        if (moving)
+        {
+            cam.yaw_left(0.1f);
+        }
+        const glm::mat4 vp = cam.get_view_projection();
+        bench::do_not_optimize(vp);
+    }
+    state.set_items_processed(state.iterations());
+}
+SVM_BENCHMARK(bm_camera_view_projection, 0, 1);
+
+void bm_camera_move(State& state)
+{
+    camera::Camera cam;
+    while (state.keep_running())
+    {
+        cam.move_forward(0.05f);
+        cam.strafe_left(0.05f);
+        bench::do_not_optimize(cam);
+    }
+    state.set_items_processed(state.iterations());
+}
+SVM_BENCHMARK(bm_camera_move);
+
+// A view sweep around the room, evaluated through the batch API
+void bm_camera_view_sweep(State& state)
+{
+    constexpr std::size_t NUM_POSES = 360;
+    camera::Camera cam;
+    std::vector<camera::Camera::Pose> poses(NUM_POSES);
+    for (std::size_t i = 0; i < NUM_POSES; ++i)
+    {
+        poses[i] = { glm::vec3(5, 10, 20), static_cast<float>(i), 10.0f };
+    }
+    std::vector<glm::mat4> out(NUM_POSES);
+
+    while (state.keep_running())
+    {
+        cam.get_view_projections(poses.data(), poses.size(), out.data());
+        bench::do_not_optimize(out);
+    }
+    state.set_items_processed(state.iterations() * NUM_POSES);
+}
+SVM_BENCHMARK(bm_camera_view_sweep);
+} // anonymous namespace
@@ -0,0 +1,49 @@
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "bench.h"
+#include "hot_reload.h"
+
+using namespace svm;
+using svm::bench::State;
+
+namespace
+{
+// Image heights at 3:2; 8660 rows is about 50 MP
+#define RELOAD_HEIGHTS 1000, 2000, 4000, 8660
+
+image::Image gray_image(int width, int height)
+{
+    image::Image img;
+    const std::size_t bytes = static_cast<std::size_t>(width) * height * 3;
+    img.pixels = std::shared_ptr<unsigned char>(new unsigned char[bytes], std::default_delete<unsigned char[]>());
+    std::memset(img.pixels.get(), 100, bytes);
+    img.width = width;
+    img.height = height;
+    img.num_channels = 3;
+    return img;
+}
+
+// Finding what a retouch changed: a blemish-sized patch in the middle of an otherwise identical
+// RGB image. Each iteration compares width x height pixels.
+void bm_dirty_rects(State& state)
+{
+    const int height = static_cast<int>(state.arg());
+    const int width = height * 3 / 2;
+    const image::Image before = gray_image(width, height);
+    const image::Image after = gray_image(width, height);
+    for (int y = height / 2; y < height / 2 + 100; ++y)
+    {
+        std::memset(after.pixels.get() + (static_cast<std::size_t>(y) * width + width / 2) * 3, 50, 300);
+    }
+    while (state.keep_running())
+    {
+        const std::vector<reload::Rect> rects = reload::find_dirty_rects(before, after);
+        bench::do_not_optimize(rects.size());
+    }
+    state.set_items_processed(state.iterations() * static_cast<std::int64_t>(width) * height);
+    state.set_bytes_processed(state.iterations() * static_cast<std::int64_t>(width) * height * 3 * 2);
+}
+SVM_BENCHMARK(bm_dirty_rects, RELOAD_HEIGHTS);
+} // anonymous namespace
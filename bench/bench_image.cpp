@@ -0,0 +1,197 @@
+#include <stb/stb_image_write.h>
+#include <stb/stb_image.h>
+
+#include <cstdio>
+#include <fstream>
+#include <glad/glad.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "bench.h"
+#include "image.h"
+#include "mesh.h"
+#include "sequence.h"
+#include "texture.h"
+
+using namespace svm;
+using svm::bench::State;
+
+namespace
+{
+constexpr int NUM_CHANNELS = 3;
+
+// 4:3 images, selected by height: VGA, ~2 MP, ~8 MP and ~24 MP
+#define IMAGE_HEIGHTS 480, 1200, 2400, 4000
+
+int width_for(int height)
+{
+    return height * 4 / 3;
+}
+
+// Smooth gradients plus a little noise, so the encoder does photo-like work
+const std::vector<unsigned char>& raw_image(int height)
+{
+    static std::map<int, std::vector<unsigned char>> cache;
+    std::vector<unsigned char>& pixels = cache[height];
+    if (pixels.empty())
+    {
+        const int width = width_for(height);
+        pixels.resize(static_cast<size_t>(width) * height * NUM_CHANNELS);
+        unsigned int seed = 12345;
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                const int noise = static_cast<int>(seed >> 28);
+                unsigned char* px = &pixels[(static_cast<size_t>(y) * width + x) * NUM_CHANNELS];
+                px[0] = static_cast<unsigned char>((x * 255 / width + noise) & 0xff);
+                px[1] = static_cast<unsigned char>((y * 255 / height + noise) & 0xff);
+                px[2] = static_cast<unsigned char>(((x + y) * 127 / height + noise) & 0xff);
+            }
+        }
+    }
+    return pixels;
+}
+
+void append_bytes(void* context, void* data, int size)
+{
+    std::vector<unsigned char>* out = static_cast<std::vector<unsigned char>*>(context);
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    out->insert(out->end(), bytes, bytes + size);
+}
+
+const std::vector<unsigned char>& jpeg_image(int height)
+{
+    static std::map<int, std::vector<unsigned char>> cache;
+    std::vector<unsigned char>& jpeg = cache[height];
+    if (jpeg.empty())
+    {
+        stbi_write_jpg_to_func(append_bytes, &jpeg, width_for(height), height, NUM_CHANNELS,
+            raw_image(height).data(), 90);
+    }
+    return jpeg;
+}
+
+void bm_stb_decode_jpeg(State& state)
+{
+    const int height = static_cast<int>(state.arg());
+    const std::vector<unsigned char>& jpeg = jpeg_image(height);
+
+    while (state.keep_running())
+    {
+        int width, h, chans;
+        unsigned char* pixels = stbi_load_from_memory(jpeg.data(), static_cast<int>(jpeg.size()),
+            &width, &h, &chans, 0);
+        bench::do_not_optimize(pixels);
+        stbi_image_free(pixels);
+    }
+    state.set_bytes_processed(state.iterations() * static_cast<std::int64_t>(raw_image(height).size()));
+    state.set_label(std::to_string(width_for(height)) + "x" + std::to_string(height));
+}
+SVM_BENCHMARK(bm_stb_decode_jpeg, IMAGE_HEIGHTS);
+
+// glTexImage2D plus mipmap generation, waited on with glFinish so the GPU work is counted
+void bm_texture_upload(State& state)
+{
+    bench::gl_window();
+    const int height = static_cast<int>(state.arg());
+    const std::vector<unsigned char>& pixels = raw_image(height);
+
+    while (state.keep_running())
+    {
+        std::unique_ptr<texture::Texture2D> tex(
+            texture::Texture2D::from_pixels(pixels.data(), width_for(height), height, NUM_CHANNELS));
+        glFinish();
+    }
+    state.set_bytes_processed(state.iterations() * static_cast<std::int64_t>(pixels.size()));
+    state.set_label(std::to_string(width_for(height)) + "x" + std::to_string(height));
+}
+SVM_BENCHMARK(bm_texture_upload, IMAGE_HEIGHTS);
+
+// Texture2D::from_file end to end: streamed in bands through PBOs for JPEGs when built with
+// libjpeg, decoded with stb_image otherwise
+void bm_texture_from_jpeg_file(State& state)
+{
+    bench::gl_window();
+    const int height = static_cast<int>(state.arg());
+    const std::vector<unsigned char>& jpeg = jpeg_image(height);
+    const std::string path = "svm_bench_" + std::to_string(height) + ".jpg";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(jpeg.data()), jpeg.size());
+    }
+
+    while (state.keep_running())
+    {
+        std::unique_ptr<texture::Texture2D> tex(texture::Texture2D::from_file(path.c_str()));
+        glFinish();
+    }
+    std::remove(path.c_str());
+    state.set_bytes_processed(state.iterations() * static_cast<std::int64_t>(raw_image(height).size()));
+    state.set_label(std::to_string(width_for(height)) + "x" + std::to_string(height));
+}
+SVM_BENCHMARK(bm_texture_from_jpeg_file, IMAGE_HEIGHTS);
+
+// What the editor waits for before it can show an image: a preview decoded at reduced DCT scale
+// (when built with libjpeg) and uploaded
+void bm_texture_preview_from_jpeg_file(State& state)
+{
+    bench::gl_window();
+    const int height = static_cast<int>(state.arg());
+    const std::vector<unsigned char>& jpeg = jpeg_image(height);
+    const std::string path = "svm_bench_preview_" + std::to_string(height) + ".jpg";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(jpeg.data()), jpeg.size());
+    }
+
+    int scale_denom = 1;
+    while (state.keep_running())
+    {
+        const image::Image img = image::decode_file(path.c_str(), mesh::Mesh::WINDOW_HEIGHT);
+        std::unique_ptr<texture::Texture2D> tex(
+            texture::Texture2D::from_pixels(img.pixels.get(), img.width, img.height, img.num_channels));
+        glFinish();
+        scale_denom = img.scale_denom;
+    }
+    std::remove(path.c_str());
+    state.set_label(std::to_string(width_for(height)) + "x" + std::to_string(height) + " at 1/"
+        + std::to_string(scale_denom));
+}
+SVM_BENCHMARK(bm_texture_preview_from_jpeg_file, IMAGE_HEIGHTS);
+
+// Sequence playback with no frame rate cap: each iteration is one uploaded frame, so the rate is
+// what the decode workers sustain
+void bm_sequence_stream(State& state)
+{
+    bench::gl_window();
+    const int height = static_cast<int>(state.arg());
+    const std::vector<unsigned char>& jpeg = jpeg_image(height);
+    std::vector<std::string> paths;
+    for (int i = 0; i < 8; ++i)
+    {
+        paths.push_back("svm_bench_seq_" + std::to_string(i) + ".jpg");
+        std::ofstream out(paths.back(), std::ios::binary);
+        out.write(reinterpret_cast<const char*>(jpeg.data()), jpeg.size());
+    }
+
+    {
+        sequence::SequenceStreamer streamer(paths);
+        while (state.keep_running())
+        {
+            while (!streamer.update(0.0))
+            {}
+        }
+        glFinish();
+    }
+    for (const std::string& path: paths)
+    {
+        std::remove(path.c_str());
+    }
+    state.set_bytes_processed(state.iterations() * static_cast<std::int64_t>(raw_image(height).size()));
+    state.set_label(std::to_string(width_for(height)) + "x" + std::to_string(height));
+}
+SVM_BENCHMARK(bm_sequence_stream, IMAGE_HEIGHTS);
+} // anonymous namespace
@@ -0,0 +1,59 @@
+#include <memory>
+
+#include "bench.h"
+#include "mesh.h"
+#include "texture.h"
+
+using namespace svm;
+using svm::bench::State;
+
+namespace
+{
+// The mesh only uses the texture's aspect ratio, so a tiny 4:3 one stands in for a photo
+std::shared_ptr<texture::Texture2D> four_by_three_texture()
+{
+    bench::gl_window();
+    static const unsigned char pixels[4 * 3 * 3] = {};
+    static std::shared_ptr<texture::Texture2D> tex(texture::Texture2D::from_pixels(pixels, 4, 3, 3));
+    return tex;
+}
+
+input::Event cursor_event(input::EventType type, double x, double y)
+{
+    input::Event ev = {};
+    ev.type = type;
+    ev.timestamp = window::Window::now();
+    ev.code = GLFW_MOUSE_BUTTON_LEFT;
+    ev.action = GLFW_PRESS;
+    ev.x = x;
+    ev.y = y;
+    return ev;
+}
+
+// One drag frame: a single cursor move on the top edge, which rebuilds the mesh buffers
+void bm_mesh_drag_frame(State& state)
+{
+    const std::shared_ptr<window::Window>& window = bench::gl_window();
+    mesh::Mesh mesh(four_by_three_texture());
+    mesh.setup(window);
+
+    // grab the top edge (setup puts it at a quarter of the window height)
+    int width, height;
+    window->get_window_size(width, height);
+    window->events().clear();
+    window->events().push(cursor_event(input::EventType::mouse_button, width * 0.5, height * 0.1));
+    mesh.process_input(window, 1);
+
+    double y = height * 0.1;
+    while (state.keep_running())
+    {
+        y = (y < height * 0.2) ? y + 1 : height * 0.05;
+        window->events().push(cursor_event(input::EventType::cursor_pos, width * 0.5, y));
+        mesh.process_input(window, 1);
+        // what swap_buffers() would do at the end of the frame
+        window->frame_arena().reset();
+    }
+    state.set_items_processed(state.iterations());
+}
+SVM_BENCHMARK(bm_mesh_drag_frame);
+} // anonymous namespace
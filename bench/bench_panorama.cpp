@@ -0,0 +1,37 @@
+#include <cstdint>
+#include <vector>
+
+#include "bench.h"
+#include "panorama.h"
+
+using namespace svm;
+using svm::bench::State;
+
+namespace
+{
+// Output widths; the cube faces are a quarter of that
+#define PANORAMA_WIDTHS 2048, 8192, 16384
+
+// The resample only, from faces already read back; each iteration writes width x width / 2 pixels
+void bm_equirect_remap(State& state)
+{
+    const int width = static_cast<int>(state.arg());
+    const int face_size = panorama::face_size_for(width);
+    std::vector<unsigned char> faces(6 * static_cast<std::size_t>(face_size) * face_size * 4);
+    std::uint32_t noise = 12345;
+    for (unsigned char& c: faces)
+    {
+        noise = noise * 1664525u + 1013904223u;
+        c = static_cast<unsigned char>(noise >> 24);
+    }
+
+    const panorama::EquirectRemapper remapper(width);
+    std::vector<unsigned char> rgb(static_cast<std::size_t>(remapper.width()) * remapper.height() * 3);
+    while (state.keep_running())
+    {
+        remapper.remap(faces.data(), face_size, rgb.data());
+    }
+    state.set_bytes_processed(state.iterations() * static_cast<std::int64_t>(rgb.size()));
+}
+SVM_BENCHMARK(bm_equirect_remap, PANORAMA_WIDTHS);
+} // anonymous namespace
@@ -0,0 +1,30 @@
+#include <cstdint>
+#include <vector>
+
+#include "bench.h"
+#include "synthetic.h"
+
+using namespace svm;
+using svm::bench::State;
+
+namespace
+{
+// Image heights at 3:2; 8660 rows is about 50 MP
+#define ROOM_HEIGHTS 1000, 2000, 4000, 8660
+
+// Rendering a whole room into memory; each iteration fills width x height RGB pixels
+void bm_synthetic_room(State& state)
+{
+    const int height = static_cast<int>(state.arg());
+    const synthetic::RoomRenderer renderer(synthetic::random_room(1, height * 3 / 2, height));
+    std::vector<unsigned char> rgb(static_cast<std::size_t>(renderer.params().width) * height * 3);
+    while (state.keep_running())
+    {
+        renderer.render(rgb.data());
+        bench::do_not_optimize(rgb[0]);
+    }
+    state.set_items_processed(state.iterations() * static_cast<std::int64_t>(rgb.size() / 3));
+    state.set_bytes_processed(state.iterations() * static_cast<std::int64_t>(rgb.size()));
+}
+SVM_BENCHMARK(bm_synthetic_room, ROOM_HEIGHTS);
+} // anonymous namespace
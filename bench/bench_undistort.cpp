@@ -0,0 +1,60 @@
+#include <cstdint>
+#include <vector>
+
+#include "bench.h"
+#include "undistort.h"
+
+using namespace svm;
+using svm::bench::State;
+
+namespace
+{
+// Image heights at 3:2; 8660 rows is about 50 MP
+#define UNDISTORT_HEIGHTS 1000, 2000, 4000, 8660
+
+undistort::LensModel wide_angle()
+{
+    undistort::LensModel lens;
+    lens.k1 = -0.12f;
+    lens.k2 = 0.02f;
+    lens.p1 = 0.001f;
+    return lens;
+}
+
+// Building the remap table, which happens once per lens and image size
+void bm_undistort_map(State& state)
+{
+    const int height = static_cast<int>(state.arg());
+    const int width = height * 3 / 2;
+    while (state.keep_running())
+    {
+        const undistort::UndistortMap map(wide_angle(), width, height);
+        bench::do_not_optimize(map.width());
+    }
+    state.set_items_processed(state.iterations() * static_cast<std::int64_t>(width) * height);
+}
+SVM_BENCHMARK(bm_undistort_map, UNDISTORT_HEIGHTS);
+
+// Correcting an RGB image through a built table; each iteration reads and writes width x height
+// pixels
+void bm_undistort_apply(State& state)
+{
+    const int height = static_cast<int>(state.arg());
+    const int width = height * 3 / 2;
+    const undistort::UndistortMap map(wide_angle(), width, height);
+    std::vector<unsigned char> src(static_cast<std::size_t>(width) * height * 3);
+    for (std::size_t i = 0; i < src.size(); ++i)
+    {
+        src[i] = static_cast<unsigned char>(i * 7);
+    }
+    std::vector<unsigned char> dst(src.size());
+    while (state.keep_running())
+    {
+        map.apply(src.data(), dst.data(), 3);
+        bench::do_not_optimize(dst[0]);
+    }
+    state.set_items_processed(state.iterations() * static_cast<std::int64_t>(width) * height);
+    state.set_bytes_processed(state.iterations() * static_cast<std::int64_t>(dst.size()));
+}
+SVM_BENCHMARK(bm_undistort_apply, UNDISTORT_HEIGHTS);
+} // anonymous namespace
@@ -0,0 +1,151 @@
+#include <algorithm>
+
+#include "accumulation.h"
+#include "vertex.h"
+
+namespace
+{
+// Radical inverse of i in the given base: a low-discrepancy sequence in [0, 1), so any prefix of
+// the jitter pattern covers the pixel evenly
+float halton(int i, int base)
+{
+    float result = 0.0f;
+    float digit_weight = 1.0f / base;
+    for (; i > 0; i /= base, digit_weight /= base)
+    {
+        result += digit_weight * (i % base);
+    }
+    return result;
+}
+} // anonymous namespace
+
+namespace svm
+{
+namespace accumulation
+{
+Accumulator::Accumulator(const AccumulationParams& params)
+    : m_params(params)
+    , m_average(GL_RGBA16F)
+    , m_prog()
+    , m_empty_vao(0)
+    , m_width(0)
+    , m_height(0)
+    , m_frames(0)
+{
+    if (enabled())
+    {
+        create_gl_objects();
+    }
+}
+
+void Accumulator::set_params(const AccumulationParams& params)
+{
+    m_params = params;
+    if (enabled() && !m_prog)
+    {
+        create_gl_objects();
+    }
+    reset();
+}
+
+void Accumulator::create_gl_objects()
+{
+    m_prog.reset(new shader::ShaderProgram(shader::ShaderProgram::fullscreen_texture()));
+    glGenVertexArrays(1, &m_empty_vao);
+}
+
+const AccumulationParams& Accumulator::params() const
+{
+    return m_params;
+}
+
+bool Accumulator::enabled() const
+{
+    return m_params.max_frames > 1;
+}
+
+void Accumulator::reset()
+{
+    m_frames = 0;
+}
+
+int Accumulator::frames() const
+{
+    return m_frames;
+}
+
+bool Accumulator::converged() const
+{
+    return m_frames >= m_params.max_frames;
+}
+
+glm::vec2 Accumulator::next_jitter() const
+{
+    if (m_frames == 0)
+    {
+        return glm::vec2(0.0f, 0.0f);
+    }
+    return glm::vec2(halton(m_frames, 2) - 0.5f, halton(m_frames, 3) - 0.5f);
+}
+
+void Accumulator::add(framebuffer::Framebuffer& src, int width, int height)
+{
+    if (width != m_width || height != m_height)
+    {
+        m_width = width;
+        m_height = height;
+        m_frames = 0;
+    }
+    // sized like src so the average covers the same lower-left region
+    m_average.resize(src.width(), src.height());
+
+    // average += (frame - average) / (n + 1), done by the blender
+    const float weight = 1.0f / (m_frames + 1);
+    GLint blend_src, blend_dst;
+    glGetIntegerv(GL_BLEND_SRC_RGB, &blend_src);
+    glGetIntegerv(GL_BLEND_DST_RGB, &blend_dst);
+    const GLboolean blend = glIsEnabled(GL_BLEND);
+    const GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+
+    m_average.bind();
+    glViewport(0, 0, width, height);
+    glEnable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glBlendColor(0.0f, 0.0f, 0.0f, weight);
+    glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+
+    m_prog->setUniformVec2("uv_scale", glm::vec2(static_cast<float>(width) / src.width(),
+        static_cast<float>(height) / src.height()));
+    src.bind_color_texture(GL_TEXTURE0);
+    glBindVertexArray(m_empty_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    vertex::count_draw_calls();
+    glBindVertexArray(0);
+
+    glBlendFunc(blend_src, blend_dst);
+    if (!blend)
+    {
+        glDisable(GL_BLEND);
+    }
+    if (depth_test)
+    {
+        glEnable(GL_DEPTH_TEST);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    m_frames = std::min(m_frames + 1, m_params.max_frames);
+}
+
+void Accumulator::blit_to_default(int dst_width, int dst_height)
+{
+    m_average.blit_to_default(m_width, m_height, dst_width, dst_height);
+}
+
+Accumulator::~Accumulator()
+{
+    if (m_empty_vao != 0)
+    {
+        glDeleteVertexArrays(1, &m_empty_vao);
+    }
+}
+} // namespace accumulation
+} // namespace svm
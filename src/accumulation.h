@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/vec2.hpp>
+#include <memory>
+
+#include "framebuffer.h"
+#include "shader.h"
+
+namespace svm
+{
+namespace accumulation
+{
+struct AccumulationParams
+{
+    // frames averaged before the image is considered converged; 1 or less turns it off
+    int max_frames = 1;
+};
+
+// Progressive supersampling for a still camera. Each frame is rendered with a different sub-pixel
+// jitter and folded into a running average held in a half-float buffer, so after N frames the
+// image is N-times supersampled. Once converged nothing new needs to be rendered; any change to
+// the view calls for reset().
+class Accumulator
+{
+public:
+    explicit Accumulator(const AccumulationParams& params = AccumulationParams());
+
+    Accumulator(const Accumulator&) = delete;
+    Accumulator& operator=(const Accumulator&) = delete;
+
+    void set_params(const AccumulationParams& params);
+    const AccumulationParams& params() const;
+    bool enabled() const;
+
+    // Starts over with the next frame
+    void reset();
+    int frames() const;
+    bool converged() const;
+
+    // Offset of the next frame in pixels, within (-0.5, 0.5). The first frame after a reset isn't
+    // jittered, so it matches what would be drawn without accumulation.
+    glm::vec2 next_jitter() const;
+
+    // Folds the lower-left width x height of src's color into the average. Starts over if the
+    // size differs from the previous frame's. Only valid while enabled().
+    void add(framebuffer::Framebuffer& src, int width, int height);
+    // Copies the average onto the whole default framebuffer, which is left bound with a matching
+    // viewport
+    void blit_to_default(int dst_width, int dst_height);
+
+    ~Accumulator();
+
+private:
+    void create_gl_objects();
+
+    AccumulationParams m_params;
+    framebuffer::Framebuffer m_average;
+    // created once enabled, so a disabled accumulator costs no GL objects and add() none either
+    std::unique_ptr<shader::ShaderProgram> m_prog;
+    GLuint m_empty_vao;
+    int m_width;
+    int m_height;
+    int m_frames;
+};
+} // namespace accumulation
+} // namespace svm
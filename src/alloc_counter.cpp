@@ -0,0 +1,88 @@
+#include <cstdlib>
+#include <new>
+
+#include "alloc_counter.h"
+
+#ifdef SVM_ALLOC_COUNTER
+namespace
+{
+// per thread, so decode workers don't count against the frame loop
+thread_local std::size_t num_allocations = 0;
+
+void* counted_malloc(std::size_t size)
+{
+    ++num_allocations;
+    return std::malloc(size == 0 ? 1 : size);
+}
+} // anonymous namespace
+
+void* operator new(std::size_t size)
+{
+    void* res = counted_malloc(size);
+    if (res == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return res;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_malloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_malloc(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+#endif // SVM_ALLOC_COUNTER
+
+namespace svm
+{
+namespace tools
+{
+std::size_t allocation_count()
+{
+#ifdef SVM_ALLOC_COUNTER
+    return num_allocations;
+#else
+    return 0;
+#endif
+}
+} // namespace tools
+} // namespace svm
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+// Builds configured with SVM_ALLOC_CHECK (on by default for CMake Debug builds) define
+// SVM_ALLOC_COUNTER, which replaces the global operator new to count heap allocations, so the frame
+// loop can check that steady-state frames don't allocate. Other builds keep the standard allocator.
+
+namespace svm
+{
+namespace tools
+{
+// Number of operator new calls so far on the calling thread; always 0 without SVM_ALLOC_COUNTER
+std::size_t allocation_count();
+} // namespace tools
+} // namespace svm
@@ -1,5 +1,8 @@
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <utility>
+#include <glm/gtc/matrix_transform.hpp>
 
 #include "background.h"
 
@@ -27,16 +30,44 @@ namespace svm
 {
 namespace background
 {
-Background::Background(std::shared_ptr<texture::Texture2D> bg)
+Background::Background(std::shared_ptr<texture::Texture2D> bg, shader::ShaderProgram prog)
     : m_camera()
-    , m_prog(shader::ShaderProgram::textured_object())
+    , m_box_model()
+    , m_prog(std::move(prog))
+    , m_stereo_prog()
+    , m_cube_prog()
     , m_texture(bg)
     , m_vao()
+    , m_framebuffer()
+    , m_gpu_timer()
+    , m_resolution()
+    , m_accumulator()
     , m_last_cursor_x()
     , m_last_cursor_y()
     , m_first_cursor_input(true)
+    , m_moving_forward(false)
+    , m_moving_back(false)
+    , m_moving_left(false)
+    , m_moving_right(false)
+    , m_camera_moved(false)
 {}
 
+void Background::set_texture(std::shared_ptr<texture::Texture2D> bg)
+{
+    m_texture = std::move(bg);
+    m_accumulator.reset();
+}
+
+void Background::set_accumulation_params(const accumulation::AccumulationParams& params)
+{
+    m_accumulator.set_params(params);
+}
+
+void Background::reset_accumulation()
+{
+    m_accumulator.reset();
+}
+
 void Background::set_user_params
 (
     const glm::vec2& top_left,
@@ -45,9 +76,8 @@ void Background::set_user_params
     float fovy
 )
 {
-    m_camera.pitch = 0;
-    m_camera.yaw = -90.0;
-    m_camera.fovy = fovy;
+    m_camera.set_orientation(-90.0f, 0.0f);
+    m_camera.set_fovy(fovy);
 
     vertex::vertex3_element verts[12];
     calculate_tex_2d(top_left, bot_right, vanishing, verts);
@@ -81,71 +111,286 @@ void Background::set_user_params
     }
 
     m_vao = vertex::VertexArrayBuffer(verts, ARRAY_SIZE(verts), triangles, ARRAY_SIZE(triangles));
+    m_accumulator.reset();
 }
 
-void Background::setup(const window_ptr_t& window)
+void Background::set_resolution_params(const resolution::ResolutionParams& params)
 {
-    int win_width, win_height;
-    window->get_window_size(win_width, win_height);
-    m_camera.set_screen(win_width, win_height);
+    m_resolution.set_params(params);
+}
 
-    window->set_cursor_enabled(false);
-    window->set_resize_callback([this](int width, int height)
+void Background::set_stereo(bool enabled, float ipd)
+{
+    if (enabled && !m_stereo_prog)
     {
-        m_camera.set_screen(width, height);
-    });
-    window->set_cursor_pos_callback(
-        [this](double x_pos, double y_pos)
+        m_stereo_prog.reset(new shader::ShaderProgram(shader::ShaderProgram::textured_object_stereo()));
+    }
+    else if (!enabled)
     {
-        constexpr float sensitivity = 0.1;
+        m_stereo_prog.reset();
+    }
+    m_camera.set_ipd(ipd);
+    m_accumulator.reset();
+}
 
-        if (m_first_cursor_input)
-        {
-            m_last_cursor_x = static_cast<float>(x_pos);
-            m_last_cursor_y = static_cast<float>(y_pos);
-            m_first_cursor_input = false;
-        }
+const camera::Camera& Background::camera() const
+{
+    return m_camera;
+}
 
-        const float offset_x = static_cast<float>(x_pos) - m_last_cursor_x;
-        const float offset_y = static_cast<float>(y_pos) - m_last_cursor_y;
+const depth::BoxModel& Background::box_model() const
+{
+    return m_box_model;
+}
 
-        m_camera.yaw_left(offset_x * sensitivity);
-        m_camera.pitch_up(-offset_y * sensitivity);
+void Background::render_cube(framebuffer::CubeFramebuffer& target, const glm::vec3& position)
+{
+    if (!m_cube_prog)
+    {
+        m_cube_prog.reset(new shader::ShaderProgram(shader::ShaderProgram::textured_object_cube()));
+    }
+
+    camera::Camera cube_camera(m_camera);
+    cube_camera.set_position(position);
+    glm::mat4 faces[6];
+    cube_camera.get_cube_face_view_projections(faces);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    target.bind();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    m_cube_prog->setUniformMat4Array("face_cameras", faces, 6);
+    m_texture->insert_to_unit_spot(GL_TEXTURE0);
+    m_vao.draw_elements();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void Background::setup(const window_ptr_t& window)
+{
+    int win_width, win_height;
+    window->get_window_size(win_width, win_height);
+    m_camera.set_screen(win_width, win_height);
+
+    window->set_cursor_enabled(false);
+    // anything queued so far was meant for the previous scene
+    window->events().clear();
 
-        m_last_cursor_x = x_pos;
-        m_last_cursor_y = y_pos;
-    });
+    // a previous visit may have ended with keys held down
+    m_first_cursor_input = true;
+    m_moving_forward = false;
+    m_moving_back = false;
+    m_moving_left = false;
+    m_moving_right = false;
+    m_accumulator.reset();
 }
 
 void Background::process_input(const window_ptr_t& window, float)
 {
+    m_camera_moved = false;
+    apply_events(window);
+
+    if (m_moving_forward || m_moving_back || m_moving_left || m_moving_right)
+    {
+        m_camera_moved = true;
+    }
+
     constexpr float move_size = 0.05;
-    if (window->key_is_pressed(GLFW_KEY_W))
+    if (m_moving_forward)
     {
         m_camera.move_forward(move_size);
     }
-    if (window->key_is_pressed(GLFW_KEY_S))
+    if (m_moving_back)
     {
         m_camera.move_forward(-move_size);
     }
-    if (window->key_is_pressed(GLFW_KEY_A))
+    if (m_moving_left)
     {
         m_camera.strafe_left(move_size);
     }
-    if (window->key_is_pressed(GLFW_KEY_D))
+    if (m_moving_right)
     {
         m_camera.strafe_left(-move_size);
     }
 }
 
-void Background::render(const window_ptr_t&, float)
+void Background::render(const window_ptr_t& window, float)
+{
+    // Late latch: with frame pacing on, the mouse is sampled again right before the box is
+    // submitted, so the view matches input that is a frame's worth of work newer
+    window->latch_input();
+    apply_events(window);
+
+    // accumulated frames are only valid for the view they were rendered from
+    if (m_camera_moved)
+    {
+        m_accumulator.reset();
+    }
+
+    const resolution::ResolutionParams& params = m_resolution.params();
+    const bool accumulate = m_accumulator.enabled() && !m_camera_moved;
+    if (!params.enabled && !accumulate)
+    {
+        draw_box(glm::vec2(0.0f, 0.0f));
+        return;
+    }
+
+    // the scale is held while accumulating, since every change to it would start the average over
+    double gpu_ms;
+    if (params.enabled && m_gpu_timer.poll(gpu_ms) && !accumulate)
+    {
+        m_resolution.update(gpu_ms, m_camera_moved);
+    }
+
+    // The offscreen target is sized for max_scale so scale changes only move the viewport
+    const float max_scale = params.enabled ? params.max_scale : 1.0f;
+    const float scale = params.enabled ? m_resolution.scale() : 1.0f;
+    int fb_width, fb_height;
+    window->get_framebuffer_size(fb_width, fb_height);
+    m_framebuffer.resize
+    (
+        std::max(1, static_cast<int>(std::ceil(fb_width * max_scale))),
+        std::max(1, static_cast<int>(std::ceil(fb_height * max_scale)))
+    );
+    const int render_width = std::max(1, static_cast<int>(fb_width * scale));
+    const int render_height = std::max(1, static_cast<int>(fb_height * scale));
+
+    if (params.enabled)
+    {
+        m_gpu_timer.begin();
+    }
+    if (!accumulate)
+    {
+        m_framebuffer.bind();
+        glViewport(0, 0, render_width, render_height);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        draw_box(glm::vec2(0.0f, 0.0f));
+        m_framebuffer.blit_to_default(render_width, render_height, fb_width, fb_height);
+    }
+    else
+    {
+        // once converged, showing the average costs one blit and nothing is drawn
+        if (!m_accumulator.converged())
+        {
+            const glm::vec2 jitter = m_accumulator.next_jitter();
+            m_framebuffer.bind();
+            glViewport(0, 0, render_width, render_height);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            draw_box(glm::vec2(2.0f * jitter.x / render_width, 2.0f * jitter.y / render_height));
+            m_accumulator.add(m_framebuffer, render_width, render_height);
+        }
+        m_accumulator.blit_to_default(fb_width, fb_height);
+    }
+    if (params.enabled)
+    {
+        m_gpu_timer.end();
+    }
+}
+
+void Background::draw_box(const glm::vec2& jitter)
 {
+    if (m_stereo_prog)
+    {
+        glm::mat4 eyes[2];
+        m_camera.get_eye_view_projections(eyes);
+        if (jitter != glm::vec2(0.0f, 0.0f))
+        {
+            // the shader squeezes each eye into half the width, halving its shift too
+            const glm::mat4 shift = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f * jitter.x, jitter.y, 0.0f));
+            eyes[0] = shift * eyes[0];
+            eyes[1] = shift * eyes[1];
+        }
+        m_stereo_prog->setUniformMat4Array("eye_cameras", eyes, 2);
+        m_texture->insert_to_unit_spot(GL_TEXTURE0);
+        glEnable(GL_CLIP_DISTANCE0);
+        m_vao.draw_elements_instanced(2);
+        glDisable(GL_CLIP_DISTANCE0);
+        return;
+    }
+
     m_prog.use();
-    m_prog.setUniformMat4("camera", m_camera.get_view_projection());
+    if (jitter != glm::vec2(0.0f, 0.0f))
+    {
+        // a clip space translation by jitter * w moves everything by jitter in NDC
+        m_prog.setUniformMat4("camera", glm::translate(glm::mat4(1.0f), glm::vec3(jitter, 0.0f))
+            * m_camera.get_view_projection());
+    }
+    else
+    {
+        m_prog.setUniformMat4("camera", m_camera.get_view_projection());
+    }
     m_texture->insert_to_unit_spot(GL_TEXTURE0);
     m_vao.draw_elements();
 }
 
+void Background::apply_events(const window_ptr_t& window)
+{
+    input::Event ev;
+    while (window->events().pop(ev))
+    {
+        switch (ev.type)
+        {
+        case input::EventType::key:
+            if (ev.action != GLFW_REPEAT)
+            {
+                set_move_key(ev.code, ev.action == GLFW_PRESS);
+            }
+            break;
+        case input::EventType::cursor_pos:
+            look_at_cursor(ev.x, ev.y);
+            m_camera_moved = true;
+            break;
+        case input::EventType::resize:
+            m_camera.set_screen(ev.width, ev.height);
+            m_accumulator.reset();
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void Background::set_move_key(int key, bool pressed)
+{
+    if (key == GLFW_KEY_W)
+    {
+        m_moving_forward = pressed;
+    }
+    else if (key == GLFW_KEY_S)
+    {
+        m_moving_back = pressed;
+    }
+    else if (key == GLFW_KEY_A)
+    {
+        m_moving_left = pressed;
+    }
+    else if (key == GLFW_KEY_D)
+    {
+        m_moving_right = pressed;
+    }
+}
+
+void Background::look_at_cursor(double x_pos, double y_pos)
+{
+    constexpr float sensitivity = 0.1;
+
+    if (m_first_cursor_input)
+    {
+        m_last_cursor_x = static_cast<float>(x_pos);
+        m_last_cursor_y = static_cast<float>(y_pos);
+        m_first_cursor_input = false;
+    }
+
+    const float offset_x = static_cast<float>(x_pos) - m_last_cursor_x;
+    const float offset_y = static_cast<float>(y_pos) - m_last_cursor_y;
+
+    m_camera.yaw_left(offset_x * sensitivity);
+    m_camera.pitch_up(-offset_y * sensitivity);
+
+    m_last_cursor_x = x_pos;
+    m_last_cursor_y = y_pos;
+}
+
 void Background::calculate_tex_2d
 (
     const glm::vec2& top_left,
@@ -204,7 +449,6 @@ void Background::calculate_box_3d
 
     const glm::vec2 top_left_view = comp_mul(top_left_, tex_dimensions);
     const glm::vec2 bot_right_view = comp_mul(bot_right_, tex_dimensions);
-    const glm::vec2 vanishing_view = comp_mul(vanishing_, tex_dimensions);
 
     const float rear_width_view = bot_right_view.x - top_left_view.x;
     const float rear_height_view = top_left_view.y - bot_right_view.y;
@@ -213,12 +457,10 @@ void Background::calculate_box_3d
     const float rear_w = REAR_H * rear_aspect;
     const float box_depth = rear_w; // @TODO: replace
 
-    const float degrees_from_floor = (vanishing_view.y - bot_right_view.y) / rear_height_view * fovy;
-
-    m_camera.x = (vanishing_view.x - top_left_view.x) / rear_width_view * rear_w; // ...
-    m_camera.y = (vanishing_view.y - bot_right_view.y) / rear_height_view * REAR_H; // ...
-    m_camera.z = m_camera.y / glm::tan(glm::radians(degrees_from_floor)); // ...
-    //std::cout << "camera: " << m_camera.x << ' ' << m_camera.y << ' ' << m_camera.z << std::endl;
+    m_box_model = depth::make_box_model(top_left_, bot_right_, vanishing_, fovy, tex_dimensions.x, REAR_H);
+    const glm::vec3 camera_pos = m_box_model.camera;
+    m_camera.set_position(camera_pos);
+    //std::cout << "camera: " << camera_pos.x << ' ' << camera_pos.y << ' ' << camera_pos.z << std::endl;
     //std::cout << fovy << std::endl;
     //std::cout << rear_w << ' ' << REAR_H <<  ' ' << box_depth << std::endl;
 
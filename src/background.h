@@ -1,6 +1,13 @@
 #pragma once
 
+#include <memory>
+
+#include "accumulation.h"
 #include "camera.h"
+#include "depth_map.h"
+#include "framebuffer.h"
+#include "gpu_timer.h"
+#include "resolution.h"
 #include "scene.h"
 #include "shader.h"
 #include "texture.h"
@@ -9,12 +16,22 @@
 
 namespace svm
 {
+namespace bench
+{
+struct BackgroundGeometry;
+} // namespace bench
+
 namespace background
 {
 class Background: public scene::Scene
 {
 public:
-    Background(std::shared_ptr<texture::Texture2D> bg);
+    // prog must come from ShaderProgram::textured_object(); pass one in to have it compiled ahead
+    // of time
+    Background(std::shared_ptr<texture::Texture2D> bg,
+        shader::ShaderProgram prog = shader::ShaderProgram::textured_object());
+
+    void set_texture(std::shared_ptr<texture::Texture2D> bg);
 
     void set_user_params
     (
@@ -24,11 +41,35 @@ public:
         float fovy
     );
 
+    // Theater mode renders offscreen at a scale picked from measured GPU frame time, then
+    // upscales to the window
+    void set_resolution_params(const resolution::ResolutionParams& params);
+
+    // Side-by-side stereo for 3D displays: both eyes are drawn in one instanced draw, eyes ipd
+    // scene units apart (the rear wall is 20 units tall)
+    void set_stereo(bool enabled, float ipd);
+
+    const camera::Camera& camera() const;
+    // The box as placed by the last set_user_params(), for depth::DepthMapper
+    const depth::BoxModel& box_model() const;
+
+    // Draws the box from position into all six faces of target in one layered draw; leaves the
+    // default framebuffer bound with the viewport it had before
+    void render_cube(framebuffer::CubeFramebuffer& target, const glm::vec3& position);
+
+    // While the camera is still, frames are jittered and averaged into a supersampled image
+    void set_accumulation_params(const accumulation::AccumulationParams& params);
+    // Starts the average over, for changes Background can't see, like new texture contents
+    void reset_accumulation();
+
     void setup(const window_ptr_t& window) override;
     void process_input(const window_ptr_t& window, float frame_time) override;
     void render(const window_ptr_t& window, float frame_time) override;
 
 private:
+    // Times the geometry steps of set_user_params() on their own
+    friend struct bench::BackgroundGeometry;
+
     void calculate_tex_2d
     (
         const glm::vec2& view_top_left,
@@ -37,6 +78,7 @@ private:
         vertex::vertex3_element tex_uv[12]
     );
 
+    // Also places the camera
     void calculate_box_3d
     (
         const glm::vec2& view_top_left,
@@ -46,13 +88,32 @@ private:
         vertex::vertex3_element box_coords[12]
     );
 
+    void apply_events(const window_ptr_t& window);
+    void set_move_key(int key, bool pressed);
+    void look_at_cursor(double x_pos, double y_pos);
+    // jitter is a sub-pixel offset in NDC
+    void draw_box(const glm::vec2& jitter);
+
     camera::Camera m_camera;
+    depth::BoxModel m_box_model;
     shader::ShaderProgram m_prog;
+    // only compiled once stereo is turned on
+    std::unique_ptr<shader::ShaderProgram> m_stereo_prog;
+    std::unique_ptr<shader::ShaderProgram> m_cube_prog;
     std::shared_ptr<texture::Texture2D> m_texture;
     vertex::VertexArrayBuffer m_vao;
+    framebuffer::Framebuffer m_framebuffer;
+    timer::GpuTimer m_gpu_timer;
+    resolution::ResolutionController m_resolution;
+    accumulation::Accumulator m_accumulator;
     float m_last_cursor_x;
     float m_last_cursor_y;
     bool m_first_cursor_input;
+    bool m_moving_forward;
+    bool m_moving_back;
+    bool m_moving_left;
+    bool m_moving_right;
+    bool m_camera_moved;
 };
 } // namespace background
 } // namespace svm
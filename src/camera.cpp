@@ -4,63 +4,257 @@
 
 namespace
 {
-    static glm::vec3 global_up(0.0, 1.0, 0.0);
+    static const glm::vec3 global_up(0.0, 1.0, 0.0);
+    static const glm::vec3 local_right(1.0, 0.0, 0.0);
+    static const glm::vec3 local_forward(0.0, 0.0, -1.0);
+
+    static constexpr float z_near = 0.1f;
+    static constexpr float z_far = 100.0f;
 }
 
 namespace svm
 {
 namespace camera
 {
-glm::mat4 Camera::get_view_projection() const
+Camera::Camera()
+    : m_view(1.0f)
+    , m_projection(1.0f)
+    , m_view_projection(1.0f)
+    , m_orientation()
+    , m_forward(local_forward)
+    , m_right(local_right)
+    , m_up(global_up)
+    , m_position(0.0f)
+    , m_yaw(-90.0f)
+    , m_pitch(0.0f)
+    , m_fovy(54.0f)
+    , m_ipd(0.5f)
+    , m_convergence(20.0f)
+    , m_screen_width(600.0f)
+    , m_screen_height(400.0f)
+    , m_basis_dirty(true)
+    , m_view_dirty(true)
+    , m_projection_dirty(true)
+    , m_view_projection_dirty(true)
+{}
+
+const glm::mat4& Camera::get_view_projection() const
+{
+    const glm::mat4& projection = get_projection();
+    const glm::mat4& view = get_view();
+    if (m_view_projection_dirty)
+    {
+        m_view_projection = projection * view;
+        m_view_projection_dirty = false;
+    }
+    return m_view_projection;
+}
+
+const glm::mat4& Camera::get_view() const
 {
-    const glm::vec3 pos = position();
-    const glm::mat4 view = glm::lookAt(pos, pos + direction(), global_up);
-    const float aspect_ratio = screen_width / screen_height;
-    const glm::mat4 persp = glm::perspective(glm::radians(fovy), aspect_ratio, 0.1f, 100.0f);
-    return persp * view;
+    if (m_view_dirty || m_basis_dirty)
+    {
+        update_basis();
+        m_view = view_for(m_position, m_orientation);
+        m_view_dirty = false;
+        m_view_projection_dirty = true;
+    }
+    return m_view;
+}
+
+const glm::mat4& Camera::get_projection() const
+{
+    if (m_projection_dirty)
+    {
+        const float aspect_ratio = m_screen_width / m_screen_height;
+        m_projection = glm::perspective(glm::radians(m_fovy), aspect_ratio, z_near, z_far);
+        m_projection_dirty = false;
+        m_view_projection_dirty = true;
+    }
+    return m_projection;
+}
+
+void Camera::get_view_projections(const Pose* poses, std::size_t count, glm::mat4* out) const
+{
+    const glm::mat4& projection = get_projection();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const glm::quat orientation = orientation_for(poses[i].yaw, poses[i].pitch);
+        out[i] = projection * view_for(poses[i].position, orientation);
+    }
+}
+
+void Camera::get_eye_view_projections(glm::mat4 out[2]) const
+{
+    const glm::mat4& view = get_view();
+    const float top = z_near * glm::tan(glm::radians(m_fovy) / 2.0f);
+    const float right = top * (m_screen_width / 2.0f) / m_screen_height;
+    // moves the frustum window toward the other eye by as much as the eye moved, scaled to the
+    // near plane
+    const float shear = m_ipd / 2.0f * z_near / m_convergence;
+
+    for (int eye = 0; eye < 2; ++eye)
+    {
+        // -1 for the left eye, +1 for the right
+        const float side = eye == 0 ? -1.0f : 1.0f;
+        const glm::mat4 projection = glm::frustum(-right - side * shear, right - side * shear,
+            -top, top, z_near, z_far);
+        // the eye is offset along the view's x axis, so its view just shifts the other way
+        const glm::mat4 eye_view = glm::translate(glm::mat4(1.0f),
+            glm::vec3(-side * m_ipd / 2.0f, 0.0f, 0.0f)) * view;
+        out[eye] = projection * eye_view;
+    }
+}
+
+void Camera::get_cube_face_view_projections(glm::mat4 out[6]) const
+{
+    static const glm::vec3 forward[6] =
+    {
+        glm::vec3( 1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f,  1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f,  1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+    };
+    // the cube map convention has t grow downward on the side faces
+    static const glm::vec3 up[6] =
+    {
+        glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f,  1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+        glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+    };
+
+    const glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, z_near, z_far);
+    for (int face = 0; face < 6; ++face)
+    {
+        out[face] = projection * glm::lookAt(m_position, m_position + forward[face], up[face]);
+    }
 }
 
 glm::vec3 Camera::position() const
 {
-    return glm::vec3(x, y, z);
+    return m_position;
+}
+
+const glm::vec3& Camera::direction() const
+{
+    update_basis();
+    return m_forward;
+}
+
+const glm::vec3& Camera::right() const
+{
+    update_basis();
+    return m_right;
 }
 
-glm::vec3 Camera::direction() const
+const glm::vec3& Camera::up() const
 {
-    glm::vec3 res;
-    res.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
-    res.y = sin(glm::radians(pitch));
-    res.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
-    res = glm::normalize(res);
-    return res;
+    update_basis();
+    return m_up;
+}
+
+float Camera::yaw() const
+{
+    return m_yaw;
+}
+
+float Camera::pitch() const
+{
+    return m_pitch;
+}
+
+float Camera::fovy() const
+{
+    return m_fovy;
+}
+
+float Camera::ipd() const
+{
+    return m_ipd;
+}
+
+float Camera::convergence() const
+{
+    return m_convergence;
+}
+
+void Camera::set_position(const glm::vec3& position)
+{
+    m_position = position;
+    m_view_dirty = true;
+}
+
+void Camera::set_orientation(float yaw_deg, float pitch_deg)
+{
+    m_yaw = yaw_deg;
+    m_pitch = glm::clamp(pitch_deg, -80.0f, 80.0f);
+    m_basis_dirty = true;
+}
+
+void Camera::set_fovy(float deg)
+{
+    m_fovy = deg;
+    m_projection_dirty = true;
+}
+
+void Camera::set_ipd(float ipd)
+{
+    m_ipd = ipd;
+}
+
+void Camera::set_convergence(float distance)
+{
+    m_convergence = distance;
 }
 
 void Camera::strafe_left(float d)
 {
-    const glm::vec3 left = glm::cross(global_up, direction());
-    const glm::vec3 movement = d * glm::normalize(left);
-    x += movement.x;
-    y += movement.y;
-    z += movement.z;
+    // right() is always horizontal, since pitch is applied before yaw
+    set_position(m_position - d * right());
 }
 
 void Camera::move_forward(float d)
 {
-    const glm::vec3 movement = direction() * d;
-    x += movement.x;
-    y += movement.y;
-    z += movement.z;
+    set_position(m_position + d * direction());
 }
 
 void Camera::pitch_up(float deg)
 {
-    pitch += deg;
-    pitch = glm::clamp(pitch, -80.0f, 80.0f);
+    set_orientation(m_yaw, m_pitch + deg);
 }
 
 void Camera::yaw_left(float deg)
 {
-    yaw += deg;
+    set_orientation(m_yaw + deg, m_pitch);
+}
+
+glm::quat Camera::orientation_for(float yaw_deg, float pitch_deg)
+{
+    // yaw is measured from +x toward +z, and -90 degrees looks down -z (the identity orientation)
+    const glm::quat yaw_rot = glm::angleAxis(-glm::radians(yaw_deg + 90.0f), global_up);
+    const glm::quat pitch_rot = glm::angleAxis(glm::radians(pitch_deg), local_right);
+    return yaw_rot * pitch_rot;
+}
+
+glm::mat4 Camera::view_for(const glm::vec3& position, const glm::quat& orientation)
+{
+    // the inverse of the camera's rigid transform: transposed rotation, then undo the translation
+    const glm::mat4 rotation = glm::mat4_cast(glm::conjugate(orientation));
+    return glm::translate(rotation, -position);
+}
+
+void Camera::update_basis() const
+{
+    if (!m_basis_dirty)
+    {
+        return;
+    }
+
+    m_orientation = orientation_for(m_yaw, m_pitch);
+    m_forward = m_orientation * local_forward;
+    m_right = m_orientation * local_right;
+    m_up = m_orientation * global_up;
+    m_basis_dirty = false;
+    m_view_dirty = true;
 }
 } // namespace camera
 } // namespace svm
@@ -1,17 +1,61 @@
 #pragma once
 
+#include <cstddef>
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 namespace svm
 {
 namespace camera
 {
-struct Camera
+// First-person camera whose orientation is a quaternion built from yaw and pitch. The basis
+// vectors, view and projection are cached and only rebuilt when something they depend on changes,
+// so querying them several times per frame costs nothing.
+class Camera
 {
-    glm::mat4 get_view_projection() const;
+public:
+    struct Pose
+    {
+        glm::vec3 position;
+        float yaw;      // degrees
+        float pitch;    // degrees
+    };
+
+    Camera();
+
+    const glm::mat4& get_view_projection() const;
+    const glm::mat4& get_view() const;
+    const glm::mat4& get_projection() const;
+
+    // View-projection for each pose with this camera's projection, e.g. for offline view sweeps
+    void get_view_projections(const Pose* poses, std::size_t count, glm::mat4* out) const;
+
+    // Left and right eye view-projections for side-by-side stereo. The eyes sit ipd apart along
+    // right() with parallel axes, and each frustum covers half the screen, sheared so both agree
+    // on objects at the convergence distance.
+    void get_eye_view_projections(glm::mat4 out[2]) const;
+
+    // 90 degree view-projections from position() through the six cube map faces, in GL's face
+    // order (+x, -x, +y, -y, +z, -z) and orientation, so rendering face i into cube map layer i
+    // gives a map that samples correctly. Ignores yaw and pitch.
+    void get_cube_face_view_projections(glm::mat4 out[6]) const;
 
     glm::vec3 position() const;
-    glm::vec3 direction() const;
+    const glm::vec3& direction() const;
+    const glm::vec3& right() const;
+    const glm::vec3& up() const;
+    float yaw() const;
+    float pitch() const;
+    float fovy() const;
+    float ipd() const;
+    float convergence() const;
+
+    void set_position(const glm::vec3& position);
+    void set_orientation(float yaw_deg, float pitch_deg);
+    void set_fovy(float deg);
+    // Both in scene units
+    void set_ipd(float ipd);
+    void set_convergence(float distance);
 
     void strafe_left(float d);
     void move_forward(float d);
@@ -21,18 +65,44 @@ struct Camera
     template <typename Int>
     void set_screen(Int width, Int height)
     {
-        screen_width = static_cast<float>(width);
-        screen_height = static_cast<float>(height);
+        const float w = static_cast<float>(width);
+        const float h = static_cast<float>(height);
+        if (w != m_screen_width || h != m_screen_height)
+        {
+            m_screen_width = w;
+            m_screen_height = h;
+            m_projection_dirty = true;
+        }
     }
 
-    float x;
-    float y;
-    float z;
-    float pitch;
-    float yaw = -90.0;
-    float screen_width = 600.0;
-    float screen_height = 400.0;
-    float fovy = 54.0;
+private:
+    static glm::quat orientation_for(float yaw_deg, float pitch_deg);
+    static glm::mat4 view_for(const glm::vec3& position, const glm::quat& orientation);
+
+    void update_basis() const;
+
+    // 16 byte aligned so the matrix products can use aligned SIMD loads
+    alignas(16) mutable glm::mat4 m_view;
+    alignas(16) mutable glm::mat4 m_projection;
+    alignas(16) mutable glm::mat4 m_view_projection;
+    mutable glm::quat m_orientation;
+    mutable glm::vec3 m_forward;
+    mutable glm::vec3 m_right;
+    mutable glm::vec3 m_up;
+
+    glm::vec3 m_position;
+    float m_yaw;
+    float m_pitch;
+    float m_fovy;
+    float m_ipd;
+    float m_convergence;
+    float m_screen_width;
+    float m_screen_height;
+
+    mutable bool m_basis_dirty;
+    mutable bool m_view_dirty;
+    mutable bool m_projection_dirty;
+    mutable bool m_view_projection_dirty;
 };
 } // namespace camera
 } // namespace svm
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <glm/trigonometric.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "depth_map.h"
+#include "image.h"
+#include "jobs.h"
+
+namespace
+{
+// x, y, z floats then red, green, blue
+constexpr const std::size_t PLY_VERTEX_BYTES = 3 * sizeof(float) + 3;
+// rows per job by default; small enough for idle workers to steal a share of the image
+constexpr const int DEFAULT_BAND_ROWS = 16;
+// point cloud rows built per write, enough to keep every worker busy
+constexpr const int ROWS_PER_WRITE = 256;
+
+// Ray parameter where a ray from c (t = 0) through wall (t = 1) leaves [0, extent], capped at the
+// rear wall
+float exit_t(float c, float wall, float extent)
+{
+    const float d = wall - c;
+    float t = 1.0f;
+    if (d < 0)
+    {
+        t = -c / d;
+    }
+    else if (d > 0)
+    {
+        t = (extent - c) / d;
+    }
+    return std::min(std::max(t, 0.0f), 1.0f);
+}
+
+int band_rows(unsigned num_bands, int num_rows)
+{
+    return (num_bands == 0) ? DEFAULT_BAND_ROWS
+        : (num_rows + static_cast<int>(num_bands) - 1) / static_cast<int>(num_bands);
+}
+} // anonymous namespace
+
+namespace svm
+{
+namespace depth
+{
+BoxModel make_box_model(const glm::vec2& top_left, const glm::vec2& bot_right, const glm::vec2& vanishing,
+    float fovy, float aspect, float rear_height)
+{
+    const float rear_width_view = (bot_right.x - top_left.x) * aspect;
+    const float rear_height_view = top_left.y - bot_right.y;
+    const float rear_width = rear_height * rear_width_view / rear_height_view;
+    const float degrees_from_floor = (vanishing.y - bot_right.y) / rear_height_view * fovy;
+
+    BoxModel box;
+    box.top_left = top_left;
+    box.bot_right = bot_right;
+    box.aspect = aspect;
+    box.rear_height = rear_height;
+    box.camera.x = (vanishing.x - top_left.x) * aspect / rear_width_view * rear_width;
+    box.camera.y = (vanishing.y - bot_right.y) / rear_height_view * rear_height;
+    box.camera.z = box.camera.y / std::tan(glm::radians(degrees_from_floor));
+    return box;
+}
+
+DepthMapper::DepthMapper(const BoxModel& box, int width, int height)
+    : m_width(width)
+    , m_height(height)
+    , m_camera(box.camera)
+    , m_wall_x()
+    , m_wall_y()
+    , m_col_depth()
+    , m_row_depth()
+{
+    const float rear_width_view = (box.bot_right.x - box.top_left.x) * box.aspect;
+    const float rear_height_view = box.top_left.y - box.bot_right.y;
+    if (width <= 0 || height <= 0 || rear_width_view <= 0 || rear_height_view <= 0)
+    {
+        throw std::runtime_error("depth map needs a non-empty image and rear wall");
+    }
+    if (!(box.camera.z > 0))
+    {
+        throw std::runtime_error("depth map needs the camera in front of the rear wall");
+    }
+
+    // scene units per view unit, where the image is aspect x 1 view units
+    const float scale = box.rear_height / rear_height_view;
+    const float rear_width = rear_width_view * scale;
+    // outside the box, rays toward the nearer walls would start past them and get no depth at all
+    if (!(box.camera.x >= 0 && box.camera.x <= rear_width && box.camera.y >= 0
+        && box.camera.y <= box.rear_height))
+    {
+        throw std::runtime_error("depth map needs the camera inside the box; move the vanishing point "
+            "onto the rear wall");
+    }
+
+    m_wall_x.resize(width);
+    m_col_depth.resize(width);
+    for (int x = 0; x < width; ++x)
+    {
+        m_wall_x[x] = ((x + 0.5f) / width - box.top_left.x) * box.aspect * scale;
+        m_col_depth[x] = box.camera.z * exit_t(box.camera.x, m_wall_x[x], rear_width);
+    }
+    m_wall_y.resize(height);
+    m_row_depth.resize(height);
+    for (int y = 0; y < height; ++y)
+    {
+        m_wall_y[y] = ((y + 0.5f) / height - box.bot_right.y) * scale;
+        m_row_depth[y] = box.camera.z * exit_t(box.camera.y, m_wall_y[y], box.rear_height);
+    }
+}
+
+int DepthMapper::width() const
+{
+    return m_width;
+}
+
+int DepthMapper::height() const
+{
+    return m_height;
+}
+
+void DepthMapper::compute(float* depth, unsigned num_bands) const
+{
+    jobs::JobSystem::instance().parallel_for(0, m_height, band_rows(num_bands, m_height),
+        [this, depth](int begin, int end)
+    {
+        compute_rows(depth + static_cast<std::size_t>(begin) * m_width, begin, end);
+    });
+}
+
+glm::vec3 DepthMapper::point(int x, int y, float depth) const
+{
+    const float t = depth / m_camera.z;
+    return glm::vec3(m_camera.x + t * (m_wall_x[x] - m_camera.x), m_camera.y + t * (m_wall_y[y] - m_camera.y),
+        m_camera.z - depth);
+}
+
+void DepthMapper::compute_rows(float* rows, int row_begin, int row_end) const
+{
+    const float* col_depth = m_col_depth.data();
+    for (int y = row_begin; y < row_end; ++y)
+    {
+        float* out = rows + static_cast<std::size_t>(y - row_begin) * m_width;
+        const float row_depth = m_row_depth[y];
+        int x = 0;
+#if defined(__SSE2__)
+        const __m128 row = _mm_set1_ps(row_depth);
+        for (; x + 4 <= m_width; x += 4)
+        {
+            _mm_storeu_ps(out + x, _mm_min_ps(row, _mm_loadu_ps(col_depth + x)));
+        }
+#elif defined(__ARM_NEON)
+        const float32x4_t row = vdupq_n_f32(row_depth);
+        for (; x + 4 <= m_width; x += 4)
+        {
+            vst1q_f32(out + x, vminq_f32(row, vld1q_f32(col_depth + x)));
+        }
+#endif
+        for (; x < m_width; ++x)
+        {
+            out[x] = std::min(row_depth, col_depth[x]);
+        }
+    }
+}
+
+void write_pfm(const char* path, const float* depth, int width, int height)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        throw std::runtime_error(std::string("could not open file: ") + path);
+    }
+    // a negative scale marks little endian samples; rows go bottom to top
+    out << "Pf\n" << width << ' ' << height << "\n-1.0\n";
+    out.write(reinterpret_cast<const char*>(depth),
+        static_cast<std::streamsize>(sizeof(float) * width * static_cast<std::size_t>(height)));
+    if (!out)
+    {
+        throw std::runtime_error(std::string("could not write file: ") + path);
+    }
+}
+
+void write_point_cloud(const char* path, const DepthMapper& mapper, const float* depth,
+    const unsigned char* pixels, int num_channels, unsigned num_bands)
+{
+    if (num_channels != 3 && num_channels != 4)
+    {
+        throw std::runtime_error("point cloud colors need 3 or 4 channels");
+    }
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        throw std::runtime_error(std::string("could not open file: ") + path);
+    }
+
+    const int width = mapper.width();
+    const int height = mapper.height();
+    out << "ply\nformat binary_little_endian 1.0\n"
+        << "element vertex " << static_cast<std::size_t>(width) * height << "\n"
+        << "property float x\nproperty float y\nproperty float z\n"
+        << "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+        << "end_header\n";
+
+    const int rows_per_write = std::min(height, ROWS_PER_WRITE);
+    const int grain = band_rows(num_bands, rows_per_write);
+    const std::size_t row_bytes = PLY_VERTEX_BYTES * width;
+    std::vector<char> band(row_bytes * rows_per_write);
+
+    for (int band_begin = 0; band_begin < height; band_begin += rows_per_write)
+    {
+        const int band_end = std::min(height, band_begin + rows_per_write);
+        jobs::JobSystem::instance().parallel_for(band_begin, band_end, grain, [&](int begin, int end)
+        {
+            for (int y = begin; y < end; ++y)
+            {
+                const std::size_t offset = static_cast<std::size_t>(y) * width;
+                const unsigned char* rgb = pixels + offset * num_channels;
+                char* vert = band.data() + (y - band_begin) * row_bytes;
+                for (int x = 0; x < width; ++x, rgb += num_channels, vert += PLY_VERTEX_BYTES)
+                {
+                    // the host is little endian, like the file
+                    const glm::vec3 p = mapper.point(x, y, depth[offset + x]);
+                    const float xyz[3] = { p.x, p.y, p.z };
+                    std::memcpy(vert, xyz, sizeof(xyz));
+                    std::memcpy(vert + sizeof(xyz), rgb, 3);
+                }
+            }
+        });
+        out.write(band.data(), static_cast<std::streamsize>(row_bytes * (band_end - band_begin)));
+    }
+    if (!out)
+    {
+        throw std::runtime_error(std::string("could not write file: ") + path);
+    }
+}
+
+void export_depth(const BoxModel& box, const char* image_path, const char* depth_path,
+    const char* cloud_path, const undistort::Undistorter* undistorter)
+{
+    image::Image img = image::decode_file(image_path);
+    if (undistorter)
+    {
+        img = undistorter->apply(img);
+    }
+    const DepthMapper mapper(box, img.width, img.height);
+    std::vector<float> depth(static_cast<std::size_t>(img.width) * img.height);
+    mapper.compute(depth.data());
+
+    if (depth_path)
+    {
+        write_pfm(depth_path, depth.data(), img.width, img.height);
+    }
+    if (cloud_path)
+    {
+        write_point_cloud(cloud_path, mapper, depth.data(), img.pixels.get(), img.num_channels);
+    }
+}
+} // namespace depth
+} // namespace svm
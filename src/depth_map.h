@@ -0,0 +1,86 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <vector>
+
+#include "undistort.h"
+
+namespace svm
+{
+namespace depth
+{
+// The box as the photo sees it, from Background::calculate_box_3d. Box coordinates put the rear
+// wall's lower-left corner at the origin, with the wall rear_height tall in the z = 0 plane and
+// the room extending towards +z, where the camera is.
+struct BoxModel
+{
+    // rear wall corners in texture coords (0 to 1, v up)
+    glm::vec2 top_left;
+    glm::vec2 bot_right;
+    // image width / height
+    float aspect = 1;
+    float rear_height = 20;
+    glm::vec3 camera;
+};
+
+// The box Background::set_user_params builds from the rear wall corners and vanishing point (texture
+// coords), the vertical field of view in degrees and the image's width / height
+BoxModel make_box_model(const glm::vec2& top_left, const glm::vec2& bot_right, const glm::vec2& vanishing,
+    float fovy, float aspect, float rear_height = 20);
+
+// Depth of every image pixel under the box model. The photo is treated as a pinhole view from the
+// camera through the rear wall's plane, so each pixel's ray leaves the box through the rear wall
+// or whichever side wall, floor or ceiling it reaches first. Which one only depends on the column
+// for the side walls and on the row for the floor and ceiling, so a pixel's depth is the smaller
+// of a per-column and a per-row value.
+class DepthMapper
+{
+public:
+    // width x height is the image's full size. Throws if the camera isn't in front of the rear wall
+    // and within its width and height, i.e. if the vanishing point is off the rear wall.
+    DepthMapper(const BoxModel& box, int width, int height);
+
+    int width() const;
+    int height() const;
+
+    // Fills width x height floats, bottom-up rows like image::Image, with the distance from the
+    // camera along the view axis (-z). Rows are split into num_bands bands that run on the shared
+    // job system, 0 picking a few rows per band.
+    void compute(float* depth, unsigned num_bands = 0) const;
+    // Rows [row_begin, row_end) only, on the calling thread; rows points at row_begin's first float
+    void compute_rows(float* rows, int row_begin, int row_end) const;
+
+    // Box coordinates of pixel (x, y), bottom-up, at the given depth
+    glm::vec3 point(int x, int y, float depth) const;
+
+private:
+    int m_width;
+    int m_height;
+    glm::vec3 m_camera;
+    // where each column's and row's ray crosses the rear wall's plane
+    std::vector<float> m_wall_x;
+    std::vector<float> m_wall_y;
+    // the most depth each column's and row's ray can have before it leaves the box
+    std::vector<float> m_col_depth;
+    std::vector<float> m_row_depth;
+};
+
+// Portable float map, bottom-up rows as compute() writes them. Throws on failure.
+void write_pfm(const char* path, const float* depth, int width, int height);
+
+// Binary little endian PLY with a float x, y, z and uchar red, green, blue vertex per pixel, in
+// box coordinates. pixels are the image's bottom-up rows with 3 or 4 channels. Points are built a
+// few hundred rows at a time on the job system (num_bands as for compute()) and streamed to the
+// file, so memory use doesn't grow with the image. Throws on failure.
+void write_point_cloud(const char* path, const DepthMapper& mapper, const float* depth,
+    const unsigned char* pixels, int num_channels, unsigned num_bands = 0);
+
+// Decodes the image at full size and writes its depth map and point cloud; either path may be null
+// to skip that output. With an undistorter the cloud takes its colors from the corrected image,
+// which is the one the box was placed on. Throws on failure. Takes a while for a photo, so the
+// GL thread runs it through the job system.
+void export_depth(const BoxModel& box, const char* image_path, const char* depth_path,
+    const char* cloud_path, const undistort::Undistorter* undistorter = nullptr);
+} // namespace depth
+} // namespace svm
@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "edge_snap.h"
+
+namespace
+{
+// |g| of a 3x3 Sobel on 8-bit input is at most 4 * 255
+constexpr const float MAX_GRADIENT = 1020.0f;
+// weakest gradient that still counts as an edge pixel
+constexpr const int EDGE_THRESHOLD = 80;
+// shortest run of edge pixels kept as a segment, in pixels of its level
+constexpr const int MIN_SEGMENT_LENGTH = 6;
+// gaps up to this long don't split a segment
+constexpr const int MAX_SEGMENT_GAP = 2;
+// fraction of the queried line that edges must cover for a snap
+constexpr const float MIN_SUPPORT = 0.2f;
+
+using Image = svm::image::Image;
+using Gradient = svm::edges::Gradient;
+
+// Bottom-up RGB(A) to top-down luma; gray and gray-alpha images use their first channel as is
+std::vector<std::uint8_t> to_gray(const Image& img)
+{
+    std::vector<std::uint8_t> gray(static_cast<std::size_t>(img.width) * img.height);
+    const unsigned char* src = img.pixels.get();
+    const bool is_color = img.num_channels >= 3;
+    for (int y = 0; y < img.height; ++y)
+    {
+        const unsigned char* row = src + static_cast<std::size_t>(img.height - 1 - y) * img.width * img.num_channels;
+        std::uint8_t* dst = gray.data() + static_cast<std::size_t>(y) * img.width;
+        for (int x = 0; x < img.width; ++x, row += img.num_channels)
+        {
+            dst[x] = is_color ? static_cast<std::uint8_t>((77 * row[0] + 150 * row[1] + 29 * row[2]) >> 8)
+                : row[0];
+        }
+    }
+    return gray;
+}
+
+// 2x2 box filter; odd trailing rows and columns are dropped
+std::vector<std::uint8_t> half_size(const std::vector<std::uint8_t>& src, int& width, int& height)
+{
+    const int half_w = std::max(1, width / 2);
+    const int half_h = std::max(1, height / 2);
+    std::vector<std::uint8_t> dst(static_cast<std::size_t>(half_w) * half_h);
+    for (int y = 0; y < half_h; ++y)
+    {
+        const std::uint8_t* r0 = src.data() + static_cast<std::size_t>(std::min(2 * y, height - 1)) * width;
+        const std::uint8_t* r1 = src.data() + static_cast<std::size_t>(std::min(2 * y + 1, height - 1)) * width;
+        for (int x = 0; x < half_w; ++x)
+        {
+            const int x0 = std::min(2 * x, width - 1);
+            const int x1 = std::min(2 * x + 1, width - 1);
+            dst[static_cast<std::size_t>(y) * half_w + x] =
+                static_cast<std::uint8_t>((r0[x0] + r0[x1] + r1[x0] + r1[x1] + 2) >> 2);
+        }
+    }
+    width = half_w;
+    height = half_h;
+    return dst;
+}
+
+void sobel_scalar(const std::uint8_t* up, const std::uint8_t* mid, const std::uint8_t* down, int x,
+    std::int16_t* gx, std::int16_t* gy)
+{
+    gx[x] = static_cast<std::int16_t>((up[x + 1] + 2 * mid[x + 1] + down[x + 1]) - (up[x - 1] + 2 * mid[x - 1] + down[x - 1]));
+    gy[x] = static_cast<std::int16_t>((down[x - 1] + 2 * down[x] + down[x + 1]) - (up[x - 1] + 2 * up[x] + up[x + 1]));
+}
+
+// Keeps runs of pixels accepted by `is_edge` along one line as segments. `strength_at` is the
+// gradient magnitude across the edge.
+template <class IsEdge, class Strength, class Emit>
+void collect_runs(int length, IsEdge is_edge, Strength strength_at, Emit emit)
+{
+    int begin = -1;
+    int last = -1;
+    int sum = 0;
+    for (int i = 0; i <= length; ++i)
+    {
+        const bool edge = i < length && is_edge(i);
+        if (edge)
+        {
+            if (begin < 0)
+            {
+                begin = i;
+                sum = 0;
+            }
+            last = i;
+            sum += strength_at(i);
+        }
+        else if (begin >= 0 && (i == length || i - last > MAX_SEGMENT_GAP))
+        {
+            if (last - begin + 1 >= MIN_SEGMENT_LENGTH)
+            {
+                emit(begin, last + 1, sum / ((last - begin + 1) * MAX_GRADIENT));
+            }
+            begin = -1;
+        }
+    }
+}
+
+template <class Buckets>
+bool snap(const Buckets& buckets, float pos, float begin, float end, float radius, float& snapped)
+{
+    if (end < begin)
+    {
+        std::swap(begin, end);
+    }
+    const float span = end - begin;
+    if (span <= 0 || buckets.empty())
+    {
+        return false;
+    }
+
+    const int first = std::max(0, static_cast<int>(std::floor(pos - radius)));
+    const int last = std::min(static_cast<int>(buckets.size()) - 1, static_cast<int>(std::ceil(pos + radius)));
+    float best_score = 0;
+    for (int i = first; i <= last; ++i)
+    {
+        float covered = 0;
+        float support = 0;
+        for (const svm::edges::EdgeIndex::Segment& seg: buckets[i])
+        {
+            const float overlap = std::min(end, seg.end) - std::max(begin, seg.begin);
+            if (overlap > 0)
+            {
+                covered += overlap;
+                support += overlap * seg.strength;
+            }
+        }
+        if (covered < MIN_SUPPORT * span)
+        {
+            continue;
+        }
+        // prefer strong edges, then the ones closest to where the user is dragging
+        const float score = support / span * (1.0f - 0.5f * std::abs(i - pos) / (radius + 1.0f));
+        if (score > best_score)
+        {
+            best_score = score;
+            snapped = static_cast<float>(i);
+        }
+    }
+    return best_score > 0;
+}
+} // anonymous namespace
+
+namespace svm
+{
+namespace edges
+{
+void sobel(const std::uint8_t* gray, int width, int height, Gradient& out)
+{
+    out.width = width;
+    out.height = height;
+    out.gx.assign(static_cast<std::size_t>(width) * height, 0);
+    out.gy.assign(static_cast<std::size_t>(width) * height, 0);
+    if (width < 3 || height < 3)
+    {
+        return;
+    }
+
+    for (int y = 1; y < height - 1; ++y)
+    {
+        const std::uint8_t* up = gray + static_cast<std::size_t>(y - 1) * width;
+        const std::uint8_t* mid = up + width;
+        const std::uint8_t* down = mid + width;
+        std::int16_t* gx = out.gx.data() + static_cast<std::size_t>(y) * width;
+        std::int16_t* gy = out.gy.data() + static_cast<std::size_t>(y) * width;
+
+        int x = 1;
+        // 8 pixels at a time in 16-bit lanes; each load reads x - 1 .. x + 8
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        const auto load = [zero](const std::uint8_t* p)
+        {
+            return _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), zero);
+        };
+        for (; x + 9 <= width; x += 8)
+        {
+            const __m128i a0 = load(up + x - 1), a1 = load(up + x), a2 = load(up + x + 1);
+            const __m128i b0 = load(mid + x - 1), b2 = load(mid + x + 1);
+            const __m128i c0 = load(down + x - 1), c1 = load(down + x), c2 = load(down + x + 1);
+            const __m128i right = _mm_add_epi16(_mm_add_epi16(a2, c2), _mm_slli_epi16(b2, 1));
+            const __m128i left = _mm_add_epi16(_mm_add_epi16(a0, c0), _mm_slli_epi16(b0, 1));
+            const __m128i bottom = _mm_add_epi16(_mm_add_epi16(c0, c2), _mm_slli_epi16(c1, 1));
+            const __m128i top = _mm_add_epi16(_mm_add_epi16(a0, a2), _mm_slli_epi16(a1, 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(gx + x), _mm_sub_epi16(right, left));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(gy + x), _mm_sub_epi16(bottom, top));
+        }
+#elif defined(__ARM_NEON)
+        const auto load = [](const std::uint8_t* p)
+        {
+            return vreinterpretq_s16_u16(vmovl_u8(vld1_u8(p)));
+        };
+        for (; x + 9 <= width; x += 8)
+        {
+            const int16x8_t a0 = load(up + x - 1), a1 = load(up + x), a2 = load(up + x + 1);
+            const int16x8_t b0 = load(mid + x - 1), b2 = load(mid + x + 1);
+            const int16x8_t c0 = load(down + x - 1), c1 = load(down + x), c2 = load(down + x + 1);
+            const int16x8_t right = vaddq_s16(vaddq_s16(a2, c2), vshlq_n_s16(b2, 1));
+            const int16x8_t left = vaddq_s16(vaddq_s16(a0, c0), vshlq_n_s16(b0, 1));
+            const int16x8_t bottom = vaddq_s16(vaddq_s16(c0, c2), vshlq_n_s16(c1, 1));
+            const int16x8_t top = vaddq_s16(vaddq_s16(a0, a2), vshlq_n_s16(a1, 1));
+            vst1q_s16(gx + x, vsubq_s16(right, left));
+            vst1q_s16(gy + x, vsubq_s16(bottom, top));
+        }
+#endif
+        for (; x < width - 1; ++x)
+        {
+            sobel_scalar(up, mid, down, x, gx, gy);
+        }
+    }
+}
+
+std::shared_ptr<const EdgeIndex> EdgeIndex::build(const image::Image& img, int max_height)
+{
+    int width = img.width;
+    int height = img.height;
+    std::vector<std::uint8_t> gray = to_gray(img);
+    while (max_height > 0 && height > max_height && height > 1)
+    {
+        gray = half_size(gray, width, height);
+    }
+
+    std::shared_ptr<EdgeIndex> index(new EdgeIndex(width, height));
+    Gradient grad;
+    sobel(gray.data(), width, height, grad);
+    index->add_segments(grad, 1);
+
+    gray = half_size(gray, width, height);
+    sobel(gray.data(), width, height, grad);
+    index->add_segments(grad, 2);
+    return index;
+}
+
+EdgeIndex::EdgeIndex(int width, int height)
+    : m_width(width)
+    , m_height(height)
+    , m_num_segments(0)
+    , m_rows(height)
+    , m_cols(width)
+{}
+
+int EdgeIndex::width() const
+{
+    return m_width;
+}
+
+int EdgeIndex::height() const
+{
+    return m_height;
+}
+
+std::size_t EdgeIndex::num_segments() const
+{
+    return m_num_segments;
+}
+
+void EdgeIndex::add_segments(const Gradient& grad, int scale)
+{
+    const int w = grad.width;
+    const int h = grad.height;
+    const auto gx = [&grad, w](int x, int y) { return std::abs(static_cast<int>(grad.gx[static_cast<std::size_t>(y) * w + x])); };
+    const auto gy = [&grad, w](int x, int y) { return std::abs(static_cast<int>(grad.gy[static_cast<std::size_t>(y) * w + x])); };
+    // a coarse pixel's center in the finest level's coordinates
+    const auto to_index = [scale](int p) { return (p + 0.5f) * scale - 0.5f; };
+
+    // horizontal edges: strong, mostly vertical gradient that peaks across the edge
+    for (int y = 1; y < h - 1; ++y)
+    {
+        const int bucket = std::min(m_height - 1, static_cast<int>(std::lround(to_index(y))));
+        collect_runs(w, [&](int x)
+        {
+            const int g = gy(x, y);
+            return g >= EDGE_THRESHOLD && g > 2 * gx(x, y) && g >= gy(x, y - 1) && g > gy(x, y + 1);
+        }, [&](int x)
+        {
+            return gy(x, y);
+        }, [&](int begin, int end, float strength)
+        {
+            m_rows[bucket].push_back({ to_index(begin), to_index(end), strength });
+            ++m_num_segments;
+        });
+    }
+
+    // vertical edges, the same with the axes swapped
+    for (int x = 1; x < w - 1; ++x)
+    {
+        const int bucket = std::min(m_width - 1, static_cast<int>(std::lround(to_index(x))));
+        collect_runs(h, [&](int y)
+        {
+            const int g = gx(x, y);
+            return g >= EDGE_THRESHOLD && g > 2 * gy(x, y) && g >= gx(x - 1, y) && g > gx(x + 1, y);
+        }, [&](int y)
+        {
+            return gx(x, y);
+        }, [&](int begin, int end, float strength)
+        {
+            m_cols[bucket].push_back({ to_index(begin), to_index(end), strength });
+            ++m_num_segments;
+        });
+    }
+}
+
+bool EdgeIndex::snap_horizontal(float y, float x0, float x1, float radius, float& snapped) const
+{
+    return snap(m_rows, y, x0, x1, radius, snapped);
+}
+
+bool EdgeIndex::snap_vertical(float x, float y0, float y1, float radius, float& snapped) const
+{
+    return snap(m_cols, x, y0, y1, radius, snapped);
+}
+} // namespace edges
+} // namespace svm
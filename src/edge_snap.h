@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "image.h"
+
+namespace svm
+{
+namespace edges
+{
+// Horizontal and vertical Sobel responses of an 8-bit grayscale image; the one pixel border is 0
+struct Gradient
+{
+    int width = 0;
+    int height = 0;
+    std::vector<std::int16_t> gx;
+    std::vector<std::int16_t> gy;
+};
+
+void sobel(const std::uint8_t* gray, int width, int height, Gradient& out);
+
+// Straight runs of strong, roughly axis-aligned image edges, bucketed by row (horizontal edges) and
+// column (vertical edges) so that snapping an edge of the rear wall only looks at the few buckets
+// within reach. Coordinates are pixels of the analysed image, top-down.
+class EdgeIndex
+{
+public:
+    struct Segment
+    {
+        float begin;
+        float end;
+        float strength;     // mean gradient magnitude, 0..1
+    };
+
+    // Builds a grayscale pyramid of the image down to the first level at most max_height rows
+    // tall (0 keeps full size), and collects edge segments from that level and the next coarser
+    // one, so soft edges that only show up at the coarser scale still count
+    static std::shared_ptr<const EdgeIndex> build(const image::Image& img, int max_height);
+
+    int width() const;
+    int height() const;
+    std::size_t num_segments() const;
+
+    // Looks for the row within `radius` of y whose edges best support a line from x0 to x1, and
+    // returns false if none covers enough of it. Doesn't allocate; cost is linear in the radius.
+    bool snap_horizontal(float y, float x0, float x1, float radius, float& snapped) const;
+    // Same for a vertical line at x from y0 to y1
+    bool snap_vertical(float x, float y0, float y1, float radius, float& snapped) const;
+
+private:
+    EdgeIndex(int width, int height);
+
+    void add_segments(const Gradient& grad, int scale);
+
+    int m_width;
+    int m_height;
+    std::size_t m_num_segments;
+    std::vector<std::vector<Segment>> m_rows;
+    std::vector<std::vector<Segment>> m_cols;
+};
+} // namespace edges
+} // namespace svm
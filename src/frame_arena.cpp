@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "frame_arena.h"
+
+namespace svm
+{
+namespace tools
+{
+constexpr const std::size_t FrameArena::DEFAULT_CAPACITY;
+
+FrameArena::FrameArena(std::size_t capacity)
+    : m_block(new unsigned char[capacity])
+    , m_capacity(capacity)
+    , m_offset(0)
+    , m_high_water(0)
+{}
+
+void* FrameArena::allocate(std::size_t bytes, std::size_t alignment)
+{
+    const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(m_block.get());
+    const std::uintptr_t aligned = (base + m_offset + alignment - 1) & ~(alignment - 1);
+    const std::size_t new_offset = aligned - base + bytes;
+    if (new_offset > m_capacity)
+    {
+        throw std::bad_alloc();
+    }
+
+    m_offset = new_offset;
+    m_high_water = std::max(m_high_water, m_offset);
+    return reinterpret_cast<void*>(aligned);
+}
+
+void FrameArena::reset()
+{
+    m_offset = 0;
+}
+
+std::size_t FrameArena::used() const
+{
+    return m_offset;
+}
+
+std::size_t FrameArena::capacity() const
+{
+    return m_capacity;
+}
+
+std::size_t FrameArena::high_water_mark() const
+{
+    return m_high_water;
+}
+} // namespace tools
+} // namespace svm
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace svm
+{
+namespace tools
+{
+// Bump allocator for data that only lives until the end of the frame. Memory is reserved once up
+// front; allocate() just advances an offset and reset() releases everything at once.
+// Destructors are never run, so only use it for trivially destructible types.
+class FrameArena
+{
+public:
+    static constexpr const std::size_t DEFAULT_CAPACITY = 256 * 1024;
+
+    explicit FrameArena(std::size_t capacity = DEFAULT_CAPACITY);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Throws std::bad_alloc if the frame needs more than the arena's capacity
+    void* allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t));
+
+    template <class T>
+    T* allocate_array(std::size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena never runs destructors");
+        T* res = static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            new (&res[i]) T();
+        }
+        return res;
+    }
+
+    void reset();
+
+    std::size_t used() const;
+    std::size_t capacity() const;
+    std::size_t high_water_mark() const;
+
+private:
+    std::unique_ptr<unsigned char[]> m_block;
+    std::size_t m_capacity;
+    std::size_t m_offset;
+    std::size_t m_high_water;
+};
+} // namespace tools
+} // namespace svm
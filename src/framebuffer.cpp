@@ -0,0 +1,322 @@
+#include <stdexcept>
+#include <string>
+
+#include "framebuffer.h"
+
+namespace
+{
+// Books an attachment with the registry, updating the entry it already has in place
+void book(svm::resources::Tracked& mem, bool booked, svm::resources::Kind kind, std::size_t bytes)
+{
+    if (booked)
+    {
+        mem.resize(bytes);
+    }
+    else
+    {
+        mem = svm::resources::Tracked(kind, bytes);
+    }
+}
+} // anonymous namespace
+
+namespace svm
+{
+namespace framebuffer
+{
+Framebuffer::Framebuffer(GLenum color_format)
+    : m_color_format(color_format)
+    , m_fbo(0)
+    , m_color_tex(0)
+    , m_depth_rbo(0)
+    , m_width(0)
+    , m_height(0)
+    , m_color_mem()
+    , m_depth_mem()
+{}
+
+Framebuffer::Framebuffer(Framebuffer&& other)
+    : m_color_format(other.m_color_format)
+    , m_fbo(other.m_fbo)
+    , m_color_tex(other.m_color_tex)
+    , m_depth_rbo(other.m_depth_rbo)
+    , m_width(other.m_width)
+    , m_height(other.m_height)
+    , m_color_mem(std::move(other.m_color_mem))
+    , m_depth_mem(std::move(other.m_depth_mem))
+{
+    other.m_fbo = 0;
+    other.m_color_tex = 0;
+    other.m_depth_rbo = 0;
+    other.m_width = 0;
+    other.m_height = 0;
+}
+
+Framebuffer& Framebuffer::operator=(Framebuffer&& other)
+{
+    destroy();
+    m_color_format = other.m_color_format;
+    m_fbo = other.m_fbo;
+    m_color_tex = other.m_color_tex;
+    m_depth_rbo = other.m_depth_rbo;
+    m_width = other.m_width;
+    m_height = other.m_height;
+    m_color_mem = std::move(other.m_color_mem);
+    m_depth_mem = std::move(other.m_depth_mem);
+    other.m_fbo = 0;
+    other.m_color_tex = 0;
+    other.m_depth_rbo = 0;
+    other.m_width = 0;
+    other.m_height = 0;
+    return *this;
+}
+
+int Framebuffer::width() const
+{
+    return static_cast<int>(m_width);
+}
+
+int Framebuffer::height() const
+{
+    return static_cast<int>(m_height);
+}
+
+void Framebuffer::resize(int width, int height)
+{
+    if (m_fbo != 0 && width == m_width && height == m_height)
+    {
+        return;
+    }
+
+    // the attachments are booked exactly while they exist
+    const bool booked = (m_fbo != 0);
+    destroy(true);
+    m_width = width;
+    m_height = height;
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+
+    glGenTextures(1, &m_color_tex);
+    glBindTexture(GL_TEXTURE_2D, m_color_tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, m_color_format, width, height, 0, GL_RGBA,
+        m_color_format == GL_RGBA8 ? GL_UNSIGNED_BYTE : GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_color_tex, 0);
+    // texture_bytes() counts channels as bytes, so pass bytes per pixel
+    const int color_bytes = m_color_format == GL_RGBA32F ? 16 : m_color_format == GL_RGBA16F ? 8 : 4;
+    book(m_color_mem, booked, resources::Kind::texture, resources::texture_bytes(width, height, color_bytes, false));
+
+    glGenRenderbuffers(1, &m_depth_rbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depth_rbo);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depth_rbo);
+    // DEPTH24 is stored padded to 32 bits
+    book(m_depth_mem, booked, resources::Kind::renderbuffer, resources::texture_bytes(width, height, 4, false));
+
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        destroy();
+        throw std::runtime_error("incomplete framebuffer: " + std::to_string(status));
+    }
+}
+
+void Framebuffer::bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+}
+
+void Framebuffer::bind_color_texture(GLenum unit)
+{
+    glActiveTexture(unit);
+    glBindTexture(GL_TEXTURE_2D, m_color_tex);
+}
+
+void Framebuffer::blit_to_default(int src_width, int src_height, int dst_width, int dst_height)
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, src_width, src_height, 0, 0, dst_width, dst_height,
+        GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, dst_width, dst_height);
+}
+
+void Framebuffer::read_pixels(int width, int height, unsigned char* rgba)
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::destroy(bool keep_booked)
+{
+    if (m_fbo != 0)
+    {
+        glDeleteFramebuffers(1, &m_fbo);
+        glDeleteTextures(1, &m_color_tex);
+        glDeleteRenderbuffers(1, &m_depth_rbo);
+        m_fbo = 0;
+        m_color_tex = 0;
+        m_depth_rbo = 0;
+        if (!keep_booked)
+        {
+            m_color_mem.reset();
+            m_depth_mem.reset();
+        }
+    }
+}
+
+Framebuffer::~Framebuffer()
+{
+    destroy();
+}
+
+CubeFramebuffer::CubeFramebuffer()
+    : m_fbo(0)
+    , m_color_tex(0)
+    , m_depth_tex(0)
+    , m_face_size(0)
+    , m_color_mem()
+    , m_depth_mem()
+{}
+
+CubeFramebuffer::CubeFramebuffer(CubeFramebuffer&& other)
+    : m_fbo(other.m_fbo)
+    , m_color_tex(other.m_color_tex)
+    , m_depth_tex(other.m_depth_tex)
+    , m_face_size(other.m_face_size)
+    , m_color_mem(std::move(other.m_color_mem))
+    , m_depth_mem(std::move(other.m_depth_mem))
+{
+    other.m_fbo = 0;
+    other.m_color_tex = 0;
+    other.m_depth_tex = 0;
+    other.m_face_size = 0;
+}
+
+CubeFramebuffer& CubeFramebuffer::operator=(CubeFramebuffer&& other)
+{
+    destroy();
+    m_fbo = other.m_fbo;
+    m_color_tex = other.m_color_tex;
+    m_depth_tex = other.m_depth_tex;
+    m_face_size = other.m_face_size;
+    m_color_mem = std::move(other.m_color_mem);
+    m_depth_mem = std::move(other.m_depth_mem);
+    other.m_fbo = 0;
+    other.m_color_tex = 0;
+    other.m_depth_tex = 0;
+    other.m_face_size = 0;
+    return *this;
+}
+
+int CubeFramebuffer::face_size() const
+{
+    return static_cast<int>(m_face_size);
+}
+
+void CubeFramebuffer::resize(int face_size)
+{
+    if (m_fbo != 0 && face_size == m_face_size)
+    {
+        return;
+    }
+
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_CUBE_MAP_TEXTURE_SIZE, &max_size);
+    if (face_size <= 0 || face_size > max_size)
+    {
+        throw std::runtime_error("cube map face size " + std::to_string(face_size)
+            + " not supported (max " + std::to_string(max_size) + ")");
+    }
+
+    const bool booked = (m_fbo != 0);
+    destroy(true);
+    m_face_size = face_size;
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+
+    const auto make_cube = [face_size](GLuint& tex, GLint internal_format, GLenum format, GLenum type)
+    {
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, tex);
+        for (int face = 0; face < 6; ++face)
+        {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, internal_format, face_size, face_size,
+                0, format, type, NULL);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    };
+    const std::size_t face_bytes = resources::texture_bytes(face_size, face_size, 4, false);
+
+    make_cube(m_color_tex, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_color_tex, 0);
+    book(m_color_mem, booked, resources::Kind::texture, 6 * face_bytes);
+
+    // layered targets need every attachment layered, so depth is a cube map too
+    make_cube(m_depth_tex, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depth_tex, 0);
+    book(m_depth_mem, booked, resources::Kind::texture, 6 * face_bytes);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        destroy();
+        throw std::runtime_error("incomplete cube map framebuffer: " + std::to_string(status));
+    }
+}
+
+void CubeFramebuffer::bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, m_face_size, m_face_size);
+}
+
+void CubeFramebuffer::read_faces(unsigned char* rgba)
+{
+    const std::size_t face_bytes = resources::texture_bytes(m_face_size, m_face_size, 4, false);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_color_tex);
+    for (int face = 0; face < 6; ++face)
+    {
+        glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+            rgba + face * face_bytes);
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
+
+void CubeFramebuffer::destroy(bool keep_booked)
+{
+    if (m_fbo != 0)
+    {
+        glDeleteFramebuffers(1, &m_fbo);
+        glDeleteTextures(1, &m_color_tex);
+        glDeleteTextures(1, &m_depth_tex);
+        m_fbo = 0;
+        m_color_tex = 0;
+        m_depth_tex = 0;
+        if (!keep_booked)
+        {
+            m_color_mem.reset();
+            m_depth_mem.reset();
+        }
+    }
+}
+
+CubeFramebuffer::~CubeFramebuffer()
+{
+    destroy();
+}
+} // namespace framebuffer
+} // namespace svm
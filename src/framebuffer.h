@@ -0,0 +1,96 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "resource_registry.h"
+
+namespace svm
+{
+namespace framebuffer
+{
+// Offscreen render target with a color texture and a depth renderbuffer
+class Framebuffer
+{
+public:
+    // color_format is GL_RGBA8, GL_RGBA16F or GL_RGBA32F
+    explicit Framebuffer(GLenum color_format = GL_RGBA8);
+
+    Framebuffer(const Framebuffer&) = delete;
+    Framebuffer& operator=(const Framebuffer&) = delete;
+
+    Framebuffer(Framebuffer&&);
+    Framebuffer& operator=(Framebuffer&&);
+
+    int width() const;
+    int height() const;
+
+    // (Re)allocates the attachments if the size changed; a no-op otherwise. Once allocated, the
+    // attachments stay booked with the resource registry under the same entries, so resizing doesn't
+    // allocate on the host and may happen in the middle of a frame.
+    void resize(int width, int height);
+    void bind();
+    // Binds the color attachment for sampling
+    void bind_color_texture(GLenum unit);
+
+    // Copies the lower-left src_width x src_height region of the color attachment onto the whole
+    // default framebuffer, which is left bound with a matching viewport
+    void blit_to_default(int src_width, int src_height, int dst_width, int dst_height);
+
+    // Reads back the lower-left width x height region as bottom-up RGBA rows
+    void read_pixels(int width, int height, unsigned char* rgba);
+
+    ~Framebuffer();
+
+private:
+    // Deletes the GL objects; unless keep_booked, also drops their registrations
+    void destroy(bool keep_booked = false);
+
+    GLenum m_color_format;
+    GLuint m_fbo;
+    GLuint m_color_tex;
+    GLuint m_depth_rbo;
+    GLsizei m_width;
+    GLsizei m_height;
+    resources::Tracked m_color_mem;
+    resources::Tracked m_depth_mem;
+};
+
+// Layered render target with a cube map color texture and a cube map depth texture, so a geometry
+// shader can route each primitive to a face with gl_Layer and all six faces render in one pass
+class CubeFramebuffer
+{
+public:
+    CubeFramebuffer();
+
+    CubeFramebuffer(const CubeFramebuffer&) = delete;
+    CubeFramebuffer& operator=(const CubeFramebuffer&) = delete;
+
+    CubeFramebuffer(CubeFramebuffer&&);
+    CubeFramebuffer& operator=(CubeFramebuffer&&);
+
+    int face_size() const;
+
+    // (Re)allocates the faces if the size changed; throws beyond GL_MAX_CUBE_MAP_TEXTURE_SIZE
+    void resize(int face_size);
+    // Binds the target with a viewport covering one face
+    void bind();
+
+    // Reads back all six faces as RGBA in GL's face order. Rows of each face run in order of
+    // increasing t, as the cube map lookup addresses them.
+    void read_faces(unsigned char* rgba);
+
+    ~CubeFramebuffer();
+
+private:
+    // Deletes the GL objects; unless keep_booked, also drops their registrations
+    void destroy(bool keep_booked = false);
+
+    GLuint m_fbo;
+    GLuint m_color_tex;
+    GLuint m_depth_tex;
+    GLsizei m_face_size;
+    resources::Tracked m_color_mem;
+    resources::Tracked m_depth_mem;
+};
+} // namespace framebuffer
+} // namespace svm
@@ -0,0 +1,69 @@
+#include "gpu_timer.h"
+
+namespace svm
+{
+namespace timer
+{
+GpuTimer::GpuTimer()
+    : m_queries()
+    , m_oldest(0)
+    , m_pending(0)
+    , m_active(false)
+{
+    glGenQueries(NUM_QUERIES, m_queries);
+}
+
+void GpuTimer::begin()
+{
+    // all queries still in flight: skip measuring this frame rather than stall
+    if (m_active || m_pending == NUM_QUERIES)
+    {
+        return;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[(m_oldest + m_pending) % NUM_QUERIES]);
+    m_active = true;
+}
+
+void GpuTimer::end()
+{
+    if (!m_active)
+    {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    m_active = false;
+    ++m_pending;
+}
+
+bool GpuTimer::poll(double& ms)
+{
+    bool found = false;
+    while (m_pending > 0)
+    {
+        const GLuint query = m_queries[m_oldest];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            break;
+        }
+
+        GLuint64 elapsed_ns = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed_ns);
+        ms = static_cast<double>(elapsed_ns) / 1.0e6;
+        found = true;
+
+        m_oldest = (m_oldest + 1) % NUM_QUERIES;
+        --m_pending;
+    }
+    return found;
+}
+
+GpuTimer::~GpuTimer()
+{
+    glDeleteQueries(NUM_QUERIES, m_queries);
+}
+} // namespace timer
+} // namespace svm
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glad/glad.h>
+
+namespace svm
+{
+namespace timer
+{
+// Measures GPU time between begin() and end() with GL_TIME_ELAPSED queries. Results are read
+// back a few frames later so the CPU never waits on the GPU.
+class GpuTimer
+{
+public:
+    GpuTimer();
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    void begin();
+    void end();
+
+    // Stores the newest finished measurement in `ms` and returns true, or returns false if no
+    // query has finished since the last call
+    bool poll(double& ms);
+
+    ~GpuTimer();
+
+private:
+    static constexpr const int NUM_QUERIES = 4;
+
+    GLuint m_queries[NUM_QUERIES];
+    int m_oldest;
+    int m_pending;
+    bool m_active;
+};
+} // namespace timer
+} // namespace svm
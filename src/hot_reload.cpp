@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "hot_reload.h"
+#include "jobs.h"
+
+namespace
+{
+// tile rows per job when comparing
+constexpr const int DEFAULT_BAND_TILE_ROWS = 1;
+
+#if defined(__linux__)
+// room for dozens of events; anything left over is read by the next loop iteration
+constexpr const std::size_t EVENT_BUFFER_BYTES = 4096;
+#else
+constexpr const std::chrono::milliseconds CHECK_INTERVAL(500);
+
+// Modification time and size, or -1 for both if the file can't be read
+void stat_file(const std::string& path, long long& mtime, long long& size)
+{
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0)
+    {
+        mtime = -1;
+        size = -1;
+        return;
+    }
+    mtime = static_cast<long long>(st.st_mtime);
+    size = static_cast<long long>(st.st_size);
+}
+#endif
+
+int band_tile_rows(unsigned num_bands, int num_tile_rows)
+{
+    return (num_bands == 0) ? DEFAULT_BAND_TILE_ROWS
+        : (num_tile_rows + static_cast<int>(num_bands) - 1) / static_cast<int>(num_bands);
+}
+} // anonymous namespace
+
+namespace svm
+{
+namespace reload
+{
+std::vector<Rect> find_dirty_rects(const image::Image& before, const image::Image& after,
+    unsigned num_bands)
+{
+    const Rect whole = { 0, 0, after.width, after.height };
+    if (!before.pixels || before.width != after.width || before.height != after.height
+        || before.num_channels != after.num_channels)
+    {
+        return { whole };
+    }
+
+    const int width = after.width;
+    const int height = after.height;
+    const int num_channels = after.num_channels;
+    const std::size_t row_bytes = static_cast<std::size_t>(width) * num_channels;
+    const int tiles_x = (width + TILE - 1) / TILE;
+    const int tiles_y = (height + TILE - 1) / TILE;
+
+    // one byte per tile rather than vector<bool>, so bands can write their own rows concurrently
+    std::vector<unsigned char> dirty(static_cast<std::size_t>(tiles_x) * tiles_y, 0);
+    const unsigned char* old_pixels = before.pixels.get();
+    const unsigned char* new_pixels = after.pixels.get();
+    jobs::JobSystem::instance().parallel_for(0, tiles_y, band_tile_rows(num_bands, tiles_y),
+        [&](int begin, int end)
+    {
+        for (int ty = begin; ty < end; ++ty)
+        {
+            unsigned char* tile_dirty = &dirty[static_cast<std::size_t>(ty) * tiles_x];
+            for (int y = ty * TILE; y < std::min(height, (ty + 1) * TILE); ++y)
+            {
+                const unsigned char* old_row = old_pixels + y * row_bytes;
+                const unsigned char* new_row = new_pixels + y * row_bytes;
+                // most rows of a retouched photo are untouched, and one compare settles those
+                if (std::memcmp(old_row, new_row, row_bytes) == 0)
+                {
+                    continue;
+                }
+                for (int tx = 0; tx < tiles_x; ++tx)
+                {
+                    const std::size_t offset = static_cast<std::size_t>(tx) * TILE * num_channels;
+                    const std::size_t bytes = static_cast<std::size_t>(std::min(TILE, width - tx * TILE)) * num_channels;
+                    if (!tile_dirty[tx] && std::memcmp(old_row + offset, new_row + offset, bytes) != 0)
+                    {
+                        tile_dirty[tx] = 1;
+                    }
+                }
+            }
+        }
+    });
+
+    const std::size_t num_dirty = static_cast<std::size_t>(std::count(dirty.begin(), dirty.end(), 1));
+    if (2 * num_dirty > dirty.size())
+    {
+        return { whole };
+    }
+
+    std::vector<Rect> rects;
+    // rects ending at the previous tile row, which runs of the same extent on this one extend
+    std::vector<std::size_t> open;
+    std::vector<std::size_t> still_open;
+    for (int ty = 0; ty < tiles_y; ++ty)
+    {
+        const unsigned char* tile_dirty = &dirty[static_cast<std::size_t>(ty) * tiles_x];
+        const int y = ty * TILE;
+        const int rows = std::min(TILE, height - y);
+        still_open.clear();
+        for (int tx = 0; tx < tiles_x; ++tx)
+        {
+            if (!tile_dirty[tx])
+            {
+                continue;
+            }
+            const int run_begin = tx;
+            while (tx + 1 < tiles_x && tile_dirty[tx + 1])
+            {
+                ++tx;
+            }
+            const int x = run_begin * TILE;
+            const int columns = std::min(width, (tx + 1) * TILE) - x;
+
+            auto above = std::find_if(open.begin(), open.end(), [&rects, x, columns](std::size_t i)
+            {
+                return rects[i].x == x && rects[i].width == columns;
+            });
+            if (above != open.end())
+            {
+                rects[*above].height += rows;
+                still_open.push_back(*above);
+            }
+            else
+            {
+                rects.push_back({ x, y, columns, rows });
+                still_open.push_back(rects.size() - 1);
+            }
+        }
+        open.swap(still_open);
+    }
+    return rects;
+}
+
+#if defined(__linux__)
+FileWatcher::FileWatcher()
+    : m_path()
+    , m_name()
+    , m_fd(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    , m_watch(-1)
+    , m_events(EVENT_BUFFER_BYTES)
+{
+    if (m_fd < 0)
+    {
+        throw std::runtime_error(std::string("could not start watching files: ") + std::strerror(errno));
+    }
+}
+
+void FileWatcher::watch(const std::string& path)
+{
+    stop();
+
+    const std::size_t slash = path.rfind('/');
+    const std::string dir = (slash == std::string::npos) ? "." : (slash == 0) ? "/" : path.substr(0, slash);
+    // renames onto the path count as well as writes to it; plain IN_MODIFY would fire mid-write
+    const int wd = ::inotify_add_watch(m_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0)
+    {
+        throw std::runtime_error("could not watch " + dir + ": " + std::strerror(errno));
+    }
+    m_watch = wd;
+    m_path = path;
+    m_name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+}
+
+bool FileWatcher::poll()
+{
+    bool changed = false;
+    for (;;)
+    {
+        const ssize_t len = ::read(m_fd, m_events.data(), m_events.size());
+        if (len <= 0)
+        {
+            // EAGAIN once the queue is empty
+            break;
+        }
+        for (const char* p = m_events.data(); p < m_events.data() + len;)
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+            // events still queued for a directory watched before have another descriptor
+            if (event->wd == m_watch && event->len > 0 && m_name == event->name)
+            {
+                changed = true;
+            }
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+    return changed;
+}
+
+void FileWatcher::stop()
+{
+    if (m_watch >= 0)
+    {
+        ::inotify_rm_watch(m_fd, m_watch);
+        m_watch = -1;
+    }
+    m_path.clear();
+    m_name.clear();
+}
+
+FileWatcher::~FileWatcher()
+{
+    ::close(m_fd);
+}
+#else
+FileWatcher::FileWatcher()
+    : m_path()
+    , m_name()
+    , m_next_check()
+    , m_mtime(-1)
+    , m_size(-1)
+{
+}
+
+void FileWatcher::watch(const std::string& path)
+{
+    stop();
+    m_path = path;
+    m_name = path.substr(path.rfind('/') + 1);
+    stat_file(m_path, m_mtime, m_size);
+    m_next_check = std::chrono::steady_clock::now() + CHECK_INTERVAL;
+}
+
+bool FileWatcher::poll()
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (m_path.empty() || now < m_next_check)
+    {
+        return false;
+    }
+    m_next_check = now + CHECK_INTERVAL;
+
+    long long mtime, size;
+    stat_file(m_path, mtime, size);
+    // a file that's gone is probably being replaced; wait until it's back
+    if (mtime < 0 || (mtime == m_mtime && size == m_size))
+    {
+        return false;
+    }
+    m_mtime = mtime;
+    m_size = size;
+    return true;
+}
+
+void FileWatcher::stop()
+{
+    m_path.clear();
+    m_name.clear();
+}
+
+FileWatcher::~FileWatcher()
+{
+}
+#endif
+
+const std::string& FileWatcher::path() const
+{
+    return m_path;
+}
+} // namespace reload
+} // namespace svm
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "image.h"
+
+namespace svm
+{
+namespace reload
+{
+// A region of an image in pixels, rows counted bottom-up like image::Image and GL textures
+struct Rect
+{
+    int x;
+    int y;
+    int width;
+    int height;
+
+    bool operator==(const Rect& other) const
+    {
+        return x == other.x && y == other.y && width == other.width && height == other.height;
+    }
+};
+
+constexpr const int TILE = 64;
+
+// Compares the images in TILE x TILE tiles, bands of tile rows running on the shared job system
+// (num_bands as for depth::DepthMapper::compute), and merges the tiles that differ into
+// rectangles: runs of tiles along each tile row, then runs that line up in consecutive tile rows.
+// If the images differ in size or channels, or if most tiles changed, returns one rectangle
+// covering all of after, since uploading it whole is quicker than in pieces.
+std::vector<Rect> find_dirty_rects(const image::Image& before, const image::Image& after,
+    unsigned num_bands = 0);
+
+// Tells when a file has been written. Editors usually save by writing a new file and renaming it
+// over the old one, so it is the file's directory that's watched, through inotify on Linux. Other
+// systems compare the file's modification time and size, at most twice a second. Only one file is
+// watched at a time. Not thread-safe.
+class FileWatcher
+{
+public:
+    // Throws if inotify is unavailable
+    FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Watches path instead of whatever was watched before. Throws if its directory can't be
+    // watched, which leaves nothing watched.
+    void watch(const std::string& path);
+    const std::string& path() const;
+
+    // True if the file has been written and closed, or replaced, since the last call. Never
+    // blocks. Several saves between two calls count once.
+    bool poll();
+
+    ~FileWatcher();
+
+private:
+    void stop();
+
+    std::string m_path;
+    std::string m_name;
+#if defined(__linux__)
+    int m_fd;
+    int m_watch;
+    std::vector<char> m_events;
+#else
+    std::chrono::steady_clock::time_point m_next_check;
+    long long m_mtime;
+    long long m_size;
+#endif
+};
+} // namespace reload
+} // namespace svm
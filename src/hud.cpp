@@ -0,0 +1,433 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+#include "hud.h"
+#include "jobs.h"
+#include "vertex.h"
+
+namespace
+{
+// 5x7 glyphs for what the overlay prints; lowercase is drawn as uppercase and anything else is
+// blank. Each row's low 5 bits are its pixels, the leftmost in bit 4.
+struct Glyph
+{
+    char ch;
+    unsigned char rows[7];
+};
+
+const Glyph font[] =
+{
+    { '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+    { '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+    { '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+    { '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+    { '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+    { '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+    { '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+    { '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+    { '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+    { 'A', { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 } },
+    { 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+    { 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+    { 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+    { 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+    { 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+    { 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+    { 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+    { 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+    { 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+    { 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+    { 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+    { 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+    { 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+    { 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+    { 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+    { 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+    { 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+    { 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+    { 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+    { 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+    { 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+    { 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+    { 'Y', { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 } },
+    { 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+    { '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+    { ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+    { '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+    { '%', { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 } },
+    { '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+    { '+', { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 } },
+    { '(', { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 } },
+    { ')', { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 } },
+};
+
+// The atlas has an 8x8 cell for each of ASCII 32 to 127; DEL's cell is solid, for untextured quads
+constexpr const int FIRST_CHAR = 32;
+constexpr const int NUM_CHARS = 96;
+constexpr const int SOLID_CELL = NUM_CHARS - 1;
+constexpr const int CELL_SIZE = 8;
+constexpr const int ATLAS_COLUMNS = 16;
+constexpr const int ATLAS_WIDTH = ATLAS_COLUMNS * CELL_SIZE;
+constexpr const int ATLAS_HEIGHT = NUM_CHARS / ATLAS_COLUMNS * CELL_SIZE;
+// glyphs advance by 6 atlas pixels, drawn at 2x
+constexpr const float GLYPH_WIDTH = 6;
+constexpr const float GLYPH_HEIGHT = 8;
+constexpr const float SCALE = 2;
+constexpr const float LINE_HEIGHT = (GLYPH_HEIGHT + 2) * SCALE;
+
+constexpr const float MARGIN = 8;
+constexpr const float PADDING = 6;
+constexpr const float BAR_WIDTH = 2;
+constexpr const float GRAPH_HEIGHT = 60;
+// the graph's top is this frame time; guide lines mark 60 and 30 fps
+constexpr const float GRAPH_MAX_MS = 50;
+constexpr const float FRAME_MS_60 = 1000.0f / 60;
+constexpr const float FRAME_MS_30 = 1000.0f / 30;
+constexpr const double JOB_SAMPLE_SECONDS = 0.5;
+
+const GLubyte panel_color[4] = { 0, 0, 0, 160 };
+const GLubyte text_color[4] = { 255, 255, 255, 255 };
+const GLubyte guide_color[4] = { 255, 255, 255, 80 };
+const GLubyte fast_color[4] = { 80, 220, 80, 255 };
+const GLubyte slow_color[4] = { 240, 200, 40, 255 };
+const GLubyte very_slow_color[4] = { 240, 60, 40, 255 };
+
+std::vector<unsigned char> build_atlas()
+{
+    std::vector<unsigned char> pixels(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+    const auto cell_origin = [](int cell)
+    {
+        return (cell / ATLAS_COLUMNS) * CELL_SIZE * ATLAS_WIDTH + (cell % ATLAS_COLUMNS) * CELL_SIZE;
+    };
+    for (const Glyph& glyph: font)
+    {
+        const int origin = cell_origin(glyph.ch - FIRST_CHAR);
+        for (int y = 0; y < 7; ++y)
+        {
+            for (int x = 0; x < 5; ++x)
+            {
+                if (glyph.rows[y] & (0x10 >> x))
+                {
+                    pixels[origin + y * ATLAS_WIDTH + x] = 255;
+                }
+            }
+        }
+    }
+    const int solid = cell_origin(SOLID_CELL);
+    for (int y = 0; y < CELL_SIZE; ++y)
+    {
+        std::fill_n(&pixels[solid + y * ATLAS_WIDTH], CELL_SIZE, 255);
+    }
+    return pixels;
+}
+} // anonymous namespace
+
+namespace svm
+{
+namespace hud
+{
+constexpr const int Hud::GRAPH_FRAMES;
+constexpr const int Hud::MAX_QUADS;
+
+Hud::Hud()
+    : m_visible(false)
+    , m_frame_ms()
+    , m_next_sample(0)
+    , m_num_samples(0)
+    , m_last_frame(-1)
+    , m_last_draw_count(vertex::draw_call_count())
+    , m_frame_draw_calls(0)
+    , m_render_ms(0)
+    , m_job_busy_seconds(0)
+    , m_job_sample_time(-1)
+    , m_job_utilization(0)
+    , m_status()
+    , m_verts(nullptr)
+    , m_num_quads(0)
+    , m_prog()
+    , m_atlas(0)
+    , m_vao(0)
+    , m_vbo(0)
+    , m_atlas_mem()
+    , m_vbo_mem()
+{}
+
+void Hud::set_visible(bool visible)
+{
+    if (visible && !m_prog)
+    {
+        create_gl_objects();
+    }
+    m_visible = visible;
+}
+
+bool Hud::visible() const
+{
+    return m_visible;
+}
+
+void Hud::toggle()
+{
+    set_visible(!m_visible);
+}
+
+void Hud::begin_frame(double now)
+{
+    if (m_last_frame >= 0)
+    {
+        m_frame_ms[m_next_sample] = static_cast<float>((now - m_last_frame) * 1000.0);
+        m_next_sample = (m_next_sample + 1) % GRAPH_FRAMES;
+        m_num_samples = std::min(m_num_samples + 1, GRAPH_FRAMES);
+    }
+    m_last_frame = now;
+
+    const std::size_t draw_count = vertex::draw_call_count();
+    m_frame_draw_calls = draw_count - m_last_draw_count;
+    m_last_draw_count = draw_count;
+}
+
+void Hud::set_status(const char* text)
+{
+    std::strncpy(m_status, text, MAX_STATUS_LENGTH - 1);
+    m_status[MAX_STATUS_LENGTH - 1] = '\0';
+}
+
+void Hud::render(window::Window& window)
+{
+    if (!m_visible)
+    {
+        return;
+    }
+    const double render_start = window::Window::now();
+
+    float total_ms = 0, max_ms = 0;
+    for (int i = 0; i < m_num_samples; ++i)
+    {
+        total_ms += m_frame_ms[i];
+        max_ms = std::max(max_ms, m_frame_ms[i]);
+    }
+    const float avg_ms = m_num_samples > 0 ? total_ms / m_num_samples : 0.0f;
+    const resources::Registry& memory = resources::Registry::instance();
+    const double mib = 1.0 / (1024 * 1024);
+
+    // share of the workers' time spent running tasks, over about the last half second
+    const jobs::JobSystem& pool = jobs::JobSystem::instance();
+    double busy_seconds = 0;
+    for (unsigned i = 0; i < pool.num_workers(); ++i)
+    {
+        busy_seconds += pool.worker_stats(i).busy_seconds;
+    }
+    if (m_job_sample_time < 0)
+    {
+        m_job_sample_time = render_start;
+        m_job_busy_seconds = busy_seconds;
+    }
+    else if (render_start - m_job_sample_time >= JOB_SAMPLE_SECONDS)
+    {
+        m_job_utilization = (busy_seconds - m_job_busy_seconds)
+            / ((render_start - m_job_sample_time) * pool.num_workers());
+        m_job_sample_time = render_start;
+        m_job_busy_seconds = busy_seconds;
+    }
+
+    char lines[5][MAX_STATUS_LENGTH];
+    std::snprintf(lines[0], sizeof(lines[0]), "FPS %.1f  %.2f MS  MAX %.2f",
+        avg_ms > 0 ? 1000.0f / avg_ms : 0.0f, avg_ms, max_ms);
+    std::snprintf(lines[1], sizeof(lines[1]), "DRAWS %zu  HUD %.3f MS", m_frame_draw_calls, m_render_ms);
+    std::snprintf(lines[2], sizeof(lines[2]), "TEX %.1f MIB  GPU %.1f MIB",
+        memory.usage(resources::Kind::texture).bytes * mib, memory.gpu_bytes() * mib);
+    std::snprintf(lines[3], sizeof(lines[3]), "JOBS %u WORKERS  %.0f%% BUSY", pool.num_workers(),
+        m_job_utilization * 100.0);
+    std::snprintf(lines[4], sizeof(lines[4]), "%s", m_status);
+    const int num_lines = m_status[0] != '\0' ? 5 : 4;
+
+    m_verts = window.frame_arena().allocate_array<HudVertex>(MAX_QUADS * 6);
+    m_num_quads = 0;
+
+    float text_width = 0;
+    for (int i = 0; i < num_lines; ++i)
+    {
+        text_width = std::max(text_width, std::strlen(lines[i]) * GLYPH_WIDTH * SCALE);
+    }
+    const float graph_width = GRAPH_FRAMES * BAR_WIDTH;
+    const float left = MARGIN + PADDING;
+    const float graph_top = MARGIN + PADDING + num_lines * LINE_HEIGHT;
+    const float graph_bottom = graph_top + GRAPH_HEIGHT;
+    push_rect(MARGIN, MARGIN, left + std::max(text_width, graph_width) + PADDING, graph_bottom + PADDING,
+        panel_color);
+
+    for (int i = 0; i < num_lines; ++i)
+    {
+        push_text(lines[i], left, MARGIN + PADDING + i * LINE_HEIGHT, text_color);
+    }
+
+    // oldest on the left, so the newest frame is always at the right edge
+    const int oldest = (m_num_samples == GRAPH_FRAMES) ? m_next_sample : 0;
+    const float x_start = left + (GRAPH_FRAMES - m_num_samples) * BAR_WIDTH;
+    for (int i = 0; i < m_num_samples; ++i)
+    {
+        const float ms = m_frame_ms[(oldest + i) % GRAPH_FRAMES];
+        const float height = std::min(ms / GRAPH_MAX_MS, 1.0f) * GRAPH_HEIGHT;
+        const GLubyte* color = ms <= FRAME_MS_60 ? fast_color : ms <= FRAME_MS_30 ? slow_color : very_slow_color;
+        const float x = x_start + i * BAR_WIDTH;
+        push_rect(x, graph_bottom - height, x + BAR_WIDTH, graph_bottom, color);
+    }
+    for (float guide_ms: { FRAME_MS_60, FRAME_MS_30 })
+    {
+        const float y = graph_bottom - guide_ms / GRAPH_MAX_MS * GRAPH_HEIGHT;
+        push_rect(left, y, left + graph_width, y + 1, guide_color);
+    }
+
+    int fb_width, fb_height;
+    window.get_framebuffer_size(fb_width, fb_height);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLint blend_src, blend_dst;
+    glGetIntegerv(GL_BLEND_SRC_RGB, &blend_src);
+    glGetIntegerv(GL_BLEND_DST_RGB, &blend_dst);
+    const GLboolean blend = glIsEnabled(GL_BLEND);
+    const GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+
+    glViewport(0, 0, fb_width, fb_height);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_DEPTH_TEST);
+
+    m_prog->setUniformVec2("viewport_size", glm::vec2(static_cast<float>(fb_width),
+        static_cast<float>(fb_height)));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    // orphan last frame's vertices so the upload doesn't wait for its draw
+    glBufferData(GL_ARRAY_BUFFER, sizeof(HudVertex) * 6 * MAX_QUADS, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(HudVertex) * 6 * m_num_quads, m_verts);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(m_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 6 * m_num_quads);
+    glBindVertexArray(0);
+    vertex::count_draw_calls();
+
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glBlendFunc(blend_src, blend_dst);
+    if (!blend)
+    {
+        glDisable(GL_BLEND);
+    }
+    if (depth_test)
+    {
+        glEnable(GL_DEPTH_TEST);
+    }
+    m_verts = nullptr;
+    m_render_ms = (window::Window::now() - render_start) * 1000.0;
+}
+
+void Hud::create_gl_objects()
+{
+    m_prog.reset(new shader::ShaderProgram(shader::ShaderProgram::hud_overlay()));
+
+    const std::vector<unsigned char> atlas = build_atlas();
+    glGenTextures(1, &m_atlas);
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    m_atlas_mem = resources::Tracked(resources::Kind::texture, ATLAS_WIDTH * ATLAS_HEIGHT);
+
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_vbo);
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(HudVertex) * 6 * MAX_QUADS, NULL, GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex),
+        reinterpret_cast<void*>(offsetof(HudVertex, xy)));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex),
+        reinterpret_cast<void*>(offsetof(HudVertex, uv)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(HudVertex),
+        reinterpret_cast<void*>(offsetof(HudVertex, rgba)));
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_vbo_mem = resources::Tracked(resources::Kind::buffer, sizeof(HudVertex) * 6 * MAX_QUADS);
+}
+
+bool Hud::push_quad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1,
+    const GLubyte rgba[4])
+{
+    if (m_num_quads == MAX_QUADS)
+    {
+        return false;
+    }
+    const HudVertex corners[4] =
+    {
+        { { x0, y0 }, { u0, v0 }, { rgba[0], rgba[1], rgba[2], rgba[3] } },
+        { { x1, y0 }, { u1, v0 }, { rgba[0], rgba[1], rgba[2], rgba[3] } },
+        { { x1, y1 }, { u1, v1 }, { rgba[0], rgba[1], rgba[2], rgba[3] } },
+        { { x0, y1 }, { u0, v1 }, { rgba[0], rgba[1], rgba[2], rgba[3] } },
+    };
+    HudVertex* out = m_verts + 6 * m_num_quads;
+    out[0] = corners[0];
+    out[1] = corners[1];
+    out[2] = corners[2];
+    out[3] = corners[0];
+    out[4] = corners[2];
+    out[5] = corners[3];
+    ++m_num_quads;
+    return true;
+}
+
+bool Hud::push_rect(float x0, float y0, float x1, float y1, const GLubyte rgba[4])
+{
+    // the middle of the solid cell, clear of its neighbours
+    const float u = ((SOLID_CELL % ATLAS_COLUMNS) * CELL_SIZE + CELL_SIZE / 2.0f) / ATLAS_WIDTH;
+    const float v = ((SOLID_CELL / ATLAS_COLUMNS) * CELL_SIZE + CELL_SIZE / 2.0f) / ATLAS_HEIGHT;
+    return push_quad(x0, y0, x1, y1, u, v, u, v, rgba);
+}
+
+void Hud::push_text(const char* text, float x, float y, const GLubyte rgba[4])
+{
+    for (; *text != '\0'; ++text, x += GLYPH_WIDTH * SCALE)
+    {
+        int ch = static_cast<unsigned char>(*text);
+        if (ch >= 'a' && ch <= 'z')
+        {
+            ch += 'A' - 'a';
+        }
+        if (ch <= FIRST_CHAR || ch >= FIRST_CHAR + SOLID_CELL)
+        {
+            continue;
+        }
+        const int cell = ch - FIRST_CHAR;
+        const float u = static_cast<float>((cell % ATLAS_COLUMNS) * CELL_SIZE) / ATLAS_WIDTH;
+        const float v = static_cast<float>((cell / ATLAS_COLUMNS) * CELL_SIZE) / ATLAS_HEIGHT;
+        if (!push_quad(x, y, x + GLYPH_WIDTH * SCALE, y + GLYPH_HEIGHT * SCALE, u, v,
+            u + GLYPH_WIDTH / ATLAS_WIDTH, v + GLYPH_HEIGHT / ATLAS_HEIGHT, rgba))
+        {
+            break;
+        }
+    }
+}
+
+Hud::~Hud()
+{
+    if (m_vao != 0)
+    {
+        glDeleteVertexArrays(1, &m_vao);
+        glDeleteBuffers(1, &m_vbo);
+        glDeleteTextures(1, &m_atlas);
+    }
+}
+} // namespace hud
+} // namespace svm
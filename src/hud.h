@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <glad/glad.h>
+#include <memory>
+
+#include "resource_registry.h"
+#include "shader.h"
+#include "window.h"
+
+namespace svm
+{
+namespace hud
+{
+struct HudVertex
+{
+    GLfloat xy[2];      // pixels from the top-left corner
+    GLfloat uv[2];
+    GLubyte rgba[4];
+};
+
+// Performance overlay: a rolling frame-time graph, FPS, draw calls, texture memory, job system
+// utilization and a status line for loading progress. Glyphs come from a small bitmap font baked into a one-channel atlas,
+// and every glyph and graph bar is a quad in one vertex buffer, so the whole overlay is one draw
+// call. Vertices are built in the window's frame arena. GL objects are created the first time the
+// overlay is shown, so a hidden one costs nothing, and render() never creates any.
+class Hud
+{
+public:
+    static constexpr const int GRAPH_FRAMES = 120;
+    // quads the vertex buffer has room for; anything past that isn't drawn
+    static constexpr const int MAX_QUADS = 512;
+    static constexpr const std::size_t MAX_STATUS_LENGTH = 64;
+
+    Hud();
+
+    Hud(const Hud&) = delete;
+    Hud& operator=(const Hud&) = delete;
+
+    // Showing the overlay for the first time creates its GL objects, so call these outside the
+    // frame's render section with the window's context current
+    void set_visible(bool visible);
+    bool visible() const;
+    void toggle();
+
+    // Call once per frame before anything is drawn; records the time since the previous call and
+    // the draw calls issued in between. Kept up while hidden, so the graph is full when shown.
+    void begin_frame(double now);
+    // Shown as the last line, e.g. decode progress; longer text is cut off
+    void set_status(const char* text);
+
+    // Draws over the framebuffer that's bound, which must be the window's size. Leaves blending,
+    // depth testing and the viewport as it found them.
+    void render(window::Window& window);
+
+    ~Hud();
+
+private:
+    void create_gl_objects();
+    // Both return false once MAX_QUADS is reached
+    bool push_quad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1,
+        const GLubyte rgba[4]);
+    bool push_rect(float x0, float y0, float x1, float y1, const GLubyte rgba[4]);
+    void push_text(const char* text, float x, float y, const GLubyte rgba[4]);
+
+    bool m_visible;
+    // frame times in ms, oldest at m_next_sample once the ring is full
+    float m_frame_ms[GRAPH_FRAMES];
+    int m_next_sample;
+    int m_num_samples;
+    double m_last_frame;
+    std::size_t m_last_draw_count;
+    std::size_t m_frame_draw_calls;
+    double m_render_ms;
+    // job system busy time at the start of the current utilization sample
+    double m_job_busy_seconds;
+    double m_job_sample_time;
+    double m_job_utilization;
+    char m_status[MAX_STATUS_LENGTH];
+
+    // valid during render()
+    HudVertex* m_verts;
+    int m_num_quads;
+
+    std::unique_ptr<shader::ShaderProgram> m_prog;
+    GLuint m_atlas;
+    GLuint m_vao;
+    GLuint m_vbo;
+    resources::Tracked m_atlas_mem;
+    resources::Tracked m_vbo_mem;
+};
+} // namespace hud
+} // namespace svm
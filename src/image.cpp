@@ -0,0 +1,173 @@
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image_write.h>
+#include <stb/stb_image.h>
+#include <cctype>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include "image.h"
+#include "jpeg_reader.h"
+
+namespace
+{
+// stb_image's flip setting is a process-wide flag; set it once instead of racing on it from the
+// decode threads
+void init_stb()
+{
+    static std::once_flag once;
+    std::call_once(once, []()
+    {
+        stbi_set_flip_vertically_on_load(true);
+    });
+}
+
+bool has_extension(const char* path, const char* ext)
+{
+    const std::size_t path_len = std::strlen(path);
+    const std::size_t ext_len = std::strlen(ext);
+    if (path_len < ext_len)
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < ext_len; ++i)
+    {
+        if (std::tolower(static_cast<unsigned char>(path[path_len - ext_len + i])) != ext[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+svm::image::Image from_stb(unsigned char* data, int width, int height, int num_channels)
+{
+    svm::image::Image res;
+    res.pixels = std::shared_ptr<unsigned char>(data, stbi_image_free);
+    res.width = width;
+    res.height = height;
+    res.num_channels = num_channels;
+    res.mem = svm::resources::Tracked(svm::resources::Kind::host_image,
+        svm::resources::texture_bytes(width, height, num_channels, false));
+    return res;
+}
+
+#ifdef SVM_HAVE_LIBJPEG
+svm::image::Image decode_jpeg(const char* path, int min_height)
+{
+    svm::image::JpegReader reader(path, min_height);
+    svm::image::Image res;
+    res.width = reader.width();
+    res.height = reader.height();
+    res.num_channels = reader.num_channels();
+    res.scale_denom = reader.scale_denom();
+    const std::ptrdiff_t row_bytes = static_cast<std::ptrdiff_t>(res.width) * res.num_channels;
+    res.pixels = std::shared_ptr<unsigned char>(new unsigned char[row_bytes * res.height],
+        std::default_delete<unsigned char[]>());
+    res.mem = svm::resources::Tracked(svm::resources::Kind::host_image,
+        svm::resources::texture_bytes(res.width, res.height, res.num_channels, false));
+    // JPEG rows come top-down, so start at the last row and walk backwards
+    reader.read_rows(res.pixels.get() + (res.height - 1) * row_bytes, res.height, -row_bytes);
+    return res;
+}
+#endif
+} // anonymous namespace
+
+namespace svm
+{
+namespace image
+{
+Image decode_file(const char* path, int min_height)
+{
+#ifdef SVM_HAVE_LIBJPEG
+    if (is_jpeg_file(path))
+    {
+        return decode_jpeg(path, min_height);
+    }
+#else
+    (void)min_height;
+#endif
+
+    init_stb();
+    int width, height, num_channels;
+    unsigned char* data = stbi_load(path, &width, &height, &num_channels, 0);
+    if (!data)
+    {
+        throw std::runtime_error(std::string("could not open file: ") + path);
+    }
+    return from_stb(data, width, height, num_channels);
+}
+
+Image decode_memory(const void* buf, std::size_t len)
+{
+    init_stb();
+    int width, height, num_channels;
+    unsigned char* data = stbi_load_from_memory(static_cast<const stbi_uc*>(buf), static_cast<int>(len),
+        &width, &height, &num_channels, 0);
+    if (!data)
+    {
+        throw std::runtime_error(std::string("could not decode image: ") + stbi_failure_reason());
+    }
+    return from_stb(data, width, height, num_channels);
+}
+void read_info(const char* path, int& width, int& height, int& num_channels)
+{
+#ifdef SVM_HAVE_LIBJPEG
+    if (is_jpeg_file(path))
+    {
+        JpegReader reader(path);
+        width = reader.width();
+        height = reader.height();
+        num_channels = reader.num_channels();
+        return;
+    }
+#endif
+
+    if (!stbi_info(path, &width, &height, &num_channels))
+    {
+        throw std::runtime_error(std::string("could not open file: ") + path);
+    }
+}
+
+void decode_file_into(const char* path, unsigned char* dst, int width, int height, int num_channels)
+{
+    const auto check_size = [&](int w, int h, int c)
+    {
+        if (w != width || h != height || c != num_channels)
+        {
+            throw std::runtime_error(std::string(path) + " is " + std::to_string(w) + "x" + std::to_string(h) + "x"
+                + std::to_string(c) + ", expected " + std::to_string(width) + "x" + std::to_string(height) + "x"
+                + std::to_string(num_channels));
+        }
+    };
+    const std::ptrdiff_t row_bytes = static_cast<std::ptrdiff_t>(width) * num_channels;
+
+#ifdef SVM_HAVE_LIBJPEG
+    if (is_jpeg_file(path))
+    {
+        JpegReader reader(path);
+        check_size(reader.width(), reader.height(), reader.num_channels());
+        reader.read_rows(dst + (height - 1) * row_bytes, height, -row_bytes);
+        return;
+    }
+#endif
+
+    const Image img = decode_file(path);
+    check_size(img.width, img.height, img.num_channels);
+    std::memcpy(dst, img.pixels.get(), row_bytes * height);
+}
+
+void write_file(const char* path, const unsigned char* pixels, int width, int height, int num_channels)
+{
+    constexpr int JPEG_QUALITY = 95;
+    const int ok = (has_extension(path, ".jpg") || has_extension(path, ".jpeg"))
+        ? stbi_write_jpg(path, width, height, num_channels, pixels, JPEG_QUALITY)
+        : stbi_write_png(path, width, height, num_channels, pixels, width * num_channels);
+    if (!ok)
+    {
+        throw std::runtime_error(std::string("could not write file: ") + path);
+    }
+}
+} // namespace image
+} // namespace svm
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "resource_registry.h"
+
+namespace svm
+{
+namespace image
+{
+// Decoded pixels in host memory, rows bottom-up as GL expects them
+struct Image
+{
+    std::shared_ptr<unsigned char> pixels;
+    int width = 0;
+    int height = 0;
+    int num_channels = 0;
+    // the image is 1/scale_denom of the size stored in the file
+    int scale_denom = 1;
+    resources::Tracked mem;
+};
+
+// Both decoders are safe to call from any thread. JPEGs go through libjpeg when built with it,
+// everything else through stb_image. A min_height lets JPEGs decode at a reduced scale that is
+// still at least that tall (see JpegReader); other formats are always decoded at full size.
+Image decode_file(const char* path, int min_height = 0);
+Image decode_memory(const void* buf, std::size_t len);
+
+// Reads just the size and channel count decode_file() would produce at full scale
+void read_info(const char* path, int& width, int& height, int& num_channels);
+// Decodes at full scale into caller memory (e.g. a mapped GL buffer) as bottom-up rows. Throws if
+// the image isn't width x height with num_channels channels.
+void decode_file_into(const char* path, unsigned char* dst, int width, int height, int num_channels);
+
+// Writes top-down rows as PNG, or as JPEG if the path ends in .jpg or .jpeg. Throws on failure.
+void write_file(const char* path, const unsigned char* pixels, int width, int height, int num_channels);
+} // namespace image
+} // namespace svm
@@ -0,0 +1,795 @@
+#include <algorithm>
+#include <cctype>
+#include <dirent.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/stat.h>
+
+#include "image_session.h"
+#include "jobs.h"
+#include "jpeg_reader.h"
+#include "scope_guard.h"
+
+namespace
+{
+bool is_directory(const std::string& path)
+{
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool has_image_extension(const std::string& name)
+{
+    static const char* const EXTENSIONS[] = { ".jpg", ".jpeg", ".png", ".bmp", ".tga", ".gif", ".psd", ".ppm" };
+    const std::size_t dot = name.rfind('.');
+    if (dot == std::string::npos)
+    {
+        return false;
+    }
+    std::string ext = name.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c)
+    {
+        return static_cast<char>(std::tolower(c));
+    });
+    for (const char* known: EXTENSIONS)
+    {
+        if (ext == known)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+} // anonymous namespace
+
+namespace svm
+{
+namespace session
+{
+constexpr const std::size_t ImageSession::DEFAULT_CACHE_SIZE;
+
+std::vector<std::string> collect_image_paths(const std::vector<std::string>& paths)
+{
+    std::vector<std::string> res;
+    for (const std::string& path: paths)
+    {
+        if (!is_directory(path))
+        {
+            res.push_back(path);
+            continue;
+        }
+
+        DIR* dir = ::opendir(path.c_str());
+        if (dir == nullptr)
+        {
+            throw std::runtime_error("could not open directory: " + path);
+        }
+        std::vector<std::string> files;
+        while (const dirent* entry = ::readdir(dir))
+        {
+            const std::string name = entry->d_name;
+            const std::string full = (path.back() == '/') ? path + name : path + "/" + name;
+            if (name[0] != '.' && has_image_extension(name) && !is_directory(full))
+            {
+                files.push_back(full);
+            }
+        }
+        ::closedir(dir);
+        std::sort(files.begin(), files.end());
+        res.insert(res.end(), files.begin(), files.end());
+    }
+    return res;
+}
+
+ImageSession::ImageSession(std::vector<std::string> paths, int preview_height, std::size_t cache_size,
+    std::shared_ptr<const undistort::Undistorter> undistorter)
+    : m_paths(std::move(paths))
+    , m_params(m_paths.size())
+    , m_preview_height(preview_height)
+    // the current image and both neighbours always fit
+    , m_cache_size(std::max<std::size_t>(cache_size, 3))
+    , m_current(0)
+    , m_resident()
+    , m_use_tick(0)
+    , m_undistorter(std::move(undistorter))
+    , m_watcher()
+    , m_mutex()
+    , m_decoded_cond()
+    , m_requests()
+    , m_in_progress({ 0, false })
+    , m_busy(false)
+    , m_decoded()
+    , m_baseline()
+    , m_streams()
+    , m_stop(false)
+{
+    if (m_paths.empty())
+    {
+        throw std::runtime_error("no images to show");
+    }
+    m_resident.reserve(m_cache_size + 1);
+
+    select(0);
+}
+
+std::size_t ImageSession::size() const
+{
+    return m_paths.size();
+}
+
+std::size_t ImageSession::current_index() const
+{
+    return m_current;
+}
+
+const std::string& ImageSession::current_path() const
+{
+    return m_paths[m_current];
+}
+
+const std::shared_ptr<texture::Texture2D>& ImageSession::preview_texture() const
+{
+    const Slot& slot = current_slot();
+    return slot.full ? slot.full : slot.preview;
+}
+
+const std::shared_ptr<texture::Texture2D>& ImageSession::full_texture()
+{
+    const Slot* current = find_resident(m_current);
+    if (current == nullptr || !current->full)
+    {
+        const Request request = { m_current, true };
+        Decoded decoded;
+        bool have_decoded = false;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // not started yet, so decoding it here is quicker than waiting behind the queue
+            m_requests.erase(std::remove(m_requests.begin(), m_requests.end(), request), m_requests.end());
+            m_decoded_cond.wait(lock, [this, &request]()
+            {
+                return !(m_busy && m_in_progress == request);
+            });
+            have_decoded = take_decoded(request, decoded);
+            if (!have_decoded || !decoded.error.empty())
+            {
+                // the prefetch's buffer, if it had one, won't be filled in now
+                release_idle_streams();
+            }
+        }
+
+        if (have_decoded && decoded.error.empty())
+        {
+            upload(decoded);
+        }
+        else if (Slot* slot = find_resident(m_current))
+        {
+            slot->full.reset(load_full_texture(m_paths[m_current]));
+        }
+        else
+        {
+            std::shared_ptr<texture::Texture2D> full(load_full_texture(m_paths[m_current]));
+            make_resident(m_current, full, full, nullptr);
+        }
+    }
+    return current_slot().full;
+}
+
+const std::shared_ptr<const edges::EdgeIndex>& ImageSession::edge_index() const
+{
+    return current_slot().edges;
+}
+
+BoxParams& ImageSession::box_params()
+{
+    return m_params[m_current];
+}
+
+void ImageSession::select(std::size_t index)
+{
+    index %= m_paths.size();
+    if (Slot* slot = find_resident(index))
+    {
+        slot->last_used = ++m_use_tick;
+    }
+    else
+    {
+        Decoded decoded;
+        bool have_decoded;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            have_decoded = take_decoded({ index, false }, decoded) || take_decoded({ index, true }, decoded);
+        }
+
+        if (have_decoded && decoded.error.empty())
+        {
+            upload(decoded);
+        }
+        else if (m_preview_height > 0)
+        {
+            const image::Image img = decode_file(m_paths[index], m_preview_height);
+            std::shared_ptr<texture::Texture2D> preview(
+                texture::Texture2D::from_pixels(img.pixels.get(), img.width, img.height, img.num_channels));
+            make_resident(index, preview, (img.scale_denom == 1) ? preview : nullptr, find_edges(img));
+        }
+        else
+        {
+            std::shared_ptr<texture::Texture2D> full(load_full_texture(m_paths[index]));
+            make_resident(index, full, full, nullptr);
+        }
+    }
+
+    m_current = index;
+    if (m_watcher)
+    {
+        watch_current();
+    }
+    queue_requests();
+}
+
+void ImageSession::next()
+{
+    select(m_current + 1);
+}
+
+void ImageSession::prev()
+{
+    select(m_current + m_paths.size() - 1);
+}
+
+std::size_t ImageSession::pending_decodes()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_requests.size() + (m_busy ? 1 : 0) + m_decoded.size();
+}
+
+void ImageSession::set_watching(bool watching)
+{
+    if (!watching)
+    {
+        m_watcher.reset();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        forget_baseline();
+    }
+    else if (!m_watcher)
+    {
+        m_watcher.reset(new reload::FileWatcher());
+        watch_current();
+    }
+}
+
+bool ImageSession::update()
+{
+    if (m_watcher && m_watcher->poll())
+    {
+        // ahead of any prefetches; one queued reload covers any number of saves
+        const Request request = { m_current, true, true };
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (std::find(m_requests.begin(), m_requests.end(), request) == m_requests.end())
+        {
+            m_requests.push_front(request);
+            start_decode();
+        }
+    }
+
+    Decoded decoded;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_decoded.empty())
+        {
+            return false;
+        }
+        decoded = std::move(m_decoded.front());
+        m_decoded.pop_front();
+    }
+
+    bool reloaded = false;
+    if (!decoded.error.empty())
+    {
+        std::cerr << "could not " << (decoded.request.reload ? "reload " : "prefetch ")
+            << m_paths[decoded.request.index] << ": " << decoded.error << std::endl;
+    }
+    else if (decoded.request.reload)
+    {
+        reloaded = decoded.request.index == m_current && m_watcher && apply_reload(decoded);
+    }
+    // the user may have moved on while this was decoding
+    else if (is_neighbour(decoded.request.index))
+    {
+        upload(decoded);
+    }
+
+    // frees the buffer of a streamed decode that wasn't uploaded
+    std::lock_guard<std::mutex> lock(m_mutex);
+    release_idle_streams();
+    return reloaded;
+}
+
+ImageSession::Slot* ImageSession::find_resident(std::size_t index)
+{
+    for (Slot& slot: m_resident)
+    {
+        if (slot.index == index)
+        {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+const ImageSession::Slot& ImageSession::current_slot() const
+{
+    for (const Slot& slot: m_resident)
+    {
+        if (slot.index == m_current)
+        {
+            return slot;
+        }
+    }
+    throw std::logic_error("current image is not resident");
+}
+
+void ImageSession::make_resident(std::size_t index, std::shared_ptr<texture::Texture2D> preview,
+    std::shared_ptr<texture::Texture2D> full, std::shared_ptr<const edges::EdgeIndex> edges)
+{
+    m_resident.push_back({ index, std::move(preview), std::move(full), std::move(edges), ++m_use_tick });
+    if (m_resident.size() <= m_cache_size)
+    {
+        return;
+    }
+
+    // evict the least recently used image, never the one on screen
+    auto victim = m_resident.end();
+    for (auto it = m_resident.begin(); it != m_resident.end(); ++it)
+    {
+        if (it->index != m_current && it->index != index
+            && (victim == m_resident.end() || it->last_used < victim->last_used))
+        {
+            victim = it;
+        }
+    }
+    if (victim != m_resident.end())
+    {
+        m_resident.erase(victim);
+    }
+}
+
+void ImageSession::upload(Decoded& decoded)
+{
+    const image::Image& img = decoded.image;
+    const std::size_t index = decoded.request.index;
+    std::shared_ptr<texture::Texture2D> tex(decoded.streamed ? finish_stream(index)
+        : texture::Texture2D::from_pixels(img.pixels.get(), img.width, img.height, img.num_channels));
+    const bool full = decoded.request.full || img.scale_denom == 1;
+
+    Slot* slot = find_resident(index);
+    if (slot == nullptr)
+    {
+        make_resident(index, tex, full ? tex : nullptr, std::move(decoded.edges));
+    }
+    else if (full && !slot->full)
+    {
+        slot->full = tex;
+    }
+    // free the host copy now rather than when the caller's Decoded goes away
+    decoded.image = image::Image();
+}
+
+void ImageSession::watch_current()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        forget_baseline();
+    }
+    try
+    {
+        m_watcher->watch(m_paths[m_current]);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+bool ImageSession::apply_reload(Decoded& decoded)
+{
+    Slot* slot = find_resident(decoded.request.index);
+    if (slot == nullptr)
+    {
+        // evicted since the reload was queued; with no textures to refresh this becomes a full
+        // load, which the code below does when it finds them missing
+        make_resident(decoded.request.index, nullptr, nullptr, nullptr);
+        slot = find_resident(decoded.request.index);
+    }
+    std::uint64_t version;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        version = m_baseline.version;
+    }
+    // the textures hold the baseline this was diffed against, so only what changed needs uploading
+    const bool diffed = (decoded.base_version == version);
+    const std::shared_ptr<texture::Texture2D> old_full = slot->full;
+    const std::shared_ptr<texture::Texture2D> old_preview = slot->preview;
+    const bool shared_preview = (slot->preview == slot->full);
+
+    refresh_texture(slot->full, decoded.image, diffed ? &decoded.dirty : nullptr);
+    if (!decoded.preview.pixels)
+    {
+        slot->preview = slot->full;
+    }
+    else if (shared_preview)
+    {
+        slot->preview.reset(texture::Texture2D::from_pixels(decoded.preview.pixels.get(), decoded.preview.width,
+            decoded.preview.height, decoded.preview.num_channels));
+    }
+    else
+    {
+        refresh_texture(slot->preview, decoded.preview, diffed ? &decoded.preview_dirty : nullptr);
+    }
+    const bool changed = !diffed || !decoded.dirty.empty() || !decoded.preview_dirty.empty()
+        || slot->full != old_full || slot->preview != old_preview;
+    if (changed)
+    {
+        slot->edges = std::move(decoded.edges);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // a full-size decode still queued would only be of what was just uploaded
+    const Request full_request = { decoded.request.index, true };
+    m_requests.erase(std::remove(m_requests.begin(), m_requests.end(), full_request), m_requests.end());
+    release_idle_streams();
+    ++m_baseline.version;
+    m_baseline.full = std::make_shared<const image::Image>(std::move(decoded.image));
+    m_baseline.preview = decoded.preview.pixels
+        ? std::make_shared<const image::Image>(std::move(decoded.preview)) : nullptr;
+    return changed;
+}
+
+void ImageSession::refresh_texture(std::shared_ptr<texture::Texture2D>& tex, const image::Image& img,
+    const std::vector<reload::Rect>* dirty)
+{
+    if (!tex || tex->width() != img.width || tex->height() != img.height || tex->num_channels() != img.num_channels)
+    {
+        tex.reset(texture::Texture2D::from_pixels(img.pixels.get(), img.width, img.height, img.num_channels));
+    }
+    else if (!dirty || (dirty->size() == 1 && dirty->front() == reload::Rect{ 0, 0, img.width, img.height }))
+    {
+        tex->update_pixels(img.pixels.get());
+    }
+    else
+    {
+        for (const reload::Rect& rect: *dirty)
+        {
+            tex->update_region(img.pixels.get(), rect.x, rect.y, rect.width, rect.height);
+        }
+    }
+}
+
+void ImageSession::forget_baseline()
+{
+    ++m_baseline.version;
+    m_baseline.full.reset();
+    m_baseline.preview.reset();
+}
+
+std::shared_ptr<const edges::EdgeIndex> ImageSession::find_edges(const image::Image& preview) const
+{
+    if (m_preview_height <= 0)
+    {
+        return nullptr;
+    }
+    // analysed at up to twice the editor's resolution, which is plenty to snap to
+    return edges::EdgeIndex::build(preview, 2 * m_preview_height);
+}
+
+image::Image ImageSession::decode_file(const std::string& path, int min_height) const
+{
+    image::Image img = image::decode_file(path.c_str(), min_height);
+    if (m_undistorter)
+    {
+        img = m_undistorter->apply(img);
+    }
+    return img;
+}
+
+texture::Texture2D* ImageSession::load_full_texture(const std::string& path) const
+{
+    if (!m_undistorter)
+    {
+        // may stream straight into the texture without a full-size host copy
+        return texture::Texture2D::from_file(path.c_str());
+    }
+    const image::Image img = decode_file(path, 0);
+    return texture::Texture2D::from_pixels(img.pixels.get(), img.width, img.height, img.num_channels);
+}
+
+ImageSession::Stream* ImageSession::find_stream(std::size_t index)
+{
+    for (Stream& stream: m_streams)
+    {
+        if (stream.index == index)
+        {
+            return &stream;
+        }
+    }
+    return nullptr;
+}
+
+void ImageSession::open_stream(std::size_t index)
+{
+    // lens correction needs the decoded pixels in host memory anyway
+    if (m_undistorter || find_stream(index) != nullptr)
+    {
+        return;
+    }
+    Stream stream;
+    stream.index = index;
+    try
+    {
+        image::read_info(m_paths[index].c_str(), stream.width, stream.height, stream.num_channels);
+    }
+    catch (const std::exception&)
+    {
+        // the decode without a buffer reports it
+        return;
+    }
+    if (stream.num_channels < 3 || stream.num_channels > 4)
+    {
+        return;
+    }
+
+    const std::size_t bytes = static_cast<std::size_t>(stream.width) * stream.height * stream.num_channels;
+    glGenBuffers(1, &stream.pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stream.pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+    stream.mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (stream.mapped == nullptr)
+    {
+        glDeleteBuffers(1, &stream.pbo);
+        return;
+    }
+    stream.mem = resources::Tracked(resources::Kind::buffer, bytes);
+    m_streams.push_back(std::move(stream));
+}
+
+void ImageSession::close_stream(Stream& stream)
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stream.pbo);
+    if (stream.mapped != nullptr)
+    {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        stream.mapped = nullptr;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &stream.pbo);
+    stream.pbo = 0;
+    stream.mem.reset();
+}
+
+void ImageSession::release_idle_streams()
+{
+    for (auto it = m_streams.begin(); it != m_streams.end();)
+    {
+        const Request request = { it->index, true };
+        if (is_pending(request) || std::find(m_requests.begin(), m_requests.end(), request) != m_requests.end())
+        {
+            ++it;
+            continue;
+        }
+        close_stream(*it);
+        it = m_streams.erase(it);
+    }
+}
+
+texture::Texture2D* ImageSession::finish_stream(std::size_t index)
+{
+    Stream stream;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stream* found = find_stream(index);
+        if (found == nullptr)
+        {
+            throw std::logic_error("no stream for a streamed decode");
+        }
+        stream = std::move(*found);
+        m_streams.erase(m_streams.begin() + (found - m_streams.data()));
+    }
+    tools::ScopeGuard free_stream([this, &stream]()
+    {
+        close_stream(stream);
+    });
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stream.pbo);
+    // the contents may be lost, e.g. on a display mode change
+    const bool intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+    stream.mapped = nullptr;
+    if (!intact)
+    {
+        free_stream.cleanup();
+        return load_full_texture(m_paths[index]);
+    }
+    std::unique_ptr<texture::Texture2D> tex(
+        texture::Texture2D::with_storage(stream.width, stream.height, stream.num_channels));
+    tex->update_pixels(NULL);
+    return tex.release();
+}
+
+bool ImageSession::take_decoded(const Request& request, Decoded& out)
+{
+    for (auto it = m_decoded.begin(); it != m_decoded.end(); ++it)
+    {
+        if (it->request == request)
+        {
+            out = std::move(*it);
+            m_decoded.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ImageSession::is_pending(const Request& request) const
+{
+    if (m_busy && m_in_progress == request)
+    {
+        return true;
+    }
+    for (const Decoded& decoded: m_decoded)
+    {
+        if (decoded.request == request)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ImageSession::queue_requests()
+{
+    const std::size_t n = m_paths.size();
+    Slot* current = find_resident(m_current);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // requests for images we moved away from are no longer worth decoding
+    m_requests.clear();
+
+    // the current image's full-size texture first, since theater mode will need it
+    if ((current == nullptr || !current->full) && !is_pending({ m_current, true }))
+    {
+        open_stream(m_current);
+        m_requests.push_back({ m_current, true });
+    }
+    for (std::size_t index: { (m_current + 1) % n, (m_current + n - 1) % n })
+    {
+        if (index != m_current && find_resident(index) == nullptr && !is_pending({ index, false })
+            && std::find(m_requests.begin(), m_requests.end(), Request{ index, false }) == m_requests.end())
+        {
+            m_requests.push_back({ index, false });
+        }
+    }
+    release_idle_streams();
+    start_decode();
+}
+
+bool ImageSession::is_neighbour(std::size_t index) const
+{
+    const std::size_t n = m_paths.size();
+    return index == m_current || index == (m_current + 1) % n || index == (m_current + n - 1) % n;
+}
+
+void ImageSession::start_decode()
+{
+    if (m_busy || m_stop || m_requests.empty())
+    {
+        return;
+    }
+    m_in_progress = m_requests.front();
+    m_requests.pop_front();
+    m_busy = true;
+    const Request request = m_in_progress;
+    jobs::JobSystem::instance().submit([this, request]()
+    {
+        decode(request);
+    });
+}
+
+void ImageSession::decode(Request request)
+{
+    Decoded decoded;
+    decoded.request = request;
+    try
+    {
+        if (request.reload)
+        {
+            decode_reload(request, decoded);
+        }
+        else
+        {
+            unsigned char* dst = nullptr;
+            int width = 0, height = 0, num_channels = 0;
+            {
+                // the GL thread keeps the stream mapped until this decode is taken
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (const Stream* stream = request.full ? find_stream(request.index) : nullptr)
+                {
+                    dst = stream->mapped;
+                    width = stream->width;
+                    height = stream->height;
+                    num_channels = stream->num_channels;
+                }
+            }
+
+            if (dst != nullptr)
+            {
+                image::decode_file_into(m_paths[request.index].c_str(), dst, width, height, num_channels);
+                decoded.streamed = true;
+            }
+            else
+            {
+                decoded.image = decode_file(m_paths[request.index], request.full ? 0 : m_preview_height);
+                if (!request.full)
+                {
+                    decoded.edges = find_edges(decoded.image);
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        decoded.error = e.what();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_decoded.push_back(std::move(decoded));
+    m_busy = false;
+    m_decoded_cond.notify_all();
+    start_decode();
+}
+
+void ImageSession::decode_reload(const Request& request, Decoded& decoded)
+{
+    Baseline base;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        base = m_baseline;
+    }
+    decoded.base_version = base.version;
+
+    const std::string& path = m_paths[request.index];
+    decoded.image = decode_file(path, 0);
+    // other formats' previews are decoded at full size anyway
+    if (m_preview_height > 0 && image::is_jpeg_file(path.c_str()))
+    {
+        decoded.preview = decode_file(path, m_preview_height);
+        if (decoded.preview.scale_denom == 1)
+        {
+            decoded.preview = image::Image();
+        }
+    }
+    decoded.edges = find_edges(decoded.preview.pixels ? decoded.preview : decoded.image);
+
+    const image::Image none;
+    decoded.dirty = reload::find_dirty_rects(base.full ? *base.full : none, decoded.image);
+    if (decoded.preview.pixels)
+    {
+        decoded.preview_dirty = reload::find_dirty_rects(base.preview ? *base.preview : none, decoded.preview);
+    }
+}
+
+ImageSession::~ImageSession()
+{
+    // the running decode, if any, still needs this object
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stop = true;
+    m_decoded_cond.wait(lock, [this]()
+    {
+        return !m_busy;
+    });
+    for (Stream& stream: m_streams)
+    {
+        close_stream(stream);
+    }
+}
+} // namespace session
+} // namespace svm
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <glad/glad.h>
+#include <glm/vec2.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "edge_snap.h"
+#include "hot_reload.h"
+#include "image.h"
+#include "resource_registry.h"
+#include "texture.h"
+#include "undistort.h"
+
+namespace svm
+{
+namespace session
+{
+// Expands directories (non-recursively) into the image files they contain, sorted by name; other
+// paths are kept as given, in order
+std::vector<std::string> collect_image_paths(const std::vector<std::string>& paths);
+
+// Box handles the user placed on an image, in GL coords
+struct BoxParams
+{
+    glm::vec2 top_left;
+    glm::vec2 bot_right;
+    glm::vec2 vanishing;
+    bool valid = false;
+};
+
+// Steps through a list of images. Each image is first shown from a preview decoded at reduced
+// scale, which is all the editor needs; the full-size texture is decoded in the background, straight
+// into a mapped pixel-unpack buffer unless the image needs lens correction, and only waited for when
+// theater mode asks for it. Keeps the textures of the most recently shown images
+// resident and prefetches the previews of the current image's neighbours, so switching usually
+// costs one small upload instead of a cold decode. Decodes run one at a time on the shared job
+// system, so a newly selected image's requests never wait behind more than one stale decode. All
+// methods must be called on the GL thread.
+class ImageSession
+{
+public:
+    static constexpr const std::size_t DEFAULT_CACHE_SIZE = 5;
+
+    // Loads the first preview synchronously. Previews are at least preview_height rows tall; 0
+    // disables them. With an undistorter, every image is lens-corrected after decoding, before its
+    // edges are found and it is uploaded.
+    ImageSession(std::vector<std::string> paths, int preview_height,
+        std::size_t cache_size = DEFAULT_CACHE_SIZE,
+        std::shared_ptr<const undistort::Undistorter> undistorter = nullptr);
+
+    ImageSession(const ImageSession&) = delete;
+    ImageSession& operator=(const ImageSession&) = delete;
+
+    std::size_t size() const;
+    std::size_t current_index() const;
+    const std::string& current_path() const;
+
+    // The preview of the current image, or its full-size texture if that is resident anyway
+    const std::shared_ptr<texture::Texture2D>& preview_texture() const;
+    // The full-size texture of the current image, waiting for or doing the decode if needed
+    const std::shared_ptr<texture::Texture2D>& full_texture();
+    // Edges found in the current image's preview, for snapping the editor's handles; null when
+    // previews are disabled
+    const std::shared_ptr<const edges::EdgeIndex>& edge_index() const;
+
+    BoxParams& box_params();
+
+    // Switch images, wrapping around at the ends. If the image isn't resident or prefetched yet its
+    // preview is loaded synchronously; on failure this throws and the current image stays selected.
+    void select(std::size_t index);
+    void next();
+    void prev();
+
+    // While watching, the current image is decoded again in the background whenever its file is
+    // saved, and update() brings its textures up to date in place. To upload only the tiles that
+    // changed, the full-size pixels of the last reload are kept in host memory; the first reload
+    // after selecting an image has nothing to compare with and uploads it whole. Throws if files
+    // can't be watched.
+    void set_watching(bool watching);
+
+    // Uploads at most one finished decode per call; call once per frame, outside the
+    // allocation-checked part of the frame. Returns true if that reloaded the current image, in
+    // which case its edge index is new, and so are its textures if the image changed size.
+    bool update();
+    // Decodes that are queued, running or waiting for update() to upload them
+    std::size_t pending_decodes();
+
+    ~ImageSession();
+
+private:
+    struct Slot
+    {
+        std::size_t index;
+        std::shared_ptr<texture::Texture2D> preview;
+        std::shared_ptr<texture::Texture2D> full;
+        std::shared_ptr<const edges::EdgeIndex> edges;
+        std::uint64_t last_used;
+    };
+
+    struct Request
+    {
+        std::size_t index;
+        bool full;
+        // the file changed on disk; always full-size
+        bool reload = false;
+
+        bool operator==(const Request& other) const
+        {
+            return index == other.index && full == other.full && reload == other.reload;
+        }
+    };
+
+    struct Decoded
+    {
+        Request request = { 0, false };
+        image::Image image;
+        std::shared_ptr<const edges::EdgeIndex> edges;
+        std::string error;
+        // reloads only: the preview decoded alongside, unless that is the full image itself, the
+        // regions of both that differ from the baseline, and which baseline that was
+        image::Image preview;
+        std::vector<reload::Rect> dirty;
+        std::vector<reload::Rect> preview_dirty;
+        std::uint64_t base_version = 0;
+        // full-size requests only: the pixels went into the index's Stream instead of image
+        bool streamed = false;
+    };
+
+    // A mapped buffer the full-size decode of one image writes into, so those pixels never sit in
+    // host memory next to the texture made from them. Created, unmapped and deleted on the GL thread.
+    struct Stream
+    {
+        std::size_t index = 0;
+        GLuint pbo = 0;
+        unsigned char* mapped = nullptr;
+        int width = 0;
+        int height = 0;
+        int num_channels = 0;
+        resources::Tracked mem;
+    };
+
+    // The current image's pixels as its textures hold them after a reload. version changes
+    // whenever they stop matching, so a reload diffed against an older baseline uploads whole.
+    struct Baseline
+    {
+        std::uint64_t version = 0;
+        std::shared_ptr<const image::Image> full;
+        std::shared_ptr<const image::Image> preview;
+    };
+
+    Slot* find_resident(std::size_t index);
+    const Slot& current_slot() const;
+    void make_resident(std::size_t index, std::shared_ptr<texture::Texture2D> preview,
+        std::shared_ptr<texture::Texture2D> full, std::shared_ptr<const edges::EdgeIndex> edges);
+    std::shared_ptr<const edges::EdgeIndex> find_edges(const image::Image& preview) const;
+    // Decodes like image::decode_file, then corrects the lens if there is an undistorter
+    image::Image decode_file(const std::string& path, int min_height) const;
+    texture::Texture2D* load_full_texture(const std::string& path) const;
+    // All expect m_mutex to be held, except finish_stream, which takes the index's stream out of
+    // m_streams and makes a texture from it
+    Stream* find_stream(std::size_t index);
+    void open_stream(std::size_t index);
+    void close_stream(Stream& stream);
+    void release_idle_streams();
+    texture::Texture2D* finish_stream(std::size_t index);
+    void upload(Decoded& decoded);
+    void watch_current();
+    // Both run on the GL thread; apply_reload returns true if anything changed
+    bool apply_reload(Decoded& decoded);
+    void refresh_texture(std::shared_ptr<texture::Texture2D>& tex, const image::Image& img,
+        const std::vector<reload::Rect>* dirty);
+    // expects m_mutex to be held
+    void forget_baseline();
+    // both expect m_mutex to be held
+    bool take_decoded(const Request& request, Decoded& out);
+    bool is_pending(const Request& request) const;
+    void queue_requests();
+    bool is_neighbour(std::size_t index) const;
+    // Hands the next request to the job system unless a decode is already running; expects
+    // m_mutex to be held
+    void start_decode();
+    void decode(Request request);
+    void decode_reload(const Request& request, Decoded& decoded);
+
+    std::vector<std::string> m_paths;
+    std::vector<BoxParams> m_params;
+    int m_preview_height;
+    std::size_t m_cache_size;
+    std::size_t m_current;
+    std::vector<Slot> m_resident;
+    std::uint64_t m_use_tick;
+    std::shared_ptr<const undistort::Undistorter> m_undistorter;
+    std::unique_ptr<reload::FileWatcher> m_watcher;
+
+    // everything below is shared with the decode job
+    std::mutex m_mutex;
+    std::condition_variable m_decoded_cond;
+    std::deque<Request> m_requests;
+    Request m_in_progress;
+    bool m_busy;
+    std::deque<Decoded> m_decoded;
+    Baseline m_baseline;
+    std::vector<Stream> m_streams;
+    bool m_stop;
+};
+} // namespace session
+} // namespace svm
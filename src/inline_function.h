@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace svm
+{
+namespace tools
+{
+template <class Signature, std::size_t Capacity = 4 * sizeof(void*)>
+class InlineFunction;
+
+// Move-only replacement for std::function that keeps the callable in a fixed inline buffer, so
+// constructing, assigning and calling it never touch the heap. Callables that don't fit fail to
+// compile instead of silently allocating.
+template <class R, class... Args, std::size_t Capacity>
+class InlineFunction<R(Args...), Capacity>
+{
+public:
+    InlineFunction() noexcept: m_ops(nullptr)
+    {}
+
+    InlineFunction(std::nullptr_t) noexcept: m_ops(nullptr)
+    {}
+
+    template <class F, class = typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, InlineFunction>::value>::type>
+    InlineFunction(F&& f): m_ops(nullptr)
+    {
+        assign(std::forward<F>(f));
+    }
+
+    InlineFunction(const InlineFunction&) = delete;
+    InlineFunction& operator=(const InlineFunction&) = delete;
+
+    InlineFunction(InlineFunction&& other) noexcept: m_ops(nullptr)
+    {
+        take(other);
+    }
+
+    InlineFunction& operator=(InlineFunction&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    InlineFunction& operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    template <class F, class = typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, InlineFunction>::value>::type>
+    InlineFunction& operator=(F&& f)
+    {
+        reset();
+        assign(std::forward<F>(f));
+        return *this;
+    }
+
+    R operator()(Args... args) const
+    {
+        return m_ops->invoke(&m_storage, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return m_ops != nullptr;
+    }
+
+    ~InlineFunction()
+    {
+        reset();
+    }
+
+private:
+    struct Ops
+    {
+        R (*invoke)(void*, Args&&...);
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void*);
+    };
+
+    template <class F>
+    static const Ops* ops_for()
+    {
+        static const Ops ops =
+        {
+            [](void* f, Args&&... args) -> R
+            {
+                return (*static_cast<F*>(f))(std::forward<Args>(args)...);
+            },
+            [](void* dst, void* src)
+            {
+                new (dst) F(std::move(*static_cast<F*>(src)));
+                static_cast<F*>(src)->~F();
+            },
+            [](void* f)
+            {
+                static_cast<F*>(f)->~F();
+            }
+        };
+        return &ops;
+    }
+
+    template <class F>
+    void assign(F&& f)
+    {
+        using func_t = typename std::decay<F>::type;
+        static_assert(sizeof(func_t) <= Capacity, "callable too large for InlineFunction storage");
+        static_assert(alignof(func_t) <= alignof(storage_t), "callable over-aligned for InlineFunction");
+
+        new (&m_storage) func_t(std::forward<F>(f));
+        m_ops = ops_for<func_t>();
+    }
+
+    void take(InlineFunction& other) noexcept
+    {
+        if (other.m_ops)
+        {
+            other.m_ops->move(&m_storage, &other.m_storage);
+            m_ops = other.m_ops;
+            other.m_ops = nullptr;
+        }
+    }
+
+    void reset() noexcept
+    {
+        if (m_ops)
+        {
+            m_ops->destroy(&m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+    using storage_t = typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type;
+
+    mutable storage_t m_storage;
+    const Ops* m_ops;
+};
+} // namespace tools
+} // namespace svm
@@ -0,0 +1,94 @@
+#include "input.h"
+
+namespace
+{
+std::size_t round_up_pow2(std::size_t n)
+{
+    std::size_t res = 1;
+    while (res < n)
+    {
+        res <<= 1;
+    }
+    return res;
+}
+} // anonymous namespace
+
+namespace svm
+{
+namespace input
+{
+constexpr const std::size_t EventQueue::DEFAULT_CAPACITY;
+
+EventQueue::EventQueue(std::size_t capacity)
+    : m_ring(round_up_pow2(capacity))
+    , m_mask(m_ring.size() - 1)
+    , m_head(0)
+    , m_size(0)
+    , m_dropped(0)
+    , m_oldest_popped(-1.0)
+{}
+
+void EventQueue::push(const Event& ev)
+{
+    if (m_size == m_ring.size())
+    {
+        m_head = (m_head + 1) & m_mask;
+        --m_size;
+        ++m_dropped;
+    }
+    m_ring[(m_head + m_size) & m_mask] = ev;
+    ++m_size;
+}
+
+bool EventQueue::pop(Event& ev)
+{
+    if (m_size == 0)
+    {
+        return false;
+    }
+
+    ev = m_ring[m_head];
+    m_head = (m_head + 1) & m_mask;
+    --m_size;
+
+    if (m_oldest_popped < 0 || ev.timestamp < m_oldest_popped)
+    {
+        m_oldest_popped = ev.timestamp;
+    }
+    return true;
+}
+
+void EventQueue::clear()
+{
+    m_head = 0;
+    m_size = 0;
+}
+
+bool EventQueue::empty() const
+{
+    return m_size == 0;
+}
+
+std::size_t EventQueue::size() const
+{
+    return m_size;
+}
+
+std::size_t EventQueue::capacity() const
+{
+    return m_ring.size();
+}
+
+std::size_t EventQueue::dropped() const
+{
+    return m_dropped;
+}
+
+double EventQueue::mark_presented(double now)
+{
+    const double res = (m_oldest_popped < 0) ? -1.0 : now - m_oldest_popped;
+    m_oldest_popped = -1.0;
+    return res;
+}
+} // namespace input
+} // namespace svm
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace svm
+{
+namespace input
+{
+enum class EventType
+{
+    key,
+    mouse_button,
+    cursor_pos,
+    resize
+};
+
+// One GLFW input event, stamped with the glfwGetTime() clock when it was received.
+// https://www.glfw.org/docs/latest/input_guide.html
+struct Event
+{
+    EventType type;
+    double timestamp;
+    int code;       // key or mouse button
+    int scancode;
+    int action;     // GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT
+    int mods;
+    double x;       // cursor position in screen coords (also filled in for button events)
+    double y;
+    int width;      // new framebuffer size for resize events
+    int height;
+};
+
+// Fixed-capacity ring buffer of input events. Storage is allocated once up front, so pushing from
+// the GLFW callbacks never allocates. When full, the oldest event is overwritten.
+class EventQueue
+{
+public:
+    static constexpr const std::size_t DEFAULT_CAPACITY = 1024;
+
+    explicit EventQueue(std::size_t capacity = DEFAULT_CAPACITY);
+
+    void push(const Event& ev);
+    bool pop(Event& ev);
+    void clear();
+
+    bool empty() const;
+    std::size_t size() const;
+    std::size_t capacity() const;
+    std::size_t dropped() const;
+
+    // Returns the time between the oldest event popped since the last call and `now`, or a
+    // negative value if nothing was consumed in between.
+    double mark_presented(double now);
+
+private:
+    std::vector<Event> m_ring;
+    std::size_t m_mask;
+    std::size_t m_head;
+    std::size_t m_size;
+    std::size_t m_dropped;
+    double m_oldest_popped;
+};
+} // namespace input
+} // namespace svm
@@ -0,0 +1,217 @@
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+#include "input_log.h"
+
+namespace
+{
+constexpr const char MAGIC[4] = { 'S', 'V', 'M', 'I' };
+constexpr const std::uint16_t VERSION = 1;
+constexpr const std::size_t FLUSH_THRESHOLD = 64 * 1024;
+} // anonymous namespace
+
+namespace svm
+{
+namespace input
+{
+InputRecorder::InputRecorder(const std::string& path)
+    : m_out(path, std::ios::binary | std::ios::trunc)
+    , m_buf()
+{
+    if (!m_out)
+    {
+        throw std::runtime_error("could not open input log for writing: " + path);
+    }
+    m_buf.reserve(2 * FLUSH_THRESHOLD);
+    m_buf.insert(m_buf.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    put<std::uint16_t>(VERSION);
+}
+
+template <class T>
+void InputRecorder::put(T value)
+{
+    // we only target little endian hosts, so the in-memory representation is the file format
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    m_buf.insert(m_buf.end(), bytes, bytes + sizeof(T));
+}
+
+void InputRecorder::write_frame(double seconds)
+{
+    put<std::uint8_t>(static_cast<std::uint8_t>(RecordType::frame));
+    put<double>(seconds);
+
+    if (m_buf.size() >= FLUSH_THRESHOLD)
+    {
+        flush();
+    }
+}
+
+void InputRecorder::write_event(const Event& ev)
+{
+    switch (ev.type)
+    {
+    case EventType::key:
+        put<std::uint8_t>(static_cast<std::uint8_t>(RecordType::key));
+        put<std::int16_t>(static_cast<std::int16_t>(ev.code));
+        put<std::int16_t>(static_cast<std::int16_t>(ev.scancode));
+        put<std::uint8_t>(static_cast<std::uint8_t>(ev.action));
+        put<std::uint8_t>(static_cast<std::uint8_t>(ev.mods));
+        break;
+    case EventType::mouse_button:
+        put<std::uint8_t>(static_cast<std::uint8_t>(RecordType::mouse_button));
+        put<std::uint8_t>(static_cast<std::uint8_t>(ev.code));
+        put<std::uint8_t>(static_cast<std::uint8_t>(ev.action));
+        put<std::uint8_t>(static_cast<std::uint8_t>(ev.mods));
+        put<float>(static_cast<float>(ev.x));
+        put<float>(static_cast<float>(ev.y));
+        break;
+    case EventType::cursor_pos:
+        put<std::uint8_t>(static_cast<std::uint8_t>(RecordType::cursor_pos));
+        put<float>(static_cast<float>(ev.x));
+        put<float>(static_cast<float>(ev.y));
+        break;
+    case EventType::resize:
+        put<std::uint8_t>(static_cast<std::uint8_t>(RecordType::resize));
+        put<std::int32_t>(ev.width);
+        put<std::int32_t>(ev.height);
+        break;
+    }
+}
+
+void InputRecorder::write_window_size(int width, int height)
+{
+    put<std::uint8_t>(static_cast<std::uint8_t>(RecordType::window_size));
+    put<std::int32_t>(width);
+    put<std::int32_t>(height);
+}
+
+void InputRecorder::flush()
+{
+    m_out.write(m_buf.data(), m_buf.size());
+    m_out.flush();
+    m_buf.clear();
+}
+
+InputRecorder::~InputRecorder()
+{
+    flush();
+}
+
+InputReplayer::InputReplayer(const std::string& path)
+    : m_data()
+    , m_pos(0)
+    , m_num_frames(0)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        throw std::runtime_error("could not open input log: " + path);
+    }
+    m_data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+    if (m_data.size() < sizeof(MAGIC) + sizeof(VERSION)
+        || std::memcmp(m_data.data(), MAGIC, sizeof(MAGIC)) != 0)
+    {
+        throw std::runtime_error("not an input log: " + path);
+    }
+    m_pos = sizeof(MAGIC);
+    const std::uint16_t version = get<std::uint16_t>();
+    if (version != VERSION)
+    {
+        throw std::runtime_error("unsupported input log version " + std::to_string(version));
+    }
+
+    // count frames up front so replays can report progress
+    const std::size_t start = m_pos;
+    Record rec;
+    while (next(rec))
+    {
+        if (rec.type == RecordType::frame)
+        {
+            ++m_num_frames;
+        }
+    }
+    m_pos = start;
+}
+
+template <class T>
+T InputReplayer::get()
+{
+    if (m_pos + sizeof(T) > m_data.size())
+    {
+        throw std::runtime_error("truncated input log");
+    }
+    T value;
+    std::memcpy(&value, &m_data[m_pos], sizeof(T));
+    m_pos += sizeof(T);
+    return value;
+}
+
+bool InputReplayer::next(Record& rec)
+{
+    if (at_end())
+    {
+        return false;
+    }
+
+    rec = Record();
+    rec.type = static_cast<RecordType>(get<std::uint8_t>());
+    Event& ev = rec.event;
+    switch (rec.type)
+    {
+    case RecordType::frame:
+        rec.timestamp = get<double>();
+        break;
+    case RecordType::key:
+        ev.type = EventType::key;
+        ev.code = get<std::int16_t>();
+        ev.scancode = get<std::int16_t>();
+        ev.action = get<std::uint8_t>();
+        ev.mods = get<std::uint8_t>();
+        break;
+    case RecordType::mouse_button:
+        ev.type = EventType::mouse_button;
+        ev.code = get<std::uint8_t>();
+        ev.action = get<std::uint8_t>();
+        ev.mods = get<std::uint8_t>();
+        ev.x = get<float>();
+        ev.y = get<float>();
+        break;
+    case RecordType::cursor_pos:
+        ev.type = EventType::cursor_pos;
+        ev.x = get<float>();
+        ev.y = get<float>();
+        break;
+    case RecordType::resize:
+        ev.type = EventType::resize;
+        ev.width = get<std::int32_t>();
+        ev.height = get<std::int32_t>();
+        break;
+    case RecordType::window_size:
+        ev.width = get<std::int32_t>();
+        ev.height = get<std::int32_t>();
+        break;
+    default:
+        throw std::runtime_error("corrupt input log: unknown record type "
+            + std::to_string(static_cast<int>(rec.type)));
+    }
+    return true;
+}
+
+RecordType InputReplayer::peek_type() const
+{
+    return static_cast<RecordType>(m_data[m_pos]);
+}
+
+bool InputReplayer::at_end() const
+{
+    return m_pos >= m_data.size();
+}
+
+std::size_t InputReplayer::num_frames() const
+{
+    return m_num_frames;
+}
+} // namespace input
+} // namespace svm
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "input.h"
+
+namespace svm
+{
+namespace input
+{
+// Compact binary log of a session's input, written by InputRecorder and read back by InputReplayer.
+//
+// Layout: the 4 byte magic "SVMI" and a u16 version, then a sequence of records, each a u8 type
+// followed by a fixed payload. All values are little endian.
+//     frame        f64 seconds since recording started
+//     key          i16 key, i16 scancode, u8 action, u8 mods
+//     mouse_button u8 button, u8 action, u8 mods, f32 x, f32 y
+//     cursor_pos   f32 x, f32 y
+//     resize       i32 framebuffer width, i32 framebuffer height
+//     window_size  i32 width, i32 height
+// A frame record is written at the start of every Window::poll_events(); the records after it are
+// the input that poll delivered. The first frame starts with the window size.
+enum class RecordType: std::uint8_t
+{
+    frame = 0,
+    key = 1,
+    mouse_button = 2,
+    cursor_pos = 3,
+    resize = 4,
+    window_size = 5
+};
+
+struct Record
+{
+    RecordType type;
+    double timestamp;   // frame records only
+    Event event;        // input records; window_size uses width/height
+};
+
+class InputRecorder
+{
+public:
+    explicit InputRecorder(const std::string& path);
+
+    InputRecorder(const InputRecorder&) = delete;
+    InputRecorder& operator=(const InputRecorder&) = delete;
+
+    void write_frame(double seconds);
+    void write_event(const Event& ev);
+    void write_window_size(int width, int height);
+    void flush();
+
+    ~InputRecorder();
+
+private:
+    template <class T>
+    void put(T value);
+
+    std::ofstream m_out;
+    std::vector<char> m_buf;
+};
+
+class InputReplayer
+{
+public:
+    explicit InputReplayer(const std::string& path);
+
+    // Reads the next record, returning false at the end of the log
+    bool next(Record& rec);
+    // Type of the record next() would return; only valid if !at_end()
+    RecordType peek_type() const;
+    bool at_end() const;
+
+    std::size_t num_frames() const;
+
+private:
+    template <class T>
+    T get();
+
+    std::vector<char> m_data;
+    std::size_t m_pos;
+    std::size_t m_num_frames;
+};
+} // namespace input
+} // namespace svm
@@ -0,0 +1,398 @@
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+#include "jobs.h"
+#include "scope_guard.h"
+
+namespace
+{
+// Which pool and worker the calling thread belongs to, so tasks it submits go to its own deque
+thread_local const svm::jobs::JobSystem* current_pool = nullptr;
+thread_local int current_worker = -1;
+
+// How long a waiting thread with nothing to steal sleeps before looking for new work again
+constexpr const std::chrono::milliseconds WAIT_POLL(1);
+} // anonymous namespace
+
+namespace svm
+{
+namespace jobs
+{
+struct Task
+{
+    explicit Task(std::function<void()> fn_)
+        : fn(std::move(fn_))
+        , pending(1)
+        , mutex()
+        , dependents()
+        , done(false)
+        , error()
+    {}
+
+    std::function<void()> fn;
+    // unfinished dependencies, plus one until submit() has registered them all
+    std::atomic<int> pending;
+    // guards dependents and the switch to done
+    std::mutex mutex;
+    std::vector<TaskHandle> dependents;
+    std::atomic<bool> done;
+    std::exception_ptr error;
+};
+
+JobSystem& JobSystem::instance()
+{
+    static JobSystem pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+JobSystem::JobSystem(unsigned num_workers)
+    : m_workers()
+    , m_queued(0)
+    , m_next_worker(0)
+    , m_sleep_mutex()
+    , m_wake()
+    , m_finished()
+    , m_stop(false)
+    , m_main_mutex()
+    , m_main_tasks()
+    , m_main_running()
+{
+    num_workers = std::max(1u, num_workers);
+    for (unsigned i = 0; i < num_workers; ++i)
+    {
+        // value-initialized, so the counters start at 0
+        m_workers.emplace_back(new Worker());
+    }
+    // only start them once every deque exists, since they steal from each other
+    for (unsigned i = 0; i < num_workers; ++i)
+    {
+        m_workers[i]->thread = std::thread([this, i]()
+        {
+            worker_loop(static_cast<int>(i));
+        });
+    }
+}
+
+unsigned JobSystem::num_workers() const
+{
+    return static_cast<unsigned>(m_workers.size());
+}
+
+TaskHandle JobSystem::submit(std::function<void()> fn, const std::vector<TaskHandle>& deps)
+{
+    TaskHandle task = std::make_shared<Task>(std::move(fn));
+    for (const TaskHandle& dep: deps)
+    {
+        std::lock_guard<std::mutex> lock(dep->mutex);
+        if (!dep->done)
+        {
+            task->pending.fetch_add(1);
+            dep->dependents.push_back(task);
+        }
+    }
+    if (task->pending.fetch_sub(1) == 1)
+    {
+        enqueue(task);
+    }
+    return task;
+}
+
+bool JobSystem::is_done(const TaskHandle& task)
+{
+    return task->done;
+}
+
+void JobSystem::wait(const TaskHandle& task)
+{
+    const int self = (current_pool == this) ? current_worker : -1;
+    while (!task->done)
+    {
+        // a thread outside the pool, like the GL thread, only runs the task it waits for, so it
+        // can't get stuck in someone else's long job
+        const bool ran = (self >= 0) ? run_one(self) : run_if_queued(task);
+        if (!ran)
+        {
+            std::unique_lock<std::mutex> lock(m_sleep_mutex);
+            m_finished.wait_for(lock, WAIT_POLL, [&task]()
+            {
+                return task->done.load();
+            });
+        }
+    }
+    if (task->error)
+    {
+        std::rethrow_exception(task->error);
+    }
+}
+
+void JobSystem::parallel_for(int begin, int end, int grain, const std::function<void(int, int)>& fn)
+{
+    grain = std::max(1, grain);
+    if (end - begin <= grain)
+    {
+        if (end > begin)
+        {
+            fn(begin, end);
+        }
+        return;
+    }
+    parallel_for_2d(end - begin, 1, grain, 1, [begin, &fn](int x0, int, int x1, int)
+    {
+        fn(begin + x0, begin + x1);
+    });
+}
+
+void JobSystem::parallel_for_2d(int width, int height, int tile_width, int tile_height,
+    const std::function<void(int, int, int, int)>& fn)
+{
+    tile_width = std::max(1, tile_width);
+    tile_height = std::max(1, tile_height);
+    std::vector<TaskHandle> tiles;
+    tiles.reserve(static_cast<std::size_t>((width + tile_width - 1) / tile_width)
+        * ((height + tile_height - 1) / tile_height));
+    for (int y = 0; y < height; y += tile_height)
+    {
+        for (int x = 0; x < width; x += tile_width)
+        {
+            const int x1 = std::min(width, x + tile_width);
+            const int y1 = std::min(height, y + tile_height);
+            tiles.push_back(submit([&fn, x, y, x1, y1]()
+            {
+                fn(x, y, x1, y1);
+            }));
+        }
+    }
+
+    // every tile has to finish before fn goes out of scope, even if one threw
+    std::exception_ptr error;
+    for (const TaskHandle& tile: tiles)
+    {
+        try
+        {
+            wait(tile);
+        }
+        catch (...)
+        {
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void JobSystem::post_to_main(std::function<void()> fn)
+{
+    std::lock_guard<std::mutex> lock(m_main_mutex);
+    m_main_tasks.push_back(std::move(fn));
+}
+
+std::size_t JobSystem::run_main_thread_tasks()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_main_mutex);
+        if (m_main_tasks.empty())
+        {
+            return 0;
+        }
+        // swapping keeps both vectors' capacity, so steady state doesn't allocate
+        m_main_tasks.swap(m_main_running);
+    }
+    tools::ScopeGuard clear([this]()
+    {
+        m_main_running.clear();
+    });
+    for (std::function<void()>& fn: m_main_running)
+    {
+        fn();
+    }
+    return m_main_running.size();
+}
+
+WorkerStats JobSystem::worker_stats(unsigned worker) const
+{
+    const Worker& w = *m_workers[worker];
+    WorkerStats stats;
+    stats.tasks_run = w.tasks_run;
+    stats.tasks_stolen = w.tasks_stolen;
+    stats.busy_seconds = w.busy_ns * 1e-9;
+    return stats;
+}
+
+void JobSystem::enqueue(TaskHandle task)
+{
+    const int self = (current_pool == this) ? current_worker : -1;
+    Worker& worker = *m_workers[(self >= 0) ? self : m_next_worker++ % m_workers.size()];
+    // counted before it can be taken, so the count never drops below the tasks actually queued
+    m_queued.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    {
+        // a worker checks m_queued under this lock before it sleeps, so the wakeup can't be missed
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+    }
+    m_wake.notify_one();
+}
+
+TaskHandle JobSystem::take_task(int self, bool& stolen)
+{
+    TaskHandle task;
+    if (self >= 0)
+    {
+        Worker& own = *m_workers[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            stolen = false;
+            return task;
+        }
+    }
+
+    const unsigned num = static_cast<unsigned>(m_workers.size());
+    const unsigned start = (self >= 0) ? static_cast<unsigned>(self) + 1 : m_next_worker.load();
+    for (unsigned i = 0; i < num; ++i)
+    {
+        const unsigned victim_index = (start + i) % num;
+        if (static_cast<int>(victim_index) == self)
+        {
+            continue;
+        }
+        Worker& victim = *m_workers[victim_index];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            stolen = true;
+            return task;
+        }
+    }
+    return task;
+}
+
+bool JobSystem::run_one(int self)
+{
+    bool stolen = false;
+    const TaskHandle task = take_task(self, stolen);
+    if (!task)
+    {
+        return false;
+    }
+    m_queued.fetch_sub(1);
+
+    const auto start = std::chrono::steady_clock::now();
+    execute(task);
+    if (self >= 0)
+    {
+        Worker& worker = *m_workers[self];
+        worker.busy_ns += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        ++worker.tasks_run;
+        if (stolen)
+        {
+            ++worker.tasks_stolen;
+        }
+    }
+    return true;
+}
+
+bool JobSystem::run_if_queued(const TaskHandle& task)
+{
+    bool found = false;
+    for (const std::unique_ptr<Worker>& worker: m_workers)
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        const auto it = std::find(worker->tasks.begin(), worker->tasks.end(), task);
+        if (it != worker->tasks.end())
+        {
+            worker->tasks.erase(it);
+            found = true;
+            break;
+        }
+    }
+    if (!found)
+    {
+        return false;
+    }
+    m_queued.fetch_sub(1);
+    execute(task);
+    return true;
+}
+
+void JobSystem::execute(const TaskHandle& task)
+{
+    try
+    {
+        task->fn();
+    }
+    catch (...)
+    {
+        task->error = std::current_exception();
+    }
+    // drop what the task captured now rather than whenever the last handle goes
+    task->fn = nullptr;
+
+    std::vector<TaskHandle> ready;
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->done = true;
+        ready.swap(task->dependents);
+    }
+    for (TaskHandle& dependent: ready)
+    {
+        if (dependent->pending.fetch_sub(1) == 1)
+        {
+            enqueue(std::move(dependent));
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+    }
+    m_finished.notify_all();
+}
+
+void JobSystem::worker_loop(int self)
+{
+    current_pool = this;
+    current_worker = self;
+    while (true)
+    {
+        if (run_one(self))
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        m_wake.wait(lock, [this]()
+        {
+            return m_stop || m_queued.load() > 0;
+        });
+        if (m_stop && m_queued.load() == 0)
+        {
+            return;
+        }
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (const std::unique_ptr<Worker>& worker: m_workers)
+    {
+        worker->thread.join();
+    }
+}
+} // namespace jobs
+} // namespace svm
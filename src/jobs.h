@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace svm
+{
+namespace jobs
+{
+struct Task;
+using TaskHandle = std::shared_ptr<Task>;
+
+struct WorkerStats
+{
+    std::uint64_t tasks_run = 0;
+    // of tasks_run, how many were taken from another worker's deque
+    std::uint64_t tasks_stolen = 0;
+    double busy_seconds = 0;
+};
+
+// Thread pool for CPU-side work. Every worker has its own deque: it pushes and pops the newest
+// tasks at the back, and when it runs dry steals the oldest from the front of another's, so big
+// batches spread out without a shared queue everyone contends on. Tasks may depend on other
+// tasks, and workers that wait for a task run queued ones in the meantime, so waiting inside a
+// task doesn't tie up a worker. Threads outside the pool only ever run the task they wait for.
+// Results for the GL thread go through post_to_main().
+class JobSystem
+{
+public:
+    // The pool the whole program shares: one worker per core, less one for the GL thread
+    static JobSystem& instance();
+
+    // Starts at least one worker
+    explicit JobSystem(unsigned num_workers);
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned num_workers() const;
+
+    // Queues fn to run once every task in deps has finished. Exceptions are kept for wait().
+    TaskHandle submit(std::function<void()> fn, const std::vector<TaskHandle>& deps = {});
+
+    template <class F>
+    auto async(F&& fn, const std::vector<TaskHandle>& deps = {}) -> std::future<decltype(fn())>
+    {
+        using result_t = decltype(fn());
+        auto task = std::make_shared<std::packaged_task<result_t()>>(std::forward<F>(fn));
+        std::future<result_t> res = task->get_future();
+        submit([task]()
+        {
+            (*task)();
+        }, deps);
+        return res;
+    }
+
+    static bool is_done(const TaskHandle& task);
+    // Blocks until task has finished, then rethrows anything it threw. A worker runs queued tasks
+    // in the meantime; any other thread runs task itself if nobody has started it yet.
+    void wait(const TaskHandle& task);
+
+    // Runs fn(chunk_begin, chunk_end) over [begin, end) in chunks of grain, the calling thread
+    // included, and returns when all are done. Rethrows the first exception a chunk threw.
+    void parallel_for(int begin, int end, int grain, const std::function<void(int, int)>& fn);
+    // Same over a width x height grid in tiles, calling fn(x0, y0, x1, y1)
+    void parallel_for_2d(int width, int height, int tile_width, int tile_height,
+        const std::function<void(int, int, int, int)>& fn);
+
+    // Queues fn for the GL thread, which runs it at its next run_main_thread_tasks()
+    void post_to_main(std::function<void()> fn);
+    // Call once per frame on the GL thread; returns how many tasks ran
+    std::size_t run_main_thread_tasks();
+
+    WorkerStats worker_stats(unsigned worker) const;
+
+    // Finishes everything already queued before the workers exit
+    ~JobSystem();
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<TaskHandle> tasks;
+        std::atomic<std::uint64_t> tasks_run;
+        std::atomic<std::uint64_t> tasks_stolen;
+        std::atomic<std::uint64_t> busy_ns;
+        std::thread thread;
+    };
+
+    void enqueue(TaskHandle task);
+    // Pops from worker `self`'s deque (-1 for threads outside the pool) or steals from another
+    TaskHandle take_task(int self, bool& stolen);
+    bool run_one(int self);
+    // Takes task out of whichever deque holds it and runs it; false if it's not queued
+    bool run_if_queued(const TaskHandle& task);
+    void execute(const TaskHandle& task);
+    void worker_loop(int self);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    // tasks sitting in any deque
+    std::atomic<int> m_queued;
+    std::atomic<unsigned> m_next_worker;
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_finished;
+    bool m_stop;
+
+    std::mutex m_main_mutex;
+    std::vector<std::function<void()>> m_main_tasks;
+    std::vector<std::function<void()>> m_main_running;
+};
+} // namespace jobs
+} // namespace svm
@@ -0,0 +1,180 @@
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "jpeg_reader.h"
+
+#ifdef SVM_HAVE_LIBJPEG
+#include <csetjmp>
+#include <jpeglib.h>
+#endif
+
+namespace svm
+{
+namespace image
+{
+bool is_jpeg_file(const char* path)
+{
+    std::ifstream in(path, std::ios::binary);
+    unsigned char magic[3] = {};
+    in.read(reinterpret_cast<char*>(magic), sizeof(magic));
+    return in && magic[0] == 0xFF && magic[1] == 0xD8 && magic[2] == 0xFF;
+}
+
+#ifdef SVM_HAVE_LIBJPEG
+namespace
+{
+struct ErrorManager
+{
+    jpeg_error_mgr pub;
+    std::jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+};
+
+// libjpeg's default handler calls exit(); jump back to the caller instead. We can't throw through
+// the C library, so every entry point sets up the jump buffer and throws once it is back in C++.
+void error_exit(j_common_ptr cinfo)
+{
+    ErrorManager* err = reinterpret_cast<ErrorManager*>(cinfo->err);
+    (*cinfo->err->format_message)(cinfo, err->message);
+    std::longjmp(err->jump, 1);
+}
+} // anonymous namespace
+
+struct JpegReader::Impl
+{
+    jpeg_decompress_struct cinfo;
+    ErrorManager err;
+    FILE* file;
+};
+
+JpegReader::JpegReader(const char* path, int min_height)
+    : m_impl(new Impl())
+{
+    m_impl->file = std::fopen(path, "rb");
+    if (m_impl->file == nullptr)
+    {
+        throw std::runtime_error(std::string("could not open file: ") + path);
+    }
+
+    jpeg_decompress_struct& cinfo = m_impl->cinfo;
+    cinfo.err = jpeg_std_error(&m_impl->err.pub);
+    m_impl->err.pub.error_exit = error_exit;
+    jpeg_create_decompress(&cinfo);
+
+    if (setjmp(m_impl->err.jump))
+    {
+        const std::string message = m_impl->err.message;
+        jpeg_destroy_decompress(&cinfo);
+        std::fclose(m_impl->file);
+        m_impl->file = nullptr;
+        throw std::runtime_error(std::string("could not decode ") + path + ": " + message);
+    }
+
+    jpeg_stdio_src(&cinfo, m_impl->file);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = 1;
+    while (min_height > 0 && cinfo.scale_denom < 8
+        && static_cast<int>(cinfo.image_height / (cinfo.scale_denom * 2)) >= min_height)
+    {
+        cinfo.scale_denom *= 2;
+    }
+    jpeg_start_decompress(&cinfo);
+}
+
+int JpegReader::width() const
+{
+    return static_cast<int>(m_impl->cinfo.output_width);
+}
+
+int JpegReader::height() const
+{
+    return static_cast<int>(m_impl->cinfo.output_height);
+}
+
+int JpegReader::num_channels() const
+{
+    return m_impl->cinfo.output_components;
+}
+
+int JpegReader::rows_read() const
+{
+    return static_cast<int>(m_impl->cinfo.output_scanline);
+}
+
+int JpegReader::scale_denom() const
+{
+    return static_cast<int>(m_impl->cinfo.scale_denom);
+}
+
+void JpegReader::read_rows(unsigned char* dst, int rows, std::ptrdiff_t stride)
+{
+    jpeg_decompress_struct& cinfo = m_impl->cinfo;
+    if (setjmp(m_impl->err.jump))
+    {
+        throw std::runtime_error(std::string("jpeg decode failed: ") + m_impl->err.message);
+    }
+
+    for (int i = 0; i < rows && cinfo.output_scanline < cinfo.output_height; ++i)
+    {
+        JSAMPROW row = dst + i * stride;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+}
+
+JpegReader::~JpegReader()
+{
+    if (m_impl->file == nullptr)
+    {
+        return;
+    }
+    // abort rather than finish, since the caller may stop before the last scanline
+    jpeg_abort_decompress(&m_impl->cinfo);
+    jpeg_destroy_decompress(&m_impl->cinfo);
+    std::fclose(m_impl->file);
+}
+#else
+struct JpegReader::Impl
+{};
+
+JpegReader::JpegReader(const char*, int)
+{
+    throw std::logic_error("built without libjpeg");
+}
+
+int JpegReader::width() const
+{
+    return 0;
+}
+
+int JpegReader::height() const
+{
+    return 0;
+}
+
+int JpegReader::num_channels() const
+{
+    return 0;
+}
+
+int JpegReader::rows_read() const
+{
+    return 0;
+}
+
+int JpegReader::scale_denom() const
+{
+    return 1;
+}
+
+void JpegReader::read_rows(unsigned char*, int, std::ptrdiff_t)
+{}
+
+JpegReader::~JpegReader()
+{}
+#endif // SVM_HAVE_LIBJPEG
+} // namespace image
+} // namespace svm
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace svm
+{
+namespace image
+{
+// True if the file starts with a JPEG SOI marker
+bool is_jpeg_file(const char* path);
+
+// Scanline-at-a-time JPEG decoder (libjpeg), so callers can decode straight into their own
+// buffers in bands instead of holding the whole decoded image. Only available when built with
+// SVM_HAVE_LIBJPEG.
+class JpegReader
+{
+public:
+    // With a min_height, decodes at the smallest of libjpeg's DCT-domain scales (1/2, 1/4 or 1/8)
+    // that is still at least min_height rows tall, which skips most of the IDCT work
+    explicit JpegReader(const char* path, int min_height = 0);
+
+    JpegReader(const JpegReader&) = delete;
+    JpegReader& operator=(const JpegReader&) = delete;
+
+    // Decoded size (RGB, 3 channels)
+    int width() const;
+    int height() const;
+    int num_channels() const;
+    int rows_read() const;
+    // The decoded size is 1/scale_denom of the original
+    int scale_denom() const;
+
+    // Decodes the next `rows` scanlines (top-down). Row i goes to dst + i * stride; a negative
+    // stride writes the band bottom-up.
+    void read_rows(unsigned char* dst, int rows, std::ptrdiff_t stride);
+
+    ~JpegReader();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+} // namespace image
+} // namespace svm
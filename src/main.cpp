@@ -1,57 +1,509 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <future>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include "background.h"
+#include "depth_map.h"
+#include "hud.h"
+#include "image_session.h"
+#include "jobs.h"
 #include "mesh.h"
+#include "panorama.h"
+#include "resource_registry.h"
+#include "screenshot.h"
+#include "sequence.h"
 #include "texture.h"
+#include "undistort.h"
 #include "window.h"
 
 using namespace svm::background;
 using namespace svm::mesh;
 using namespace svm::scene;
+using namespace svm::sequence;
+using namespace svm::session;
 using namespace svm::texture;
 using namespace svm::window;
 
 static constexpr const int DEFAULT_WIDTH = 800;
 static constexpr const int DEFAULT_HEIGHT = 600;
 static constexpr const char* const DEFAULT_TITLE = "Single View Modeling";
+// how long a notice replaces the HUD status line
+static constexpr const double NOTICE_SECONDS = 4.0;
+static constexpr const char* const USAGE =
+    "usage: single_view_modeling [--record <LOG> | --replay <LOG> [--realtime]] "
+    "[--memory-log <SECONDS>] [--gpu-budget <MIB>] [--texture-cache <N>] "
+    "[--sequence [--fps <N>] [--decode-threads <N>]] [--stereo [--ipd <UNITS>]] "
+    "[--panorama <OUT> [--panorama-width <N>]] [--depth-map <OUT>] [--point-cloud <OUT>] "
+    "[--low-latency [--swap-interval <N>] [--frames-in-flight <N>]] [--latency] [--accumulate <N>] [--hud] "
+    "[--screenshot-dir <DIR>] [--undistort <K1,K2,K3,P1,P2>] [--watch] <IMAGE OR DIRECTORY>...";
+
+struct Options
+{
+    std::vector<std::string> image_paths;
+    const char* record_path = nullptr;
+    const char* replay_path = nullptr;
+    bool replay_realtime = false;
+    double memory_log_interval = 0;
+    double gpu_budget_mib = 0;
+    int texture_cache = ImageSession::DEFAULT_CACHE_SIZE;
+    bool sequence = false;
+    double sequence_fps = 0;
+    int decode_threads = 0;
+    bool stereo = false;
+    double ipd = 0.5;
+    const char* panorama_path = "panorama.png";
+    int panorama_width = 8192;
+    const char* depth_map_path = "depth.pfm";
+    const char* point_cloud_path = "points.ply";
+    bool low_latency = false;
+    int swap_interval = 1;
+    int frames_in_flight = 1;
+    bool report_latency = false;
+    int accumulate_frames = 16;
+    bool hud = false;
+    const char* screenshot_dir = ".";
+    svm::undistort::LensModel lens;
+    bool watch = false;
+};
+
+// One-shot actions the keyboard callback asks the frame loop for
+struct KeyRequests
+{
+    // Page Down / Page Up step through the images; each one reopens in the editor with the
+    // handles it was last left with
+    int image_step = 0;
+    // P in theater mode saves a 360 degree panorama from where the camera stands
+    bool export_panorama = false;
+    // X in theater mode writes the image's depth map and point cloud under the box model
+    bool export_depth = false;
+    // F12 saves what the window shows, without the overlay
+    bool screenshot = false;
+    // H shows or hides the performance overlay
+    bool toggle_hud = false;
+};
+
+bool parse_options(int argc, const char* argv[], Options& opts)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            opts.record_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            opts.replay_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--realtime") == 0)
+        {
+            opts.replay_realtime = true;
+        }
+        else if (std::strcmp(argv[i], "--memory-log") == 0 && i + 1 < argc)
+        {
+            opts.memory_log_interval = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--gpu-budget") == 0 && i + 1 < argc)
+        {
+            opts.gpu_budget_mib = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--texture-cache") == 0 && i + 1 < argc)
+        {
+            opts.texture_cache = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--sequence") == 0)
+        {
+            opts.sequence = true;
+        }
+        else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+        {
+            opts.sequence_fps = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--decode-threads") == 0 && i + 1 < argc)
+        {
+            opts.decode_threads = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--stereo") == 0)
+        {
+            opts.stereo = true;
+        }
+        else if (std::strcmp(argv[i], "--ipd") == 0 && i + 1 < argc)
+        {
+            opts.ipd = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--panorama") == 0 && i + 1 < argc)
+        {
+            opts.panorama_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--panorama-width") == 0 && i + 1 < argc)
+        {
+            opts.panorama_width = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--depth-map") == 0 && i + 1 < argc)
+        {
+            opts.depth_map_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--point-cloud") == 0 && i + 1 < argc)
+        {
+            opts.point_cloud_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--low-latency") == 0)
+        {
+            opts.low_latency = true;
+        }
+        else if (std::strcmp(argv[i], "--swap-interval") == 0 && i + 1 < argc)
+        {
+            opts.swap_interval = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+        {
+            opts.frames_in_flight = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--latency") == 0)
+        {
+            opts.report_latency = true;
+        }
+        else if (std::strcmp(argv[i], "--accumulate") == 0 && i + 1 < argc)
+        {
+            opts.accumulate_frames = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--hud") == 0)
+        {
+            opts.hud = true;
+        }
+        else if (std::strcmp(argv[i], "--screenshot-dir") == 0 && i + 1 < argc)
+        {
+            opts.screenshot_dir = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--undistort") == 0 && i + 1 < argc)
+        {
+            if (!svm::undistort::parse_lens(argv[++i], opts.lens))
+            {
+                return false;
+            }
+        }
+        else if (std::strcmp(argv[i], "--watch") == 0)
+        {
+            opts.watch = true;
+        }
+        else if (argv[i][0] != '-')
+        {
+            opts.image_paths.push_back(argv[i]);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return !opts.image_paths.empty() && opts.texture_cache > 0 && !(opts.record_path && opts.replay_path);
+}
 
 glm::vec2 gl_coords_to_tex_coords(const glm::vec2& v)
 {
     return (v + glm::vec2(1.0f, 1.0f)) / 2.0f;
 }
 
+// screenshot-YYYYMMDD-HHMMSS.png in dir, numbered when several are taken within a second
+std::string screenshot_path(const std::string& dir)
+{
+    static std::string last_stamp;
+    static int count = 0;
+
+    const std::time_t now = std::time(nullptr);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", std::localtime(&now));
+    count = (last_stamp == stamp) ? count + 1 : 0;
+    last_stamp = stamp;
+
+    std::string path = dir + "/screenshot-" + stamp;
+    if (count > 0)
+    {
+        path += "-" + std::to_string(count);
+    }
+    return path + ".png";
+}
+
+#ifndef UNIT_TESTS
 int main(int argc, const char* argv[])
 {
-    if (argc != 2)
+    Options opts;
+    if (!parse_options(argc, argv, opts))
     {
-        std::cerr << "Invalid usage: single_view_modeling <IMAGE PATH>" << std::endl;
+        std::cerr << "Invalid usage: " << USAGE << std::endl;
         return 1;
     }
 
-    std::shared_ptr<Window> window(new Window(DEFAULT_WIDTH, DEFAULT_HEIGHT, DEFAULT_TITLE));
+    svm::resources::Registry& memory = svm::resources::Registry::instance();
+    memory.set_log_interval(opts.memory_log_interval);
+    memory.set_gpu_budget(static_cast<size_t>(opts.gpu_budget_mib * 1024 * 1024));
+
+    std::shared_ptr<Window> window(new Window(DEFAULT_WIDTH, DEFAULT_HEIGHT, DEFAULT_TITLE,
+        backend_from_env()));
+    if (opts.low_latency)
+    {
+        window->set_frame_pacing(opts.swap_interval, opts.frames_in_flight);
+    }
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glEnable(GL_LINE_SMOOTH);
     glLineWidth(5);
 
-    std::shared_ptr<Texture2D> texture(Texture2D::from_file(argv[1]));
-    Mesh mesh(texture);
-    Background bg(texture);/*, glm::vec2(0.25, 0.75), glm::vec2(0.75, 0.25),
-        glm::vec2(0.5, 0.5), 54);*/
-    //bg.setup(window);
+    // Programs only submit their compile here and link in the background while the first image
+    // decodes. Background itself isn't built until theater mode, but its program starts now too.
+    Mesh mesh(nullptr);
+    svm::shader::ShaderProgram bg_prog = svm::shader::ShaderProgram::textured_object();
+
+    // the editor works from a reduced-scale preview; the full image is decoded in the background
+    // every image is lens-corrected between decode and upload, so the box is placed on straight lines
+    std::shared_ptr<const svm::undistort::Undistorter> undistorter;
+    if (!opts.lens.is_identity())
+    {
+        undistorter = std::make_shared<const svm::undistort::Undistorter>(opts.lens);
+    }
+    const std::vector<std::string> image_paths = collect_image_paths(opts.image_paths);
+    ImageSession images(image_paths, Mesh::WINDOW_HEIGHT, opts.texture_cache, undistorter);
+    mesh.set_texture(images.preview_texture());
+    mesh.set_edge_index(images.edge_index());
+    std::unique_ptr<Background> bg;
+    if (opts.watch)
+    {
+        try
+        {
+            images.set_watching(true);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    // In sequence mode the box is placed on the first image, then theater mode plays all of them
+    // through the same geometry
+    std::unique_ptr<SequenceStreamer> sequence;
+    double sequence_start = 0;
+    std::string sequence_error;
+
+    if (opts.record_path)
+    {
+        window->start_recording(opts.record_path);
+    }
+    else if (opts.replay_path)
+    {
+        window->start_replay(opts.replay_path, opts.replay_realtime);
+    }
+
+    KeyRequests keys;
+    svm::hud::Hud hud;
+    hud.set_visible(opts.hud);
+    svm::screenshot::ScreenshotCapture screenshots;
+    // a one-off message, like a finished export, takes over the HUD status line for a while
+    char notice[svm::hud::Hud::MAX_STATUS_LENGTH] = "";
+    double notice_until = -1;
+
+    std::future<void> depth_export;
+    double depth_export_start = 0;
+    const auto finish_depth_export = [&]()
+    {
+        try
+        {
+            depth_export.get();
+            std::snprintf(notice, sizeof(notice), "wrote %s in %.1f s", opts.depth_map_path,
+                Window::now() - depth_export_start);
+            notice_until = Window::now() + NOTICE_SECONDS;
+            std::cout << "wrote " << opts.depth_map_path << " and " << opts.point_cloud_path << " in "
+                << Window::now() - depth_export_start << " s" << std::endl;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    };
+    window->set_keyboard_callback([&keys](int key, int, int action, int)
+    {
+        if (action == GLFW_PRESS && key == GLFW_KEY_PAGE_DOWN)
+        {
+            keys.image_step = 1;
+        }
+        else if (action == GLFW_PRESS && key == GLFW_KEY_PAGE_UP)
+        {
+            keys.image_step = -1;
+        }
+        else if (action == GLFW_PRESS && key == GLFW_KEY_P)
+        {
+            keys.export_panorama = true;
+        }
+        else if (action == GLFW_PRESS && key == GLFW_KEY_X)
+        {
+            keys.export_depth = true;
+        }
+        else if (action == GLFW_PRESS && key == GLFW_KEY_H)
+        {
+            keys.toggle_hud = true;
+        }
+        else if (action == GLFW_PRESS && key == GLFW_KEY_F12)
+        {
+            keys.screenshot = true;
+        }
+    });
 
     Scene* scene = &mesh;
     scene->setup(window);
+    window->reset_allocation_warmup();
 
     std::atexit([](){ glfwTerminate(); });
+    const double start_time = Window::now();
     while (!window->should_close())
     {
+        if (keys.image_step != 0)
+        {
+            try
+            {
+                (keys.image_step > 0) ? images.next() : images.prev();
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << e.what() << std::endl;
+            }
+            keys.image_step = 0;
+            std::cout << "[" << images.current_index() + 1 << "/" << images.size() << "] "
+                << images.current_path() << std::endl;
+
+            mesh.set_texture(images.preview_texture());
+            mesh.set_edge_index(images.edge_index());
+            if (bg)
+            {
+                bg->set_texture(images.preview_texture());
+            }
+            const BoxParams& params = images.box_params();
+            if (params.valid)
+            {
+                mesh.set_initial_handles(params.top_left, params.bot_right, params.vanishing);
+            }
+            else
+            {
+                mesh.clear_initial_handles();
+            }
+            scene = &mesh;
+            scene->setup(window);
+            window->reset_allocation_warmup();
+            continue;
+        }
+
+        // Work that only some frames do, like reloads, exports and finished readbacks, comes before
+        // the render section that the allocation check covers
+        if (images.update())
+        {
+            // edited on disk; the handles and camera stay as they are
+            std::cout << "reloaded " << images.current_path() << std::endl;
+            mesh.set_texture(images.preview_texture());
+            mesh.set_edge_index(images.edge_index());
+            if (bg && !sequence)
+            {
+                bg->set_texture((scene == bg.get()) ? images.full_texture() : images.preview_texture());
+            }
+        }
+
+        if (keys.export_panorama && scene == bg.get())
+        {
+            const double export_start = Window::now();
+            try
+            {
+                svm::panorama::export_equirect(*bg, bg->camera().position(), opts.panorama_width,
+                    opts.panorama_path);
+                std::snprintf(notice, sizeof(notice), "wrote %s in %.1f s", opts.panorama_path,
+                    Window::now() - export_start);
+                notice_until = Window::now() + NOTICE_SECONDS;
+                std::cout << notice << std::endl;
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+        keys.export_panorama = false;
+
+        if (depth_export.valid()
+            && depth_export.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            finish_depth_export();
+        }
+        // decoding the full image and writing both files takes seconds, so it runs on the job system;
+        // another X is ignored until it's done
+        if (keys.export_depth && scene == bg.get() && !depth_export.valid())
+        {
+            const std::string path = sequence ? image_paths[sequence->current_frame()] : images.current_path();
+            const svm::depth::BoxModel box = bg->box_model();
+            const char* depth_path = opts.depth_map_path;
+            const char* cloud_path = opts.point_cloud_path;
+            depth_export_start = Window::now();
+            depth_export = svm::jobs::JobSystem::instance().async(
+                [box, path, depth_path, cloud_path, undistorter]()
+            {
+                svm::depth::export_depth(box, path.c_str(), depth_path, cloud_path, undistorter.get());
+            });
+        }
+        keys.export_depth = false;
+
+        if (keys.screenshot)
+        {
+            screenshots.request(screenshot_path(opts.screenshot_dir));
+        }
+        keys.screenshot = false;
+
+        // the first time the overlay shows, it creates its GL objects
+        if (keys.toggle_hud)
+        {
+            hud.toggle();
+        }
+        keys.toggle_hud = false;
+
+        if (sequence && sequence->take_error(sequence_error))
+        {
+            std::cerr << "skipping frame: " << sequence_error << std::endl;
+        }
+        screenshots.update();
+        svm::jobs::JobSystem::instance().run_main_thread_tasks();
+        memory.log_if_due(Window::now(), std::cout);
+
+        window->begin_render();
         scene->process_input(window, 1);
         if (scene == &mesh && mesh.should_switch_scenes())
         {
-            scene = &bg;
-            bg.set_user_params
+            BoxParams& params = images.box_params();
+            params.top_left = mesh.top_left;
+            params.bot_right = mesh.bot_right;
+            params.vanishing = mesh.vanishing;
+            params.valid = true;
+
+            if (!bg)
+            {
+                bg.reset(new Background(images.preview_texture(), std::move(bg_prog)));
+                bg->set_stereo(opts.stereo, static_cast<float>(opts.ipd));
+                svm::accumulation::AccumulationParams accumulation;
+                accumulation.max_frames = opts.accumulate_frames;
+                bg->set_accumulation_params(accumulation);
+            }
+            if (opts.sequence)
+            {
+                if (!sequence)
+                {
+                    sequence.reset(new SequenceStreamer(image_paths, opts.decode_threads, undistorter));
+                    sequence_start = Window::now();
+                }
+                bg->set_texture(sequence->texture());
+            }
+            else
+            {
+                bg->set_texture(images.full_texture());
+            }
+            scene = bg.get();
+            bg->set_user_params
             (
                 gl_coords_to_tex_coords(mesh.top_left),
                 gl_coords_to_tex_coords(mesh.bot_right),
@@ -59,18 +511,96 @@ int main(int argc, const char* argv[])
                 54.0f
             );
             scene->setup(window);
+            window->reset_allocation_warmup();
             continue;
         }
 
+        if (sequence && scene == bg.get())
+        {
+            if (sequence->update(Window::now(), (opts.sequence_fps > 0) ? 1.0 / opts.sequence_fps : 0.0))
+            {
+                bg->reset_accumulation();
+            }
+        }
+
+        hud.begin_frame(Window::now());
+        if (hud.visible())
+        {
+            char status[svm::hud::Hud::MAX_STATUS_LENGTH];
+            if (Window::now() < notice_until)
+            {
+                std::snprintf(status, sizeof(status), "%s", notice);
+            }
+            else if (sequence && scene == bg.get())
+            {
+                std::snprintf(status, sizeof(status), "FRAME %zu/%zu  BUFFERED %zu/%zu",
+                    sequence->current_frame() + 1, sequence->num_frames(), sequence->frames_buffered(),
+                    sequence->num_buffers());
+            }
+            else
+            {
+                std::snprintf(status, sizeof(status), "IMAGE %zu/%zu  DECODES %zu", images.current_index() + 1,
+                    images.size(), images.pending_decodes());
+            }
+            hud.set_status(status);
+        }
+
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        scene->render(window, 1);
+        // until the editor's programs have linked, show the clear color rather than wait on them
+        if (scene != &mesh || mesh.is_ready())
+        {
+            scene->render(window, 1);
+        }
+        if (screenshots.has_request())
+        {
+            int fb_width, fb_height;
+            window->get_framebuffer_size(fb_width, fb_height);
+            screenshots.capture(fb_width, fb_height);
+        }
+        hud.render(*window);
 
         window->swap_buffers();
-        Window::poll_events();
+        window->poll_events();
+    }
+
+    screenshots.finish();
+    if (depth_export.valid())
+    {
+        finish_depth_export();
+    }
+
+    if (opts.memory_log_interval > 0)
+    {
+        memory.log_summary(std::cout);
+    }
+
+    if (sequence && sequence->frames_shown() > 0)
+    {
+        const double elapsed = Window::now() - sequence_start;
+        std::cout << "sequence: " << sequence->frames_shown() << " frames of " << sequence->num_frames()
+            << " in " << elapsed << " s (" << sequence->frames_shown() / elapsed << " fps, "
+            << sequence->frames_skipped() << " skipped)" << std::endl;
+    }
+
+    const svm::window::LatencyStats& latency = window->latency_stats();
+    if ((opts.low_latency || opts.report_latency) && latency.frames > 0)
+    {
+        std::cout << "input-to-present latency: " << latency.total * 1000.0 / latency.frames << " ms avg, "
+            << latency.max * 1000.0 << " ms max over " << latency.frames << " frames"
+            << (opts.low_latency ? "" : " (to the swap call; the GPU may present later)") << std::endl;
+    }
+
+    if (window->is_replaying() && window->replayed_frames() > 0)
+    {
+        const double elapsed = Window::now() - start_time;
+        const size_t frames = window->replayed_frames();
+        std::cout << "replayed " << frames << "/" << window->replay_length() << " frames in "
+            << elapsed << " s (" << frames / elapsed << " fps, "
+            << elapsed * 1000.0 / frames << " ms/frame)" << std::endl;
     }
 
     return 0;
 }
-
+#endif // UNIT_TESTS
@@ -1,6 +1,5 @@
 #include <glm/trigonometric.hpp>
 #include <iostream>
-#include <vector>
 
 #include "mesh.h"
 #include "window.h"
@@ -14,6 +13,8 @@ namespace
     static constexpr const int VANISHING = 4;
 
     static constexpr const double VANISHING_DRAG_RADIUS = 15.0;
+    // how far, in screen pixels, a dragged rear wall edge reaches for an image edge to snap to
+    static constexpr const float SNAP_RADIUS = 8.0f;
 
     static constexpr const float DOT_Z = -0.03f;
     static constexpr const float MESH_Z = -0.02f;
@@ -34,6 +35,21 @@ namespace
         { 0, 2, 3 }
     };
 
+    static constexpr const int NUM_MESH_VERTS = 9;
+    svm::vertex::indexed_line mesh_lines[8] =
+    {
+        // rear wall
+        { 1, 2 },
+        { 2, 4 },
+        { 4, 3 },
+        { 3, 1 },
+        // vanishing point lines
+        { 0, 5 },
+        { 0, 6 },
+        { 0, 7 },
+        { 0, 8 }
+    };
+
     svm::vertex::vertex3_element ui_tex_verts[4] =
     {
         { { -1.0, -1.0, TEX_Z }, { 0.0, 0.0 } },
@@ -64,6 +80,8 @@ namespace svm
 {
 namespace mesh
 {
+constexpr const int Mesh::WINDOW_HEIGHT;
+
 Mesh::Mesh(const std::shared_ptr<texture::Texture2D>& tex)
     : top_left()
     , bot_right()
@@ -75,111 +93,97 @@ Mesh::Mesh(const std::shared_ptr<texture::Texture2D>& tex)
     , m_tex_vao(ui_tex_verts, 4, quad_tris, 2)
     , m_mesh_vao()
     , m_dot_vao(dot_verts, 4, quad_tris, 2)
+    , m_initial_top_left()
+    , m_initial_bot_right()
+    , m_initial_vanishing()
+    , m_has_initial_handles(false)
+    , m_edges()
+    , m_screen_width(0)
+    , m_screen_height(0)
+    , m_snap_disabled(false)
     , m_dragging_edge(-1)
+    , m_button_down(false)
     , m_done(false)
 {}
 
 void Mesh::setup(const window_ptr_t& window)
 {
-    const int win_height = 640;
+    const int win_height = WINDOW_HEIGHT;
     const int win_width = win_height * m_tex->width() / m_tex->height();
     window->set_cursor_enabled(true);
     window->set_window_size(win_width, win_height);
     window->enforce_aspect_ratio(m_tex->width(), m_tex->height());
 
-    top_left = glm::vec2(win_width * 0.25, win_height * 0.25);
-    bot_right = glm::vec2(win_width * 0.75, win_height * 0.75);
-    vanishing = glm::vec2(win_width * 0.5, win_height * 0.5);
+    if (m_has_initial_handles)
+    {
+        const auto gl_2_screen = [win_width, win_height](const glm::vec2& v)
+        {
+            return glm::vec2((v.x + 1.0f) * 0.5f * win_width, (1.0f - v.y) * 0.5f * win_height);
+        };
+        top_left = gl_2_screen(m_initial_top_left);
+        bot_right = gl_2_screen(m_initial_bot_right);
+        vanishing = gl_2_screen(m_initial_vanishing);
+    }
+    else
+    {
+        top_left = glm::vec2(win_width * 0.25, win_height * 0.25);
+        bot_right = glm::vec2(win_width * 0.75, win_height * 0.75);
+        vanishing = glm::vec2(win_width * 0.5, win_height * 0.5);
+    }
+    m_dragging_edge = -1;
+    m_button_down = false;
+    m_snap_disabled = false;
+    m_done = false;
 
     recalculate_mesh(window);
 }
 
 void Mesh::process_input(const window_ptr_t& window, float)
 {
-    if (window->key_is_pressed(GLFW_KEY_ENTER))
-    {
-        // Convert screen coords to GL texture coords
-        top_left = screen_2_gl(window, top_left);
-        bot_right = screen_2_gl(window, bot_right);
-        vanishing = screen_2_gl(window, vanishing);
-        m_done = true;
-        return;
-    }
+    bool moved = false;
+    window->get_window_size(m_screen_width, m_screen_height);
 
-    if (window->is_cursor_pressed())
+    input::Event ev;
+    while (window->events().pop(ev))
     {
-        double cursor_x, cursor_y;
-        window->get_cursor_pos(cursor_x, cursor_y);
-
-        if (m_dragging_edge == VANISHING)
-        {
-            vanishing = glm::vec2(cursor_x, cursor_y);
-        }
-        else if (m_dragging_edge == UP)
-        {
-            top_left.y = cursor_y;
-        }
-        else if (m_dragging_edge == DOWN)
+        if (ev.type == input::EventType::key && ev.code == GLFW_KEY_ENTER && ev.action == GLFW_PRESS)
         {
-            bot_right.y = cursor_y;
+            // Convert screen coords to GL texture coords
+            top_left = screen_2_gl(window, top_left);
+            bot_right = screen_2_gl(window, bot_right);
+            vanishing = screen_2_gl(window, vanishing);
+            m_done = true;
+            return;
         }
-        else if (m_dragging_edge == LEFT)
+        else if (ev.type == input::EventType::key && ev.action != GLFW_REPEAT
+            && (ev.code == GLFW_KEY_LEFT_SHIFT || ev.code == GLFW_KEY_RIGHT_SHIFT))
         {
-            top_left.x = cursor_x;
+            m_snap_disabled = (ev.action == GLFW_PRESS);
         }
-        else if (m_dragging_edge == RIGHT)
+        else if (ev.type == input::EventType::mouse_button && ev.code == GLFW_MOUSE_BUTTON_LEFT)
         {
-            bot_right.x = cursor_x;
-        }
-        else if (m_dragging_edge == -1)
-        {
-            double vanishing_dist2 = (cursor_x - vanishing.x) * (cursor_x - vanishing.x) +
-                (cursor_y - vanishing.y) * (cursor_y - vanishing.y);
-            if (vanishing_dist2 <= VANISHING_DRAG_RADIUS * VANISHING_DRAG_RADIUS) {
-                m_dragging_edge = VANISHING;
-            } else if (cursor_y < top_left.y) {
-                m_dragging_edge = UP;
-            } else if (cursor_y > bot_right.y) {
-                m_dragging_edge = DOWN;
-            } else if (cursor_x < top_left.x) {
-                m_dragging_edge = LEFT;
-            } else if (cursor_x > bot_right.x) {
-                m_dragging_edge = RIGHT;
-            } else {
-                m_dragging_edge = -1;
+            m_button_down = (ev.action == GLFW_PRESS);
+            if (m_button_down)
+            {
+                drag_to(ev.x, ev.y);
+                moved = true;
             }
-        }
-
-        if (bot_right.y < top_left.y)
-        {
-            std::swap(bot_right.y, top_left.y);
-            if (m_dragging_edge == UP) {
-                m_dragging_edge = DOWN;
-            } else if (m_dragging_edge == DOWN) {
-                m_dragging_edge = UP;
-            } else 
+            else
             {
-                throw std::logic_error("top/bottom crossed while not dragging UP/DOWN");
+                //std::cout << "Stopped dragging" << std::endl;
+                m_dragging_edge = -1;
             }
         }
-        else if (bot_right.x < top_left.x)
+        else if (ev.type == input::EventType::cursor_pos && m_button_down)
         {
-            if (m_dragging_edge == LEFT) {
-                m_dragging_edge = RIGHT;
-            } else if (m_dragging_edge == RIGHT) {
-                m_dragging_edge = LEFT;
-            } else 
-            {
-                throw std::logic_error("left/right crossed while not dragging LEFT/RIGHT");
-            }
+            drag_to(ev.x, ev.y);
+            moved = true;
         }
-
-        recalculate_mesh(window);
     }
-    else
+
+    if (moved)
     {
-        //std::cout << "Stopped dragging" << std::endl;
-        m_dragging_edge = -1;
+        recalculate_mesh(window);
     }
 }
 
@@ -236,6 +240,137 @@ bool Mesh::should_switch_scenes() const
     return m_done;
 }
 
+bool Mesh::is_ready() const
+{
+    return m_tex_prog.is_ready() && m_mesh_prog.is_ready() && m_dot_prog.is_ready();
+}
+
+void Mesh::set_texture(const std::shared_ptr<texture::Texture2D>& tex)
+{
+    m_tex = tex;
+}
+
+void Mesh::set_initial_handles(const glm::vec2& top_left, const glm::vec2& bot_right, const glm::vec2& vanishing)
+{
+    m_initial_top_left = top_left;
+    m_initial_bot_right = bot_right;
+    m_initial_vanishing = vanishing;
+    m_has_initial_handles = true;
+}
+
+void Mesh::clear_initial_handles()
+{
+    m_has_initial_handles = false;
+}
+
+void Mesh::set_edge_index(std::shared_ptr<const edges::EdgeIndex> edges)
+{
+    m_edges = std::move(edges);
+}
+
+void Mesh::drag_to(double cursor_x, double cursor_y)
+{
+    // the first event of a drag only picks what to drag
+    const bool moving = (m_dragging_edge != -1);
+
+    if (m_dragging_edge == VANISHING)
+    {
+        vanishing = glm::vec2(cursor_x, cursor_y);
+    }
+    else if (m_dragging_edge == UP)
+    {
+        top_left.y = cursor_y;
+    }
+    else if (m_dragging_edge == DOWN)
+    {
+        bot_right.y = cursor_y;
+    }
+    else if (m_dragging_edge == LEFT)
+    {
+        top_left.x = cursor_x;
+    }
+    else if (m_dragging_edge == RIGHT)
+    {
+        bot_right.x = cursor_x;
+    }
+    else if (m_dragging_edge == -1)
+    {
+        double vanishing_dist2 = (cursor_x - vanishing.x) * (cursor_x - vanishing.x) +
+            (cursor_y - vanishing.y) * (cursor_y - vanishing.y);
+        if (vanishing_dist2 <= VANISHING_DRAG_RADIUS * VANISHING_DRAG_RADIUS) {
+            m_dragging_edge = VANISHING;
+        } else if (cursor_y < top_left.y) {
+            m_dragging_edge = UP;
+        } else if (cursor_y > bot_right.y) {
+            m_dragging_edge = DOWN;
+        } else if (cursor_x < top_left.x) {
+            m_dragging_edge = LEFT;
+        } else if (cursor_x > bot_right.x) {
+            m_dragging_edge = RIGHT;
+        } else {
+            m_dragging_edge = -1;
+        }
+    }
+
+    if (moving)
+    {
+        snap_dragged_edge();
+    }
+
+    if (bot_right.y < top_left.y)
+    {
+        std::swap(bot_right.y, top_left.y);
+        if (m_dragging_edge == UP) {
+            m_dragging_edge = DOWN;
+        } else if (m_dragging_edge == DOWN) {
+            m_dragging_edge = UP;
+        } else 
+        {
+            throw std::logic_error("top/bottom crossed while not dragging UP/DOWN");
+        }
+    }
+    else if (bot_right.x < top_left.x)
+    {
+        if (m_dragging_edge == LEFT) {
+            m_dragging_edge = RIGHT;
+        } else if (m_dragging_edge == RIGHT) {
+            m_dragging_edge = LEFT;
+        } else 
+        {
+            throw std::logic_error("left/right crossed while not dragging LEFT/RIGHT");
+        }
+    }
+}
+
+void Mesh::snap_dragged_edge()
+{
+    if (!m_edges || m_snap_disabled || m_screen_width <= 0 || m_screen_height <= 0)
+    {
+        return;
+    }
+
+    // screen coords to the edge index's pixels, whose centers sit at +0.5
+    const float sx = static_cast<float>(m_edges->width()) / m_screen_width;
+    const float sy = static_cast<float>(m_edges->height()) / m_screen_height;
+    float snapped;
+    if (m_dragging_edge == UP || m_dragging_edge == DOWN)
+    {
+        float& y = (m_dragging_edge == UP) ? top_left.y : bot_right.y;
+        if (m_edges->snap_horizontal(y * sy - 0.5f, top_left.x * sx, bot_right.x * sx, SNAP_RADIUS * sy, snapped))
+        {
+            y = (snapped + 0.5f) / sy;
+        }
+    }
+    else if (m_dragging_edge == LEFT || m_dragging_edge == RIGHT)
+    {
+        float& x = (m_dragging_edge == LEFT) ? top_left.x : bot_right.x;
+        if (m_edges->snap_vertical(x * sx - 0.5f, top_left.y * sy, bot_right.y * sy, SNAP_RADIUS * sx, snapped))
+        {
+            x = (snapped + 0.5f) / sx;
+        }
+    }
+}
+
 void Mesh::recalculate_mesh(const window_ptr_t& window)
 {
     const glm::vec2 top_left_gl = screen_2_gl(window, top_left);
@@ -244,38 +379,42 @@ void Mesh::recalculate_mesh(const window_ptr_t& window)
     const glm::vec2 bot_right_gl = screen_2_gl(window, bot_right);
     const glm::vec2 vp_gl = screen_2_gl(window, vanishing);
 
-    std::vector<vertex::vertex3_element> verts = 
+    // the vanishing point, the four rear wall corners, then the far end of each vp line
+    vertex::vertex3_element* verts =
+        window->frame_arena().allocate_array<vertex::vertex3_element>(NUM_MESH_VERTS);
+    const auto set_vert = [verts](int n, const glm::vec2& v)
     {
-        { { vp_gl.x, vp_gl.y, MESH_Z } , {} },
-        { { top_left_gl.x, top_left_gl.y, MESH_Z } , {} },
-        { { top_right_gl.x, top_right_gl.y, MESH_Z } , {} },
-        { { bot_left_gl.x, bot_left_gl.y, MESH_Z } , {} },
-        { { bot_right_gl.x, bot_right_gl.y, MESH_Z } , {} }
+        verts[n] = { { v.x, v.y, MESH_Z }, {} };
     };
+    set_vert(0, vp_gl);
+    set_vert(1, top_left_gl);
+    set_vert(2, top_right_gl);
+    set_vert(3, bot_left_gl);
+    set_vert(4, bot_right_gl);
 
-    std::vector<vertex::indexed_line> lines = 
-    {
-        { 1, 2 },
-        { 2, 4 },
-        { 4, 3 },
-        { 3, 1 }
-    };
-
-    const auto add_vp_line = [&verts, &lines, vp_gl](const float rad)
+    const auto add_vp_line = [&set_vert, vp_gl](int n, const glm::vec2& corner)
     {
+        const float rad = glm::atan(corner.y - vp_gl.y, corner.x - vp_gl.x);
         const float l = 1.5;
         const float x = l * glm::cos(rad) + vp_gl.x;
         const float y = l * glm::sin(rad) + vp_gl.y;
-        verts.push_back({{ x, y, MESH_Z }, {}});
-        lines.emplace_back(0, verts.size() - 1);
+        set_vert(n, glm::vec2(x, y));
     };
 
-    add_vp_line(glm::atan(top_left_gl.y - vp_gl.y, top_left_gl.x - vp_gl.x));
-    add_vp_line(glm::atan(top_right_gl.y - vp_gl.y, top_right_gl.x - vp_gl.x));
-    add_vp_line(glm::atan(bot_left_gl.y - vp_gl.y, bot_left_gl.x - vp_gl.x));
-    add_vp_line(glm::atan(bot_right_gl.y - vp_gl.y, bot_right_gl.x - vp_gl.x));
+    add_vp_line(5, top_left_gl);
+    add_vp_line(6, top_right_gl);
+    add_vp_line(7, bot_left_gl);
+    add_vp_line(8, bot_right_gl);
 
-    m_mesh_vao = vertex::VertexArrayBuffer(&verts[0], verts.size(), &lines[0], lines.size());
+    // topology never changes, so after the first time only the vertices are re-uploaded
+    if (m_mesh_vao.empty())
+    {
+        m_mesh_vao = vertex::VertexArrayBuffer(verts, NUM_MESH_VERTS, mesh_lines, ARRAY_SIZE(mesh_lines));
+    }
+    else
+    {
+        m_mesh_vao.update_vertices(verts, NUM_MESH_VERTS);
+    }
 }
 } // namespace mash
 } // namespace svm
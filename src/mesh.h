@@ -3,6 +3,7 @@
 #include <glm/vec2.hpp>
 #include <memory>
 
+#include "edge_snap.h"
 #include "scene.h"
 #include "shader.h"
 #include "texture.h"
@@ -15,6 +16,11 @@ namespace mesh
 class Mesh: public scene::Scene
 {
 public:
+    // The editor's window height; the image is shown scaled to it, so it never needs a texture
+    // much taller than this
+    static constexpr const int WINDOW_HEIGHT = 640;
+
+    // tex may be null until set_texture(), as long as that happens before setup()
     Mesh(const std::shared_ptr<texture::Texture2D>& tex);
 
     glm::vec2 top_left;
@@ -27,7 +33,21 @@ public:
 
     bool should_switch_scenes() const;
 
+    // Whether the shader programs have finished compiling, so render() won't stall on them
+    bool is_ready() const;
+
+    // Replaces the image being edited; takes effect at the next setup()
+    void set_texture(const std::shared_ptr<texture::Texture2D>& tex);
+    // Makes the next setup() start from these handles (GL coords) instead of the default box
+    void set_initial_handles(const glm::vec2& top_left, const glm::vec2& bot_right, const glm::vec2& vanishing);
+    void clear_initial_handles();
+    // Edges of the image that dragged rear wall edges snap to, in any resolution with the image's
+    // aspect ratio; null turns snapping off. Holding shift also suspends it.
+    void set_edge_index(std::shared_ptr<const edges::EdgeIndex> edges);
+
 private:
+    void drag_to(double cursor_x, double cursor_y);
+    void snap_dragged_edge();
     void recalculate_mesh(const window_ptr_t& window);
 
     shader::ShaderProgram m_tex_prog;
@@ -37,7 +57,16 @@ private:
     vertex::VertexArrayBuffer m_tex_vao;
     vertex::VertexArrayBuffer m_mesh_vao;
     vertex::VertexArrayBuffer m_dot_vao;
+    glm::vec2 m_initial_top_left;
+    glm::vec2 m_initial_bot_right;
+    glm::vec2 m_initial_vanishing;
+    bool m_has_initial_handles;
+    std::shared_ptr<const edges::EdgeIndex> m_edges;
+    int m_screen_width;
+    int m_screen_height;
+    bool m_snap_disabled;
     int m_dragging_edge;
+    bool m_button_down;
     bool m_done;
 };
 } // namespace mash
@@ -0,0 +1,333 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "framebuffer.h"
+#include "image.h"
+#include "jobs.h"
+#include "panorama.h"
+
+namespace
+{
+constexpr const float PI = 3.14159265358979f;
+// bilinear weights are in 1/256ths
+constexpr const int WEIGHT_ONE = 256;
+// rows per job by default; small enough for idle workers to steal a share of the image
+constexpr const int DEFAULT_BAND_ROWS = 16;
+
+// Where one output pixel samples the faces: texel index of the top-left tap over all six faces
+// and the weights of the right and lower taps
+struct Tap
+{
+    std::int32_t texel;
+    std::int32_t wx;
+    std::int32_t wy;
+};
+
+// Cube map lookup as GL specifies it: pick the major axis, project onto that face and map
+// [-1, 1] to texel centres, clamped so the 2x2 footprint stays on the face
+Tap lookup(float dx, float dy, float dz, int face_size)
+{
+    const float ax = std::fabs(dx), ay = std::fabs(dy), az = std::fabs(dz);
+    int face;
+    float ma, sc, tc;
+    if (ax >= ay && ax >= az)
+    {
+        face = dx > 0 ? 0 : 1;
+        ma = ax;
+        sc = dx > 0 ? -dz : dz;
+        tc = -dy;
+    }
+    else if (ay >= az)
+    {
+        face = dy > 0 ? 2 : 3;
+        ma = ay;
+        sc = dx;
+        tc = dy > 0 ? dz : -dz;
+    }
+    else
+    {
+        face = dz > 0 ? 4 : 5;
+        ma = az;
+        sc = dz > 0 ? dx : -dx;
+        tc = -dy;
+    }
+
+    const float max_coord = static_cast<float>(face_size - 1);
+    const float s = std::min(std::max((sc / ma + 1.0f) * 0.5f * face_size - 0.5f, 0.0f), max_coord);
+    const float t = std::min(std::max((tc / ma + 1.0f) * 0.5f * face_size - 0.5f, 0.0f), max_coord);
+    const int x0 = std::min(static_cast<int>(s), face_size - 2);
+    const int y0 = std::min(static_cast<int>(t), face_size - 2);
+
+    Tap tap;
+    tap.texel = (face * face_size + y0) * face_size + x0;
+    tap.wx = static_cast<std::int32_t>((s - x0) * WEIGHT_ONE + 0.5f);
+    tap.wy = static_cast<std::int32_t>((t - y0) * WEIGHT_ONE + 0.5f);
+    return tap;
+}
+
+#if defined(__SSE2__)
+inline __m128 select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// _mm_mullo_epi32 is SSE4.1; SSE2 only multiplies the even lanes into 64 bits
+inline __m128i mullo(__m128i a, __m128i b)
+{
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+        _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#elif defined(__ARM_NEON)
+inline float32x4_t divide(float32x4_t a, float32x4_t b)
+{
+    // two Newton steps take the estimate to full float precision
+    float32x4_t inv = vrecpeq_f32(b);
+    inv = vmulq_f32(inv, vrecpsq_f32(b, inv));
+    inv = vmulq_f32(inv, vrecpsq_f32(b, inv));
+    return vmulq_f32(a, inv);
+}
+#endif
+} // anonymous namespace
+
+namespace svm
+{
+namespace panorama
+{
+int face_size_for(int width)
+{
+    // the equator crosses four faces
+    return std::max(2, (width + 3) / 4);
+}
+
+EquirectRemapper::EquirectRemapper(int width)
+    : m_width(width)
+    , m_height(width / 2)
+    , m_sin_lon(width)
+    , m_cos_lon(width)
+    , m_sin_lat(width / 2)
+    , m_cos_lat(width / 2)
+{
+    if (width < 2 || width % 2 != 0 || width > MAX_WIDTH)
+    {
+        throw std::runtime_error("panorama width must be even and in [2, " + std::to_string(MAX_WIDTH)
+            + "], got " + std::to_string(width));
+    }
+
+    for (int x = 0; x < m_width; ++x)
+    {
+        const float lon = ((x + 0.5f) / m_width * 2.0f - 1.0f) * PI;
+        m_sin_lon[x] = std::sin(lon);
+        m_cos_lon[x] = std::cos(lon);
+    }
+    for (int y = 0; y < m_height; ++y)
+    {
+        const float lat = (0.5f - (y + 0.5f) / m_height) * PI;
+        m_sin_lat[y] = std::sin(lat);
+        m_cos_lat[y] = std::cos(lat);
+    }
+}
+
+int EquirectRemapper::width() const
+{
+    return m_width;
+}
+
+int EquirectRemapper::height() const
+{
+    return m_height;
+}
+
+void EquirectRemapper::remap(const unsigned char* faces, int face_size, unsigned char* rgb,
+    unsigned num_bands) const
+{
+    if (face_size < 2)
+    {
+        throw std::runtime_error("cube map faces must be at least 2x2");
+    }
+    const int band = (num_bands == 0) ? DEFAULT_BAND_ROWS
+        : (m_height + static_cast<int>(num_bands) - 1) / static_cast<int>(num_bands);
+    jobs::JobSystem::instance().parallel_for(0, m_height, band, [=](int begin, int end)
+    {
+        remap_rows(faces, face_size, rgb, begin, end);
+    });
+}
+
+void EquirectRemapper::remap_rows(const unsigned char* faces, int face_size, unsigned char* rgb,
+    int row_begin, int row_end) const
+{
+    std::vector<std::int32_t> texel(m_width);
+    std::vector<std::int32_t> wx(m_width);
+    std::vector<std::int32_t> wy(m_width);
+    const std::size_t face_stride = static_cast<std::size_t>(face_size) * 4;
+
+    for (int y = row_begin; y < row_end; ++y)
+    {
+        const float cos_lat = m_cos_lat[y];
+        const float sin_lat = m_sin_lat[y];
+
+        // First pass: where each pixel samples, 4 lanes at a time
+        int x = 0;
+#if defined(__SSE2__)
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 half_size = _mm_set1_ps(0.5f * face_size);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 max_coord = _mm_set1_ps(static_cast<float>(face_size - 1));
+        const __m128i max_x0 = _mm_set1_epi32(face_size - 2);
+        const __m128i size = _mm_set1_epi32(face_size);
+        const __m128 weight_one = _mm_set1_ps(static_cast<float>(WEIGHT_ONE));
+        const __m128 cl = _mm_set1_ps(cos_lat);
+        const __m128 dy = _mm_set1_ps(sin_lat);
+        for (; x + 4 <= m_width; x += 4)
+        {
+            const __m128 dx = _mm_mul_ps(cl, _mm_loadu_ps(&m_sin_lon[x]));
+            const __m128 dz = _mm_xor_ps(sign, _mm_mul_ps(cl, _mm_loadu_ps(&m_cos_lon[x])));
+            const __m128 ax = _mm_andnot_ps(sign, dx);
+            const __m128 ay = _mm_andnot_ps(sign, dy);
+            const __m128 az = _mm_andnot_ps(sign, dz);
+
+            const __m128 x_major = _mm_and_ps(_mm_cmpge_ps(ax, ay), _mm_cmpge_ps(ax, az));
+            const __m128 y_major = _mm_andnot_ps(x_major, _mm_cmpge_ps(ay, az));
+            const __m128 positive = select(x_major, _mm_cmpgt_ps(dx, zero),
+                select(y_major, _mm_cmpgt_ps(dy, zero), _mm_cmpgt_ps(dz, zero)));
+
+            const __m128 ma = select(x_major, ax, select(y_major, ay, az));
+            const __m128 sc = select(x_major, select(positive, _mm_xor_ps(sign, dz), dz),
+                select(y_major, dx, select(positive, dx, _mm_xor_ps(sign, dx))));
+            const __m128 tc = select(y_major, select(positive, dz, _mm_xor_ps(sign, dz)), _mm_xor_ps(sign, dy));
+            // face = 0, 2 or 4 for the major axis, +1 when it points the negative way
+            const __m128 face = _mm_add_ps(
+                select(x_major, zero, select(y_major, _mm_set1_ps(2.0f), _mm_set1_ps(4.0f))),
+                _mm_andnot_ps(positive, one));
+
+            const auto to_texels = [&](__m128 c)
+            {
+                const __m128 t = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_div_ps(c, ma), one), half_size), half);
+                return _mm_min_ps(_mm_max_ps(t, zero), max_coord);
+            };
+            const __m128 s = to_texels(sc);
+            const __m128 t = to_texels(tc);
+            // no _mm_min_epi32 in SSE2
+            const auto clamp_x0 = [max_x0](__m128i v)
+            {
+                const __m128i over = _mm_cmpgt_epi32(v, max_x0);
+                return _mm_or_si128(_mm_and_si128(over, max_x0), _mm_andnot_si128(over, v));
+            };
+            const __m128i x0 = clamp_x0(_mm_cvttps_epi32(s));
+            const __m128i y0 = clamp_x0(_mm_cvttps_epi32(t));
+
+            const __m128i texels = _mm_add_epi32(mullo(_mm_add_epi32(mullo(_mm_cvttps_epi32(face), size), y0),
+                size), x0);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&texel[x]), texels);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&wx[x]), _mm_cvtps_epi32(
+                _mm_mul_ps(_mm_sub_ps(s, _mm_cvtepi32_ps(x0)), weight_one)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&wy[x]), _mm_cvtps_epi32(
+                _mm_mul_ps(_mm_sub_ps(t, _mm_cvtepi32_ps(y0)), weight_one)));
+        }
+#elif defined(__ARM_NEON)
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        const float32x4_t one = vdupq_n_f32(1.0f);
+        const float32x4_t half_size = vdupq_n_f32(0.5f * face_size);
+        const float32x4_t half = vdupq_n_f32(0.5f);
+        const float32x4_t max_coord = vdupq_n_f32(static_cast<float>(face_size - 1));
+        const int32x4_t max_x0 = vdupq_n_s32(face_size - 2);
+        const int32x4_t size = vdupq_n_s32(face_size);
+        const float32x4_t weight_one = vdupq_n_f32(static_cast<float>(WEIGHT_ONE));
+        const float32x4_t cl = vdupq_n_f32(cos_lat);
+        const float32x4_t dy = vdupq_n_f32(sin_lat);
+        for (; x + 4 <= m_width; x += 4)
+        {
+            const float32x4_t dx = vmulq_f32(cl, vld1q_f32(&m_sin_lon[x]));
+            const float32x4_t dz = vnegq_f32(vmulq_f32(cl, vld1q_f32(&m_cos_lon[x])));
+            const float32x4_t ax = vabsq_f32(dx);
+            const float32x4_t ay = vabsq_f32(dy);
+            const float32x4_t az = vabsq_f32(dz);
+
+            const uint32x4_t x_major = vandq_u32(vcgeq_f32(ax, ay), vcgeq_f32(ax, az));
+            const uint32x4_t y_major = vbicq_u32(vcgeq_f32(ay, az), x_major);
+            const uint32x4_t positive = vbslq_u32(x_major, vcgtq_f32(dx, zero),
+                vbslq_u32(y_major, vcgtq_f32(dy, zero), vcgtq_f32(dz, zero)));
+
+            const float32x4_t ma = vbslq_f32(x_major, ax, vbslq_f32(y_major, ay, az));
+            const float32x4_t sc = vbslq_f32(x_major, vbslq_f32(positive, vnegq_f32(dz), dz),
+                vbslq_f32(y_major, dx, vbslq_f32(positive, dx, vnegq_f32(dx))));
+            const float32x4_t tc = vbslq_f32(y_major, vbslq_f32(positive, dz, vnegq_f32(dz)), vnegq_f32(dy));
+            const int32x4_t face = vaddq_s32(
+                vbslq_s32(x_major, vdupq_n_s32(0), vbslq_s32(y_major, vdupq_n_s32(2), vdupq_n_s32(4))),
+                vreinterpretq_s32_u32(vandq_u32(vmvnq_u32(positive), vdupq_n_u32(1))));
+
+            const auto to_texels = [&](float32x4_t c)
+            {
+                const float32x4_t t = vsubq_f32(vmulq_f32(vaddq_f32(divide(c, ma), one), half_size), half);
+                return vminq_f32(vmaxq_f32(t, zero), max_coord);
+            };
+            const float32x4_t s = to_texels(sc);
+            const float32x4_t t = to_texels(tc);
+            const int32x4_t x0 = vminq_s32(vcvtq_s32_f32(s), max_x0);
+            const int32x4_t y0 = vminq_s32(vcvtq_s32_f32(t), max_x0);
+
+            vst1q_s32(&texel[x], vmlaq_s32(x0, vmlaq_s32(y0, face, size), size));
+            vst1q_s32(&wx[x], vcvtq_s32_f32(vaddq_f32(vmulq_f32(vsubq_f32(s, vcvtq_f32_s32(x0)), weight_one), half)));
+            vst1q_s32(&wy[x], vcvtq_s32_f32(vaddq_f32(vmulq_f32(vsubq_f32(t, vcvtq_f32_s32(y0)), weight_one), half)));
+        }
+#endif
+        for (; x < m_width; ++x)
+        {
+            const Tap tap = lookup(cos_lat * m_sin_lon[x], sin_lat, -cos_lat * m_cos_lon[x], face_size);
+            texel[x] = tap.texel;
+            wx[x] = tap.wx;
+            wy[x] = tap.wy;
+        }
+
+        // Second pass: the bilinear taps. These are gathers, which SSE2 and NEON don't have.
+        unsigned char* out = rgb + static_cast<std::size_t>(y) * m_width * 3;
+        for (x = 0; x < m_width; ++x, out += 3)
+        {
+            const unsigned char* top = faces + static_cast<std::size_t>(texel[x]) * 4;
+            const unsigned char* bottom = top + face_stride;
+            const int w_right = wx[x], w_left = WEIGHT_ONE - w_right;
+            const int w_bottom = wy[x], w_top = WEIGHT_ONE - w_bottom;
+            for (int c = 0; c < 3; ++c)
+            {
+                const int upper = top[c] * w_left + top[4 + c] * w_right;
+                const int lower = bottom[c] * w_left + bottom[4 + c] * w_right;
+                out[c] = static_cast<unsigned char>((upper * w_top + lower * w_bottom + WEIGHT_ONE * WEIGHT_ONE / 2)
+                    / (WEIGHT_ONE * WEIGHT_ONE));
+            }
+        }
+    }
+}
+
+void export_equirect(background::Background& bg, const glm::vec3& position, int width, const std::string& path)
+{
+    const EquirectRemapper remapper(width);
+
+    framebuffer::CubeFramebuffer target;
+    target.resize(face_size_for(width));
+    bg.render_cube(target, position);
+
+    const int face_size = target.face_size();
+    std::vector<unsigned char> faces(6 * resources::texture_bytes(face_size, face_size, 4, false));
+    target.read_faces(faces.data());
+    // the cube map's GPU memory isn't needed for the remap
+    target = framebuffer::CubeFramebuffer();
+
+    std::vector<unsigned char> rgb(resources::texture_bytes(remapper.width(), remapper.height(), 3, false));
+    remapper.remap(faces.data(), face_size, rgb.data());
+    faces = std::vector<unsigned char>();
+
+    image::write_file(path.c_str(), rgb.data(), remapper.width(), remapper.height(), 3);
+}
+} // namespace panorama
+} // namespace svm
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <string>
+#include <vector>
+
+#include "background.h"
+
+namespace svm
+{
+namespace panorama
+{
+constexpr const int MAX_WIDTH = 16384;
+
+// Cube face size that samples an equirectangular image of the given width about 1:1 at the equator
+int face_size_for(int width);
+
+// Resamples six cube map faces to an equirectangular image. The per-pixel view directions are
+// separable into per-column longitude and per-row latitude terms, so the lookup tables are one
+// row and one column of sines and cosines; a full per-pixel table would be over 1 GB at 16k.
+class EquirectRemapper
+{
+public:
+    // width must be even and at most MAX_WIDTH; the height is half of it
+    explicit EquirectRemapper(int width);
+
+    int width() const;
+    int height() const;
+
+    // faces holds 6 face_size x face_size RGBA faces as CubeFramebuffer::read_faces() returns them;
+    // rgb receives width x height top-down RGB rows. The centre column looks down -z with +y up.
+    // Rows are split into num_bands bands that run on the shared job system, 0 picking a few
+    // rows per band.
+    void remap(const unsigned char* faces, int face_size, unsigned char* rgb, unsigned num_bands = 0) const;
+
+private:
+    void remap_rows(const unsigned char* faces, int face_size, unsigned char* rgb, int row_begin,
+        int row_end) const;
+
+    int m_width;
+    int m_height;
+    // pixel (x, y) looks along (cos_lat[y] * sin_lon[x], sin_lat[y], -cos_lat[y] * cos_lon[x])
+    std::vector<float> m_sin_lon;
+    std::vector<float> m_cos_lon;
+    std::vector<float> m_sin_lat;
+    std::vector<float> m_cos_lat;
+};
+
+// Renders the box from position into a cube map in one pass, remaps it to width x width / 2 and
+// writes it to path (see image::write_file). Throws on failure. Must be called on the GL thread.
+void export_equirect(background::Background& bg, const glm::vec3& position, int width, const std::string& path);
+} // namespace panorama
+} // namespace svm
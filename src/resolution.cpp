@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "resolution.h"
+
+namespace
+{
+constexpr double SMOOTHING = 0.25; // weight of the newest sample in the moving average
+
+void check_params(const svm::resolution::ResolutionParams& params)
+{
+    if (!(params.min_scale > 0 && params.min_scale <= params.max_scale))
+    {
+        throw std::runtime_error("resolution scale range must satisfy 0 < min_scale <= max_scale");
+    }
+}
+} // anonymous namespace
+
+namespace svm
+{
+namespace resolution
+{
+ResolutionController::ResolutionController(const ResolutionParams& params)
+    : m_params(params)
+    , m_scale(params.max_scale)
+    , m_smoothed_ms(-1.0)
+{
+    check_params(m_params);
+}
+
+void ResolutionController::set_params(const ResolutionParams& params)
+{
+    check_params(params);
+    m_params = params;
+    m_scale = std::min(std::max(m_scale, m_params.min_scale), m_params.max_scale);
+}
+
+const ResolutionParams& ResolutionController::params() const
+{
+    return m_params;
+}
+
+float ResolutionController::update(double gpu_ms, bool camera_moving)
+{
+    m_smoothed_ms = (m_smoothed_ms < 0) ? gpu_ms : SMOOTHING * gpu_ms + (1 - SMOOTHING) * m_smoothed_ms;
+
+    const double upper = m_params.target_ms * (1.0 + m_params.hysteresis);
+    const double lower = m_params.target_ms * (1.0 - m_params.hysteresis);
+
+    if (!camera_moving)
+    {
+        m_scale += m_params.step_up;
+    }
+    else if (m_smoothed_ms > upper)
+    {
+        // cost is roughly proportional to pixel count, i.e. to scale squared
+        m_scale *= static_cast<float>(std::sqrt(m_params.target_ms / m_smoothed_ms));
+        // the average still holds the old scale's cost; don't shrink again on stale samples
+        m_smoothed_ms = m_params.target_ms;
+    }
+    else if (m_smoothed_ms < lower)
+    {
+        m_scale += m_params.step_up;
+    }
+
+    m_scale = std::min(std::max(m_scale, m_params.min_scale), m_params.max_scale);
+    return m_scale;
+}
+
+float ResolutionController::scale() const
+{
+    return m_scale;
+}
+} // namespace resolution
+} // namespace svm
@@ -0,0 +1,43 @@
+#pragma once
+
+namespace svm
+{
+namespace resolution
+{
+struct ResolutionParams
+{
+    bool enabled = true;
+    double target_ms = 16.6;
+    float min_scale = 0.5f;
+    float max_scale = 1.0f;
+    // fraction of target_ms the frame time may drift either way before the scale changes
+    float hysteresis = 0.1f;
+    // per-frame scale increase while there is headroom, or while the camera is at rest
+    float step_up = 0.02f;
+};
+
+// Picks a render scale (fraction of the window size along each axis) from measured GPU frame
+// times. Scaling down is proportional to the overshoot so a slow seat settles in a few frames;
+// scaling up is gradual so we don't oscillate around the target.
+class ResolutionController
+{
+public:
+    // Both throw unless 0 < min_scale <= max_scale
+    explicit ResolutionController(const ResolutionParams& params = ResolutionParams());
+
+    void set_params(const ResolutionParams& params);
+    const ResolutionParams& params() const;
+
+    // Feeds one GPU frame time and returns the updated scale. While the camera is at rest the
+    // scale climbs back toward max_scale regardless of cost, so full detail returns once motion
+    // stops.
+    float update(double gpu_ms, bool camera_moving);
+    float scale() const;
+
+private:
+    ResolutionParams m_params;
+    float m_scale;
+    double m_smoothed_ms;
+};
+} // namespace resolution
+} // namespace svm
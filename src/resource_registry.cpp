@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+#include "resource_registry.h"
+
+namespace
+{
+double to_mib(std::size_t bytes)
+{
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+} // anonymous namespace
+
+namespace svm
+{
+namespace resources
+{
+const char* kind_name(Kind kind)
+{
+    switch (kind)
+    {
+    case Kind::texture:
+        return "textures";
+    case Kind::buffer:
+        return "buffers";
+    case Kind::renderbuffer:
+        return "renderbuffers";
+    case Kind::program:
+        return "programs";
+    case Kind::host_image:
+        return "host images";
+    default:
+        return "?";
+    }
+}
+
+bool is_gpu_kind(Kind kind)
+{
+    return kind != Kind::host_image;
+}
+
+Registry& Registry::instance()
+{
+    static Registry registry;
+    return registry;
+}
+
+Registry::Registry()
+    : m_mutex()
+    , m_entries()
+    , m_next_id(1)
+    , m_usage()
+    , m_gpu_bytes(0)
+    , m_gpu_peak(0)
+    , m_host_bytes(0)
+    , m_host_peak(0)
+    , m_gpu_budget(0)
+    , m_budget_warned(false)
+    , m_log_interval(0)
+    , m_last_log(0)
+{}
+
+std::uint64_t Registry::add(Kind kind, std::size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::uint64_t id = m_next_id++;
+    m_entries[id] = { kind, bytes };
+    ++m_usage[static_cast<int>(kind)].count;
+    account(kind, static_cast<std::ptrdiff_t>(bytes));
+    return id;
+}
+
+void Registry::resize(std::uint64_t id, std::size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(id);
+    if (it == m_entries.end())
+    {
+        return;
+    }
+    account(it->second.kind, static_cast<std::ptrdiff_t>(bytes) - static_cast<std::ptrdiff_t>(it->second.bytes));
+    it->second.bytes = bytes;
+}
+
+void Registry::remove(std::uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(id);
+    if (it == m_entries.end())
+    {
+        return;
+    }
+    --m_usage[static_cast<int>(it->second.kind)].count;
+    account(it->second.kind, -static_cast<std::ptrdiff_t>(it->second.bytes));
+    m_entries.erase(it);
+}
+
+void Registry::account(Kind kind, std::ptrdiff_t delta)
+{
+    Usage& usage = m_usage[static_cast<int>(kind)];
+    usage.bytes += delta;
+    usage.peak_bytes = std::max(usage.peak_bytes, usage.bytes);
+
+    if (is_gpu_kind(kind))
+    {
+        m_gpu_bytes += delta;
+        m_gpu_peak = std::max(m_gpu_peak, m_gpu_bytes);
+        if (m_gpu_budget != 0 && m_gpu_bytes > m_gpu_budget && !m_budget_warned)
+        {
+            m_budget_warned = true;
+            std::cerr << "warning: GPU memory " << to_mib(m_gpu_bytes) << " MiB is over the budget of "
+                << to_mib(m_gpu_budget) << " MiB" << std::endl;
+        }
+    }
+    else
+    {
+        m_host_bytes += delta;
+        m_host_peak = std::max(m_host_peak, m_host_bytes);
+    }
+}
+
+Usage Registry::usage(Kind kind) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_usage[static_cast<int>(kind)];
+}
+
+std::size_t Registry::gpu_bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_gpu_bytes;
+}
+
+std::size_t Registry::gpu_peak_bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_gpu_peak;
+}
+
+std::size_t Registry::host_bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_host_bytes;
+}
+
+std::size_t Registry::host_peak_bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_host_peak;
+}
+
+void Registry::set_gpu_budget(std::size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_gpu_budget = bytes;
+    m_budget_warned = false;
+}
+
+void Registry::set_log_interval(double seconds)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_log_interval = seconds;
+}
+
+void Registry::log_if_due(double now, std::ostream& os)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_log_interval <= 0 || now - m_last_log < m_log_interval)
+    {
+        return;
+    }
+    m_last_log = now;
+    log_summary_locked(os);
+}
+
+void Registry::log_summary(std::ostream& os) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    log_summary_locked(os);
+}
+
+void Registry::log_summary_locked(std::ostream& os) const
+{
+    char line[512];
+    int len = std::snprintf(line, sizeof(line), "memory: gpu %.1f MiB (peak %.1f), host %.1f MiB (peak %.1f) |",
+        to_mib(m_gpu_bytes), to_mib(m_gpu_peak), to_mib(m_host_bytes), to_mib(m_host_peak));
+    for (int k = 0; k < static_cast<int>(Kind::num_kinds) && len < static_cast<int>(sizeof(line)); ++k)
+    {
+        const Usage& usage = m_usage[k];
+        len += std::snprintf(line + len, sizeof(line) - len, " %s %zu / %.1f MiB",
+            kind_name(static_cast<Kind>(k)), usage.count, to_mib(usage.bytes));
+    }
+    os << line << std::endl;
+}
+
+Tracked::Tracked(): m_id(0)
+{}
+
+Tracked::Tracked(Kind kind, std::size_t bytes): m_id(Registry::instance().add(kind, bytes))
+{}
+
+Tracked::Tracked(Tracked&& other): m_id(other.m_id)
+{
+    other.m_id = 0;
+}
+
+Tracked& Tracked::operator=(Tracked&& other)
+{
+    reset();
+    m_id = other.m_id;
+    other.m_id = 0;
+    return *this;
+}
+
+void Tracked::resize(std::size_t bytes)
+{
+    if (m_id != 0)
+    {
+        Registry::instance().resize(m_id, bytes);
+    }
+}
+
+void Tracked::reset()
+{
+    if (m_id != 0)
+    {
+        Registry::instance().remove(m_id);
+        m_id = 0;
+    }
+}
+
+Tracked::~Tracked()
+{
+    reset();
+}
+
+std::size_t texture_bytes(int width, int height, int num_channels, bool mipmapped)
+{
+    std::size_t total = 0;
+    while (true)
+    {
+        total += static_cast<std::size_t>(width) * height * num_channels;
+        if (!mipmapped || (width == 1 && height == 1))
+        {
+            break;
+        }
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return total;
+}
+} // namespace resources
+} // namespace svm
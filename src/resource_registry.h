@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+namespace svm
+{
+namespace resources
+{
+enum class Kind
+{
+    texture,
+    buffer,         // vertex, index and pixel transfer buffers
+    renderbuffer,   // includes framebuffer attachments
+    program,
+    host_image,     // decoded pixels in host memory
+    num_kinds
+};
+
+const char* kind_name(Kind kind);
+bool is_gpu_kind(Kind kind);
+
+struct Usage
+{
+    std::size_t count = 0;
+    std::size_t bytes = 0;
+    std::size_t peak_bytes = 0;
+};
+
+// Books every live GL object and host image buffer with its estimated size, so we can tell what
+// a session costs and keep large-image sessions within a budget. Thread safe, since decoding may
+// happen off the GL thread. Sizes are estimates: drivers may pad RGB to RGBA, add alignment, etc.
+class Registry
+{
+public:
+    static Registry& instance();
+
+    std::uint64_t add(Kind kind, std::size_t bytes);
+    void resize(std::uint64_t id, std::size_t bytes);
+    void remove(std::uint64_t id);
+
+    Usage usage(Kind kind) const;
+    std::size_t gpu_bytes() const;
+    std::size_t gpu_peak_bytes() const;
+    std::size_t host_bytes() const;
+    std::size_t host_peak_bytes() const;
+
+    // A warning is logged the first time GPU usage goes over the budget; 0 means no budget
+    void set_gpu_budget(std::size_t bytes);
+
+    // Writes a one-line summary if at least `interval` seconds passed since the last one; an
+    // interval <= 0 disables it
+    void set_log_interval(double seconds);
+    void log_if_due(double now, std::ostream& os);
+    void log_summary(std::ostream& os) const;
+
+private:
+    struct Entry
+    {
+        Kind kind;
+        std::size_t bytes;
+    };
+
+    Registry();
+
+    void account(Kind kind, std::ptrdiff_t delta);
+    void log_summary_locked(std::ostream& os) const;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::uint64_t, Entry> m_entries;
+    std::uint64_t m_next_id;
+    Usage m_usage[static_cast<int>(Kind::num_kinds)];
+    std::size_t m_gpu_bytes;
+    std::size_t m_gpu_peak;
+    std::size_t m_host_bytes;
+    std::size_t m_host_peak;
+    std::size_t m_gpu_budget;
+    bool m_budget_warned;
+    double m_log_interval;
+    double m_last_log;
+};
+
+// RAII registration, meant to be a member of the class that owns the resource
+class Tracked
+{
+public:
+    Tracked();
+    Tracked(Kind kind, std::size_t bytes);
+
+    Tracked(const Tracked&) = delete;
+    Tracked& operator=(const Tracked&) = delete;
+
+    Tracked(Tracked&&);
+    Tracked& operator=(Tracked&&);
+
+    void resize(std::size_t bytes);
+    void reset();
+
+    ~Tracked();
+
+private:
+    std::uint64_t m_id;
+};
+
+// Estimated size of a 2D texture, including its full mip chain if `mipmapped`
+std::size_t texture_bytes(int width, int height, int num_channels, bool mipmapped);
+} // namespace resources
+} // namespace svm
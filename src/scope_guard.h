@@ -1,6 +1,6 @@
 #pragma once
 
-#include <functional>
+#include "inline_function.h"
 
 namespace svm
 {
@@ -10,7 +10,7 @@ class ScopeGuard
 {
 public:
     template <class CleanupFunc>
-    ScopeGuard(CleanupFunc&& cleanup): m_cleanup(cleanup)
+    ScopeGuard(CleanupFunc&& cleanup): m_cleanup(std::forward<CleanupFunc>(cleanup))
     {}
 
     // copy construction/assignment is deleted
@@ -26,7 +26,8 @@ public:
     ~ScopeGuard();
 
 private:
-    std::function<void()> m_cleanup;
+    // stored inline, so guarding a scope never allocates
+    InlineFunction<void()> m_cleanup;
 };
 } // namespace tools
 } // namespace svm
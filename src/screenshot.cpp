@@ -0,0 +1,255 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+#include "image.h"
+#include "jobs.h"
+#include "scope_guard.h"
+#include "screenshot.h"
+
+namespace
+{
+// rows per job when flipping
+constexpr const int COPY_BAND_ROWS = 64;
+
+// Bottom-up RGBA rows, as glReadPixels returns them, to top-down RGB rows; framebuffer alpha is
+// whatever blending left there, so it's dropped
+void flip_to_rgb(const unsigned char* rgba, int width, int height, unsigned char* rgb)
+{
+    svm::jobs::JobSystem::instance().parallel_for(0, height, COPY_BAND_ROWS, [=](int begin, int end)
+    {
+        for (int y = begin; y < end; ++y)
+        {
+            const unsigned char* src = rgba + static_cast<std::size_t>(height - 1 - y) * width * 4;
+            unsigned char* dst = rgb + static_cast<std::size_t>(y) * width * 3;
+            for (int x = 0; x < width; ++x, src += 4, dst += 3)
+            {
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+            }
+        }
+    });
+}
+} // anonymous namespace
+
+namespace svm
+{
+namespace screenshot
+{
+constexpr const int ScreenshotCapture::MAX_READBACKS;
+
+ScreenshotCapture::ScreenshotCapture()
+    : m_readbacks()
+    , m_request()
+    , m_encodes()
+{
+    for (Readback& rb: m_readbacks)
+    {
+        rb.copied = false;
+    }
+}
+
+void ScreenshotCapture::request(const std::string& path)
+{
+    m_request = path;
+    // booked here rather than in capture(), since a registry entry is a heap allocation
+    for (Readback& rb: m_readbacks)
+    {
+        if (rb.pbo == 0)
+        {
+            glGenBuffers(1, &rb.pbo);
+            rb.mem = resources::Tracked(resources::Kind::buffer, 0);
+        }
+    }
+}
+
+bool ScreenshotCapture::has_request() const
+{
+    return !m_request.empty();
+}
+
+bool ScreenshotCapture::capture(int width, int height)
+{
+    if (m_request.empty())
+    {
+        return true;
+    }
+    Readback* rb = nullptr;
+    for (Readback& candidate: m_readbacks)
+    {
+        if (candidate.state == State::free)
+        {
+            rb = &candidate;
+            break;
+        }
+    }
+    if (rb == nullptr)
+    {
+        return false;
+    }
+
+    const std::size_t bytes = static_cast<std::size_t>(width) * height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+    // reallocated every time; this also orphans the storage of the previous screenshot
+    glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+    rb->mem.resize(bytes);
+
+    // whatever the frame was drawn into: the back buffer usually, but single-buffered surfaces
+    // like pbuffers only have a front one
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLint draw_buffer = GL_BACK;
+    glGetIntegerv(GL_DRAW_BUFFER, &draw_buffer);
+    glReadBuffer(static_cast<GLenum>(draw_buffer));
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    rb->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    rb->state = State::reading;
+    rb->width = width;
+    rb->height = height;
+    rb->path.swap(m_request);
+    m_request.clear();
+    return true;
+}
+
+void ScreenshotCapture::update()
+{
+    for (Readback& rb: m_readbacks)
+    {
+        if (rb.state == State::reading)
+        {
+            const GLenum res = glClientWaitSync(rb.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            if (res == GL_ALREADY_SIGNALED || res == GL_CONDITION_SATISFIED)
+            {
+                start_copy(rb);
+            }
+        }
+        else if (rb.state == State::copying && rb.copied)
+        {
+            recycle(rb);
+        }
+    }
+    report_encodes(false);
+}
+
+void ScreenshotCapture::finish()
+{
+    for (Readback& rb: m_readbacks)
+    {
+        if (rb.state == State::reading)
+        {
+            glClientWaitSync(rb.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            start_copy(rb);
+        }
+    }
+    // the copies finish before their encodes do
+    report_encodes(true);
+    for (Readback& rb: m_readbacks)
+    {
+        if (rb.state == State::copying)
+        {
+            recycle(rb);
+        }
+    }
+}
+
+void ScreenshotCapture::start_copy(Readback& rb)
+{
+    glDeleteSync(rb.fence);
+    rb.fence = nullptr;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.pbo);
+    rb.mapped = static_cast<const unsigned char*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+        static_cast<std::size_t>(rb.width) * rb.height * 4, GL_MAP_READ_BIT));
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (rb.mapped == nullptr)
+    {
+        std::cerr << "could not map screenshot buffer for " << rb.path << std::endl;
+        rb.state = State::free;
+        return;
+    }
+
+    rb.copied = false;
+    rb.state = State::copying;
+    Readback* const source = &rb;
+    const std::string path = rb.path;
+    const int width = rb.width;
+    const int height = rb.height;
+    m_encodes.push_back({ path, jobs::JobSystem::instance().async([source, path, width, height]() -> std::string
+    {
+        std::unique_ptr<unsigned char[]> rgb;
+        {
+            // the GL thread unmaps once the pixels are out, even if the copy failed
+            tools::ScopeGuard release([source]()
+            {
+                source->copied = true;
+            });
+            rgb.reset(new unsigned char[static_cast<std::size_t>(width) * height * 3]);
+            flip_to_rgb(source->mapped, width, height, rgb.get());
+        }
+        try
+        {
+            image::write_file(path.c_str(), rgb.get(), width, height, 3);
+        }
+        catch (const std::exception& e)
+        {
+            return e.what();
+        }
+        return std::string();
+    }) });
+}
+
+void ScreenshotCapture::recycle(Readback& rb)
+{
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.pbo);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    rb.mapped = nullptr;
+    rb.state = State::free;
+}
+
+void ScreenshotCapture::report_encodes(bool wait)
+{
+    for (auto it = m_encodes.begin(); it != m_encodes.end();)
+    {
+        if (!wait && it->error.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++it;
+            continue;
+        }
+        std::string error;
+        try
+        {
+            error = it->error.get();
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+        if (error.empty())
+        {
+            std::cout << "wrote " << it->path << std::endl;
+        }
+        else
+        {
+            std::cerr << "could not save screenshot " << it->path << ": " << error << std::endl;
+        }
+        it = m_encodes.erase(it);
+    }
+}
+
+ScreenshotCapture::~ScreenshotCapture()
+{
+    finish();
+    for (Readback& rb: m_readbacks)
+    {
+        if (rb.pbo != 0)
+        {
+            glDeleteBuffers(1, &rb.pbo);
+        }
+    }
+}
+} // namespace screenshot
+} // namespace svm
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "resource_registry.h"
+
+namespace svm
+{
+namespace screenshot
+{
+// Saves frames without stalling the frame loop. capture() only queues a glReadPixels into a
+// pixel-pack buffer and a fence; a later update() maps the buffer once the fence has signalled,
+// and a job flips the rows, drops alpha and encodes the file while the GL thread moves on.
+// All methods must be called on the GL thread.
+class ScreenshotCapture
+{
+public:
+    // readbacks that can be in flight at once; requests beyond that wait for a free buffer
+    static constexpr const int MAX_READBACKS = 3;
+
+    ScreenshotCapture();
+
+    ScreenshotCapture(const ScreenshotCapture&) = delete;
+    ScreenshotCapture& operator=(const ScreenshotCapture&) = delete;
+
+    // Saves the next captured frame to path: PNG, or JPEG if it ends in .jpg or .jpeg. The first
+    // request creates the readback buffers, so like update() it belongs before the render section.
+    void request(const std::string& path);
+    bool has_request() const;
+
+    // Call once the frame is drawn to the default framebuffer and before swapping. Starts the
+    // readback if a request is waiting and a buffer is free; returns false if it had to wait.
+    // Leaves the default framebuffer bound. Doesn't allocate.
+    bool capture(int width, int height);
+
+    // Call once per frame: hands finished readbacks to the job system, recycles buffers whose
+    // pixels have been copied out and reports written files. Never waits, but does allocate when
+    // something finishes, so it belongs before the frame's render section (Window::begin_render).
+    void update();
+
+    // Waits for every readback and encode, e.g. before exiting
+    void finish();
+
+    ~ScreenshotCapture();
+
+private:
+    enum class State
+    {
+        free,
+        reading,    // glReadPixels queued, waiting on the fence
+        copying     // mapped; a job is copying the pixels out
+    };
+
+    struct Readback
+    {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        State state = State::free;
+        int width = 0;
+        int height = 0;
+        std::string path;
+        const unsigned char* mapped = nullptr;
+        std::atomic<bool> copied;
+        resources::Tracked mem;
+    };
+
+    struct Encode
+    {
+        std::string path;
+        // empty on success, otherwise what went wrong
+        std::future<std::string> error;
+    };
+
+    void start_copy(Readback& rb);
+    void recycle(Readback& rb);
+    void report_encodes(bool wait);
+
+    Readback m_readbacks[MAX_READBACKS];
+    std::string m_request;
+    std::vector<Encode> m_encodes;
+};
+} // namespace screenshot
+} // namespace svm
@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "image.h"
+#include "sequence.h"
+
+namespace svm
+{
+namespace sequence
+{
+SequenceStreamer::SequenceStreamer(std::vector<std::string> paths, int num_workers,
+    std::shared_ptr<const undistort::Undistorter> undistorter)
+    : m_paths(std::move(paths))
+    , m_undistorter(std::move(undistorter))
+    , m_width(0)
+    , m_height(0)
+    , m_num_channels(0)
+    , m_frame_bytes(0)
+    , m_texture()
+    , m_buffer_mem()
+    , m_next_to_queue(0)
+    , m_next_to_show(0)
+    , m_current_frame(0)
+    , m_frames_shown(0)
+    , m_last_upload(-1.0)
+    , m_frames_skipped(0)
+    , m_error()
+    , m_mutex()
+    , m_cond()
+    , m_slots()
+    , m_stop(false)
+    , m_workers()
+{
+    if (m_paths.empty())
+    {
+        throw std::runtime_error("empty image sequence");
+    }
+    image::read_info(m_paths[0].c_str(), m_width, m_height, m_num_channels);
+    m_frame_bytes = static_cast<std::size_t>(m_width) * m_height * m_num_channels;
+    m_texture.reset(texture::Texture2D::with_storage(m_width, m_height, m_num_channels));
+
+    if (num_workers <= 0)
+    {
+        num_workers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    }
+    // no point decoding further ahead than the sequence is long
+    num_workers = std::min<int>(num_workers, static_cast<int>(m_paths.size()));
+
+    m_slots.resize(num_workers + 1);
+    for (Slot& slot: m_slots)
+    {
+        glGenBuffers(1, &slot.pbo);
+        // room for the longest error message, so failures don't allocate on the GL thread later
+        slot.error.reserve(256);
+    }
+    m_buffer_mem = resources::Tracked(resources::Kind::buffer, m_slots.size() * m_frame_bytes);
+
+    for (int i = 0; i < num_workers; ++i)
+    {
+        m_workers.emplace_back([this]()
+        {
+            decode_loop();
+        });
+    }
+}
+
+const std::shared_ptr<texture::Texture2D>& SequenceStreamer::texture() const
+{
+    return m_texture;
+}
+
+std::size_t SequenceStreamer::num_frames() const
+{
+    return m_paths.size();
+}
+
+std::size_t SequenceStreamer::current_frame() const
+{
+    return m_current_frame;
+}
+
+std::size_t SequenceStreamer::frames_shown() const
+{
+    return m_frames_shown;
+}
+
+bool SequenceStreamer::update(double now, double min_interval)
+{
+    // Buffers can only be mapped on the GL thread, so map every free one here and let the workers
+    // fill them in. Orphaning first means the map doesn't wait for a previous upload out of it.
+    bool queued = false;
+    for (Slot& slot: m_slots)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (slot.state != SlotState::free)
+        {
+            continue;
+        }
+        lock.unlock();
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, m_frame_bytes, NULL, GL_STREAM_DRAW);
+        unsigned char* mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+            m_frame_bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+        if (mapped == nullptr)
+        {
+            break;
+        }
+
+        lock.lock();
+        slot.mapped = mapped;
+        slot.ticket = m_next_to_queue++;
+        slot.state = SlotState::queued;
+        queued = true;
+    }
+    if (queued)
+    {
+        m_cond.notify_all();
+    }
+
+    bool uploaded = false;
+    if (m_last_upload < 0 || now - m_last_upload >= min_interval)
+    {
+        // frames are shown in order, so only the slot holding the next one matters
+        for (Slot& slot: m_slots)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (slot.ticket != m_next_to_show || (slot.state != SlotState::decoded && slot.state != SlotState::failed))
+            {
+                continue;
+            }
+            const bool failed = (slot.state == SlotState::failed);
+            lock.unlock();
+
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+            // the contents may be lost, e.g. on a display mode change
+            const bool intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+            if (failed)
+            {
+                // swapped rather than copied, so reporting waits for take_error() and update()
+                // still doesn't allocate
+                m_error.swap(slot.error);
+                ++m_frames_skipped;
+            }
+            else if (intact)
+            {
+                m_texture->update_pixels(NULL);
+                m_current_frame = static_cast<std::size_t>(slot.ticket % m_paths.size());
+                ++m_frames_shown;
+                m_last_upload = now;
+                uploaded = true;
+            }
+
+            lock.lock();
+            slot.mapped = nullptr;
+            slot.state = SlotState::free;
+            ++m_next_to_show;
+            break;
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return uploaded;
+}
+
+std::size_t SequenceStreamer::frames_skipped() const
+{
+    return m_frames_skipped;
+}
+
+bool SequenceStreamer::take_error(std::string& error)
+{
+    if (m_error.empty())
+    {
+        return false;
+    }
+    error.swap(m_error);
+    m_error.clear();
+    return true;
+}
+
+std::size_t SequenceStreamer::frames_buffered()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::size_t count = 0;
+    for (const Slot& slot: m_slots)
+    {
+        if (slot.state == SlotState::decoded)
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+std::size_t SequenceStreamer::num_buffers() const
+{
+    return m_slots.size();
+}
+
+void SequenceStreamer::decode_loop()
+{
+    std::vector<unsigned char> uncorrected;
+    resources::Tracked uncorrected_mem;
+    if (m_undistorter)
+    {
+        uncorrected.resize(m_frame_bytes);
+        uncorrected_mem = resources::Tracked(resources::Kind::host_image, m_frame_bytes);
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        Slot* work = nullptr;
+        m_cond.wait(lock, [this, &work]()
+        {
+            // oldest first, so the frame needed next is never stuck behind later ones
+            work = nullptr;
+            for (Slot& slot: m_slots)
+            {
+                if (slot.state == SlotState::queued && (work == nullptr || slot.ticket < work->ticket))
+                {
+                    work = &slot;
+                }
+            }
+            return m_stop || work != nullptr;
+        });
+        if (m_stop)
+        {
+            return;
+        }
+
+        work->state = SlotState::decoding;
+        const std::string& path = m_paths[work->ticket % m_paths.size()];
+        unsigned char* dst = work->mapped;
+        lock.unlock();
+
+        std::string error;
+        try
+        {
+            if (m_undistorter)
+            {
+                image::decode_file_into(path.c_str(), uncorrected.data(), m_width, m_height, m_num_channels);
+                m_undistorter->apply(uncorrected.data(), dst, m_width, m_height, m_num_channels);
+            }
+            else
+            {
+                image::decode_file_into(path.c_str(), dst, m_width, m_height, m_num_channels);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+
+        lock.lock();
+        if (error.empty())
+        {
+            work->state = SlotState::decoded;
+        }
+        else
+        {
+            work->error.assign(error, 0, std::min<std::size_t>(error.size(), work->error.capacity()));
+            work->state = SlotState::failed;
+        }
+    }
+}
+
+SequenceStreamer::~SequenceStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    for (std::thread& worker: m_workers)
+    {
+        worker.join();
+    }
+
+    for (Slot& slot: m_slots)
+    {
+        if (slot.mapped != nullptr)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        glDeleteBuffers(1, &slot.pbo);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+} // namespace sequence
+} // namespace svm
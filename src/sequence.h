@@ -0,0 +1,105 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "resource_registry.h"
+#include "texture.h"
+#include "undistort.h"
+
+namespace svm
+{
+namespace sequence
+{
+// Plays a fixed-camera image sequence into one texture, for time-lapses whose box parameters don't
+// change between frames. Upcoming frames are decoded by worker threads straight into mapped
+// pixel-unpack buffers (one per worker, plus one more so a finished frame can wait for its turn
+// while every worker is busy). The GL thread then only unmaps a buffer and issues the
+// texture upload, so frames arrive as fast as the workers can decode them. All frames must
+// have the first frame's size and channel count; frames that don't are skipped.
+class SequenceStreamer
+{
+public:
+    // 0 workers uses one per core, less one for the GL thread. With an undistorter, workers decode
+    // into a buffer of their own and lens-correct from there into the upload buffer.
+    SequenceStreamer(std::vector<std::string> paths, int num_workers = 0,
+        std::shared_ptr<const undistort::Undistorter> undistorter = nullptr);
+
+    SequenceStreamer(const SequenceStreamer&) = delete;
+    SequenceStreamer& operator=(const SequenceStreamer&) = delete;
+
+    const std::shared_ptr<texture::Texture2D>& texture() const;
+    std::size_t num_frames() const;
+    // Index of the frame in the texture
+    std::size_t current_frame() const;
+    // Frames uploaded so far, counting repeats when the sequence loops
+    std::size_t frames_shown() const;
+    // Frames that failed to decode and were skipped, counting repeats
+    std::size_t frames_skipped() const;
+    // The error of the latest frame skipped since the last call, if any; for the caller to report
+    // outside the frame's render section
+    bool take_error(std::string& error);
+    // Frames decoded and waiting for their turn, out of num_buffers()
+    std::size_t frames_buffered();
+    std::size_t num_buffers() const;
+
+    // Call once per frame on the GL thread. Hands free buffers to the workers and, if at least
+    // `min_interval` seconds passed since the last upload and the next frame is decoded, uploads
+    // it. Returns true if the texture changed. Never waits for a decode and doesn't allocate.
+    bool update(double now, double min_interval = 0);
+
+    ~SequenceStreamer();
+
+private:
+    enum class SlotState
+    {
+        free,
+        queued,
+        decoding,
+        decoded,
+        failed
+    };
+
+    struct Slot
+    {
+        GLuint pbo = 0;
+        unsigned char* mapped = nullptr;
+        std::uint64_t ticket = 0;   // position in playback order, counting repeats
+        SlotState state = SlotState::free;
+        std::string error;
+    };
+
+    void decode_loop();
+
+    std::vector<std::string> m_paths;
+    std::shared_ptr<const undistort::Undistorter> m_undistorter;
+    int m_width;
+    int m_height;
+    int m_num_channels;
+    std::size_t m_frame_bytes;
+    std::shared_ptr<texture::Texture2D> m_texture;
+    resources::Tracked m_buffer_mem;
+    std::uint64_t m_next_to_queue;
+    std::uint64_t m_next_to_show;
+    std::size_t m_current_frame;
+    std::size_t m_frames_shown;
+    double m_last_upload;
+    std::size_t m_frames_skipped;
+    std::string m_error;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    // guarded by m_mutex while any slot is queued or decoding
+    std::vector<Slot> m_slots;
+    bool m_stop;
+    std::vector<std::thread> m_workers;
+};
+} // namespace sequence
+} // namespace svm
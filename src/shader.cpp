@@ -1,4 +1,6 @@
 #include <cstddef>
+#include <cstring>
+#include <functional>
 #include <stdexcept>
 #include <string>
 
@@ -29,6 +31,110 @@ const char* textured_obj_fshader_src =
     "    FragColor = texture(tex, TexCoord);\n"
     "}\n";
 
+// Draws two instances, one per eye. Each is squeezed into its half of the viewport and clipped
+// at the seam, since GL 3.3 has no per-primitive viewport selection.
+const char* textured_obj_stereo_vshader_src =
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout (location = 1) in vec2 aTexCoord;\n"
+    "out vec2 TexCoord;\n"
+    "uniform mat4 eye_cameras[2];\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 pos = eye_cameras[gl_InstanceID] * vec4(aPos, 1.0);\n"
+    "    float side = gl_InstanceID == 0 ? -1.0 : 1.0;\n"
+    "    gl_ClipDistance[0] = pos.w + side * pos.x;\n"
+    "    pos.x = 0.5 * (pos.x + side * pos.w);\n"
+    "    gl_Position = pos;\n"
+    "    TexCoord = aTexCoord;\n"
+    "}\n";
+
+// Renders the scene into all six layers of a cube map in one draw; the geometry shader emits each
+// triangle once per face
+const char* textured_obj_cube_vshader_src =
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout (location = 1) in vec2 aTexCoord;\n"
+    "out vec2 VertTexCoord;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_Position = vec4(aPos, 1.0);\n"
+    "    VertTexCoord = aTexCoord;\n"
+    "}\n";
+
+const char* textured_obj_cube_gshader_src =
+    "#version 330 core\n"
+    "layout (triangles) in;\n"
+    "layout (triangle_strip, max_vertices = 18) out;\n"
+    "in vec2 VertTexCoord[];\n"
+    "out vec2 TexCoord;\n"
+    "uniform mat4 face_cameras[6];\n"
+    "void main()\n"
+    "{\n"
+    "    for (int face = 0; face < 6; ++face)\n"
+    "    {\n"
+    "        for (int i = 0; i < 3; ++i)\n"
+    "        {\n"
+    "            gl_Layer = face;\n"
+    "            gl_Position = face_cameras[face] * gl_in[i].gl_Position;\n"
+    "            TexCoord = VertTexCoord[i];\n"
+    "            EmitVertex();\n"
+    "        }\n"
+    "        EndPrimitive();\n"
+    "    }\n"
+    "}\n";
+
+// A triangle covering the viewport, generated from gl_VertexID so no vertex buffer is needed.
+// uv_scale picks the lower-left part of the texture that holds the image.
+const char* fullscreen_vshader_src =
+    "#version 330 core\n"
+    "out vec2 TexCoord;\n"
+    "uniform vec2 uv_scale;\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+    "    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);\n"
+    "    TexCoord = corner * uv_scale;\n"
+    "}\n";
+
+const char* fullscreen_fshader_src =
+    "#version 330 core\n"
+    "in vec2 TexCoord;\n"
+    "out vec4 FragColor;\n"
+    "uniform sampler2D tex;\n"
+    "void main()\n"
+    "{\n"
+    "    FragColor = vec4(texture(tex, TexCoord).rgb, 1.0);\n"
+    "}\n";
+
+// Overlay quads laid out in pixels from the top-left corner. The atlas holds coverage in its red
+// channel, with a solid texel for untextured quads, so text and shapes go out in one draw.
+const char* hud_vshader_src =
+    "#version 330 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "layout (location = 1) in vec2 aTexCoord;\n"
+    "layout (location = 2) in vec4 aColor;\n"
+    "out vec2 TexCoord;\n"
+    "out vec4 Color;\n"
+    "uniform vec2 viewport_size;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_Position = vec4(aPos / viewport_size * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);\n"
+    "    TexCoord = aTexCoord;\n"
+    "    Color = aColor;\n"
+    "}\n";
+
+const char* hud_fshader_src =
+    "#version 330 core\n"
+    "in vec2 TexCoord;\n"
+    "in vec4 Color;\n"
+    "out vec4 FragColor;\n"
+    "uniform sampler2D atlas;\n"
+    "void main()\n"
+    "{\n"
+    "    FragColor = vec4(Color.rgb, Color.a * texture(atlas, TexCoord).r);\n"
+    "}\n";
+
 const char* flat_color_vshader_src =
     "#version 330 core\n"
     "layout (location = 0) in vec3 aPos;\n"
@@ -73,66 +179,187 @@ const char* dot_fshader_src =
     "    sm = sm * sm;\n"
     "    gl_FragColor = vec4(flat_color, 1 - sm);\n"
     "}\n";
+constexpr const GLenum STAGE_TYPES[] = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER };
+constexpr const char* const STAGE_NAMES[] = { "vertex", "geometry", "fragment" };
+
+// KHR_parallel_shader_compile isn't in the GL 3.3 core loader, so it's looked up by hand. The ARB
+// version has the same token and entry point semantics.
+constexpr const GLenum COMPLETION_STATUS = 0x91B1;
+typedef void (APIENTRYP max_compiler_threads_fn)(GLuint count);
+bool parallel_compile = false;
+
+bool has_extension(const char* name)
+{
+    GLint num_extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+    for (GLint i = 0; i < num_extensions; ++i)
+    {
+        const GLubyte* ext = glGetStringi(GL_EXTENSIONS, i);
+        if (ext && std::strcmp(reinterpret_cast<const char*>(ext), name) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
 } // anonymous namespace
 
 namespace svm
 {
 namespace shader
 {
-ShaderProgram::ShaderProgram(const char* vert_shader_src, const char* frag_shader_src): m_handle(0)
+void init_parallel_compile(GLADloadproc loader)
 {
-    const GLuint vert_shader = glCreateShader(GL_VERTEX_SHADER);
-    const GLuint frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    tools::ScopeGuard shader_free([vert_shader, frag_shader]()
+    const char* entry_point = nullptr;
+    if (has_extension("GL_KHR_parallel_shader_compile"))
     {
-        glDeleteShader(vert_shader);
-        glDeleteShader(frag_shader);
-    });
+        entry_point = "glMaxShaderCompilerThreadsKHR";
+    }
+    else if (has_extension("GL_ARB_parallel_shader_compile"))
+    {
+        entry_point = "glMaxShaderCompilerThreadsARB";
+    }
+    parallel_compile = entry_point != nullptr;
 
-    int success;
-    char info_log[512];
+    const max_compiler_threads_fn max_compiler_threads = entry_point
+        ? reinterpret_cast<max_compiler_threads_fn>(loader(entry_point))
+        : nullptr;
+    if (max_compiler_threads)
+    {
+        // as many threads as the driver likes
+        max_compiler_threads(0xFFFFFFFFu);
+    }
+}
 
-    // Compile vertex shader and check for compilation errors
-    glShaderSource(vert_shader, 1, &vert_shader_src, NULL);
-    glCompileShader(vert_shader);
-    glGetShaderiv(vert_shader, GL_COMPILE_STATUS, &success);
-    if (!success)
+bool parallel_compile_supported()
+{
+    return parallel_compile;
+}
+
+ShaderProgram::ShaderProgram(const char* vert_shader_src, const char* frag_shader_src)
+    : ShaderProgram(vert_shader_src, nullptr, frag_shader_src)
+{}
+
+ShaderProgram::ShaderProgram(const char* vert_shader_src, const char* geom_shader_src,
+    const char* frag_shader_src)
+    : m_handle(0)
+    , m_shaders()
+    , m_linked(false)
+    , m_on_linked()
+    , m_mem()
+{
+    // Only submits the work. Nothing here asks for a result, so drivers with
+    // KHR_parallel_shader_compile build the program on their own threads until wait().
+    const char* const sources[NUM_STAGES] = { vert_shader_src, geom_shader_src, frag_shader_src };
+    m_handle = glCreateProgram();
+    for (int i = 0; i < NUM_STAGES; ++i)
     {
-        glGetShaderInfoLog(vert_shader, sizeof(info_log), NULL, info_log);
-        throw std::runtime_error(std::string("vertex shader compile failed:\n") + std::string(info_log));
+        if (!sources[i])
+        {
+            continue;
+        }
+        m_shaders[i] = glCreateShader(STAGE_TYPES[i]);
+        glShaderSource(m_shaders[i], 1, &sources[i], NULL);
+        glCompileShader(m_shaders[i]);
+        glAttachShader(m_handle, m_shaders[i]);
     }
+    glLinkProgram(m_handle);
 
-    // Compile fragment shader and check for compilation errors
-    glShaderSource(frag_shader, 1, &frag_shader_src, NULL);
-    glCompileShader(frag_shader);
-    glGetShaderiv(frag_shader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    m_mem = resources::Tracked(resources::Kind::program, std::strlen(vert_shader_src)
+        + (geom_shader_src ? std::strlen(geom_shader_src) : 0) + std::strlen(frag_shader_src));
+}
+
+ShaderProgram::ShaderProgram(ShaderProgram&& other)
+    : m_handle(other.m_handle)
+    , m_shaders()
+    , m_linked(other.m_linked)
+    , m_on_linked(std::move(other.m_on_linked))
+    , m_mem(std::move(other.m_mem))
+{
+    for (int i = 0; i < NUM_STAGES; ++i)
     {
-        glGetShaderInfoLog(frag_shader, sizeof(info_log), NULL, info_log);
-        throw std::runtime_error(std::string("vertex shader compile failed:\n") + std::string(info_log));
+        m_shaders[i] = other.m_shaders[i];
+        other.m_shaders[i] = 0;
     }
+    other.m_handle = 0;
+}
 
-    // Create and link shader program, checking for linking errors
-    m_handle = glCreateProgram();
-    tools::ScopeGuard program_free([this]()
+ShaderProgram& ShaderProgram::operator=(ShaderProgram&& other)
+{
+    destroy();
+    m_handle = other.m_handle;
+    for (int i = 0; i < NUM_STAGES; ++i)
     {
-        glDeleteProgram(m_handle);
+        m_shaders[i] = other.m_shaders[i];
+        other.m_shaders[i] = 0;
+    }
+    m_linked = other.m_linked;
+    m_on_linked = std::move(other.m_on_linked);
+    m_mem = std::move(other.m_mem);
+    other.m_handle = 0;
+    return *this;
+}
+
+bool ShaderProgram::is_ready() const
+{
+    if (m_linked || !parallel_compile_supported())
+    {
+        return true;
+    }
+    GLint done = GL_FALSE;
+    glGetProgramiv(m_handle, COMPLETION_STATUS, &done);
+    return done == GL_TRUE;
+}
+
+void ShaderProgram::wait()
+{
+    if (m_linked)
+    {
+        return;
+    }
+
+    // pass or fail, the shader objects aren't needed after this
+    tools::ScopeGuard shaders_free([this]()
+    {
+        delete_shaders();
     });
-    glAttachShader(m_handle, vert_shader);
-    glAttachShader(m_handle, frag_shader);
-    glLinkProgram(m_handle);
+
+    int success;
+    char info_log[512];
     glGetProgramiv(m_handle, GL_LINK_STATUS, &success);
     if (!success)
     {
+        // a stage that didn't compile fails the link too, and its own log says more
+        for (int i = 0; i < NUM_STAGES; ++i)
+        {
+            if (m_shaders[i] == 0)
+            {
+                continue;
+            }
+            glGetShaderiv(m_shaders[i], GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                glGetShaderInfoLog(m_shaders[i], sizeof(info_log), NULL, info_log);
+                throw std::runtime_error(std::string(STAGE_NAMES[i]) + " shader compile failed:\n"
+                    + std::string(info_log));
+            }
+        }
         glGetProgramInfoLog(m_handle, sizeof(info_log), NULL, info_log);
         throw std::runtime_error(std::string("failed to link shader program:\n") + std::string(info_log));
     }
 
-    program_free.release();
+    m_linked = true;
+    if (m_on_linked)
+    {
+        const std::function<void(ShaderProgram&)> on_linked = std::move(m_on_linked);
+        m_on_linked = nullptr;
+        on_linked(*this);
+    }
 }
 
 void ShaderProgram::use()
 {
+    wait();
     glUseProgram(m_handle);
 }
 
@@ -148,6 +375,12 @@ void ShaderProgram::setUniformFloat(const char* uniform_name, GLfloat value)
     glUniform1f(get_uniform_loc(uniform_name), value);
 }
 
+void ShaderProgram::setUniformVec2(const char* uniform_name, const glm::vec2& value)
+{
+    use();
+    glUniform2fv(get_uniform_loc(uniform_name), 1, &value[0]);
+}
+
 void ShaderProgram::setUniformVec3(const char* uniform_name, const glm::vec3& value)
 {
     use();
@@ -166,34 +399,118 @@ void ShaderProgram::setUniformMat4(const char* uniform_name, const glm::mat4& va
     glUniformMatrix4fv(get_uniform_loc(uniform_name), 1, GL_FALSE, &value[0][0]);
 }
 
+void ShaderProgram::setUniformMat4Array(const char* uniform_name, const glm::mat4* values,
+    GLsizei count)
+{
+    use();
+    glUniformMatrix4fv(get_uniform_loc(uniform_name), count, GL_FALSE, &values[0][0][0]);
+}
+
 ShaderProgram::~ShaderProgram()
 {
-    glDeleteProgram(m_handle);
+    destroy();
 }
 
+// The factories' uniform defaults wait for the link, so they're deferred until first use
+
 ShaderProgram ShaderProgram::textured_object()
 {
     ShaderProgram prog(textured_obj_vshader_src, textured_obj_fshader_src);
-    prog.setUniformMat4("camera", glm::mat4(1.0f));
-    prog.setUniformInt("tex", 0);
+    prog.m_on_linked = [](ShaderProgram& p)
+    {
+        p.setUniformMat4("camera", glm::mat4(1.0f));
+        p.setUniformInt("tex", 0);
+    };
+    return prog;
+}
+
+ShaderProgram ShaderProgram::textured_object_stereo()
+{
+    ShaderProgram prog(textured_obj_stereo_vshader_src, textured_obj_fshader_src);
+    prog.m_on_linked = [](ShaderProgram& p)
+    {
+        const glm::mat4 identity[2] = { glm::mat4(1.0f), glm::mat4(1.0f) };
+        p.setUniformMat4Array("eye_cameras", identity, 2);
+        p.setUniformInt("tex", 0);
+    };
+    return prog;
+}
+
+ShaderProgram ShaderProgram::textured_object_cube()
+{
+    ShaderProgram prog(textured_obj_cube_vshader_src, textured_obj_cube_gshader_src,
+        textured_obj_fshader_src);
+    prog.m_on_linked = [](ShaderProgram& p)
+    {
+        p.setUniformInt("tex", 0);
+    };
+    return prog;
+}
+
+ShaderProgram ShaderProgram::fullscreen_texture()
+{
+    ShaderProgram prog(fullscreen_vshader_src, fullscreen_fshader_src);
+    prog.m_on_linked = [](ShaderProgram& p)
+    {
+        p.setUniformVec2("uv_scale", glm::vec2(1.0f, 1.0f));
+        p.setUniformInt("tex", 0);
+    };
+    return prog;
+}
+
+ShaderProgram ShaderProgram::hud_overlay()
+{
+    ShaderProgram prog(hud_vshader_src, hud_fshader_src);
+    prog.m_on_linked = [](ShaderProgram& p)
+    {
+        p.setUniformInt("atlas", 0);
+    };
     return prog;
 }
 
 ShaderProgram ShaderProgram::flat_color(const glm::vec4& rgba)
 {
     ShaderProgram prog(flat_color_vshader_src, flat_color_fshader_src);
-    prog.setUniformVec4("flat_color", rgba);
+    prog.m_on_linked = [rgba](ShaderProgram& p)
+    {
+        p.setUniformVec4("flat_color", rgba);
+    };
     return prog;
 }
 
 ShaderProgram ShaderProgram::gui_dot(const glm::vec3& rgb, float radius)
 {
     ShaderProgram prog(dot_vshader_src, dot_fshader_src);
-    prog.setUniformVec3("flat_color", rgb);
-    prog.setUniformFloat("dot_rad", radius);
+    prog.m_on_linked = [rgb, radius](ShaderProgram& p)
+    {
+        p.setUniformVec3("flat_color", rgb);
+        p.setUniformFloat("dot_rad", radius);
+    };
     return prog;
 }
 
+void ShaderProgram::delete_shaders()
+{
+    for (GLuint& shader: m_shaders)
+    {
+        if (shader != 0)
+        {
+            glDeleteShader(shader);
+            shader = 0;
+        }
+    }
+}
+
+void ShaderProgram::destroy()
+{
+    delete_shaders();
+    if (m_handle != 0)
+    {
+        glDeleteProgram(m_handle);
+        m_handle = 0;
+    }
+}
+
 GLint ShaderProgram::get_uniform_loc(const GLchar* name)
 {
     const GLint res = glGetUniformLocation(m_handle, name);
@@ -1,35 +1,87 @@
 #pragma once
 
+#include <functional>
 #include <glad/glad.h>
 #include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+
+#include "resource_registry.h"
 
 namespace svm
 {
 namespace shader
 {
+// Looks for KHR_parallel_shader_compile (or the ARB version) on the current context and lets the
+// driver use as many compiler threads as it wants. The Window calls this once GL is loaded.
+void init_parallel_compile(GLADloadproc loader);
+bool parallel_compile_supported();
+
+// Construction only submits the compile and link; the result is checked, and errors thrown, by
+// wait(), which everything that needs the program calls first. Creating programs early and using
+// them later lets the driver build them in the background.
 class ShaderProgram
 {
 public:
     ShaderProgram(const char* vert_shader_src, const char* frag_shader_src);
+    // geom_shader_src may be null
+    ShaderProgram(const char* vert_shader_src, const char* geom_shader_src,
+        const char* frag_shader_src);
+
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    ShaderProgram(ShaderProgram&&);
+    ShaderProgram& operator=(ShaderProgram&&);
+
+    // Never blocks. With parallel compile support it's true once the driver has finished the
+    // link; without it the link status can't be polled without waiting on it, so it's always
+    // true and the wait happens at first use instead.
+    bool is_ready() const;
+    // Blocks until linked and throws if a stage failed to compile or the link failed
+    void wait();
 
     void use();
 
     void setUniformInt(const char* uniform_name, GLint value);
     void setUniformFloat(const char* uniform_name, GLfloat value);
+    void setUniformVec2(const char* uniform_name, const glm::vec2& value);
     void setUniformVec3(const char* uniform_name, const glm::vec3& value);
     void setUniformVec4(const char* uniform_name, const glm::vec4& value);
     void setUniformMat4(const char* uniform_name, const glm::mat4& value);
+    // uniform_name is the array's name, without [0]
+    void setUniformMat4Array(const char* uniform_name, const glm::mat4* values, GLsizei count);
 
     ~ShaderProgram();
 
     static ShaderProgram textured_object();
+    // Side-by-side stereo in one draw: instance 0 goes to the left half of the viewport with
+    // eye_cameras[0], instance 1 to the right half. Needs GL_CLIP_DISTANCE0 enabled.
+    static ShaderProgram textured_object_stereo();
+    // Layered rendering into a cube map target: face_cameras[i] draws into layer i
+    static ShaderProgram textured_object_cube();
+    // Draws a texture over the whole viewport with glDrawArrays(GL_TRIANGLES, 0, 3); needs any
+    // vertex array bound
+    static ShaderProgram fullscreen_texture();
+    // Colored, textured 2D quads with positions in pixels; viewport_size must be set before drawing
+    static ShaderProgram hud_overlay();
     static ShaderProgram flat_color(const glm::vec4& rgba);
     static ShaderProgram gui_dot(const glm::vec3& rgb, float radius);
 
 private:
+    static constexpr const int NUM_STAGES = 3;
+
+    void delete_shaders();
+    void destroy();
     GLint get_uniform_loc(const GLchar* name);
 
     GLuint m_handle;
+    // vertex, geometry and fragment; kept until wait() so a failed link can report compile logs
+    GLuint m_shaders[NUM_STAGES];
+    bool m_linked;
+    // uniform defaults from the factories, set once linked
+    std::function<void(ShaderProgram&)> m_on_linked;
+    // GL 3.3 can't report the size of a linked program, so this books the source length
+    resources::Tracked m_mem;
 };
 } // namespace shader
 } // namespace svm
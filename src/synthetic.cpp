@@ -0,0 +1,333 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "image.h"
+#include "jobs.h"
+#include "synthetic.h"
+
+namespace
+{
+// rows per job by default
+constexpr const int DEFAULT_BAND_ROWS = 16;
+// rows rendered per write when streaming to a PPM
+constexpr const int ROWS_PER_WRITE = 256;
+// tile edge and grout width in box units, where the rear wall is 20 tall
+constexpr const float TILE_SIZE = 2.5f;
+constexpr const float GROUT_WIDTH = 0.1f;
+
+enum Surface
+{
+    rear_wall,
+    floor_surface,
+    ceiling,
+    left_wall,
+    right_wall,
+    num_surfaces
+};
+
+const unsigned char BASE_COLORS[num_surfaces][3] =
+{
+    { 196, 180, 150 },  // rear wall
+    { 120,  84,  60 },  // floor
+    { 225, 225, 215 },  // ceiling
+    { 110, 140, 170 },  // left wall
+    { 150, 170, 120 },  // right wall
+};
+
+std::uint32_t hash(std::uint32_t a, std::uint32_t b, std::uint32_t c)
+{
+    std::uint32_t h = (a * 0x9E3779B1u) ^ ((b + 0x7F4A7C15u) * 0x85EBCA77u) ^ ((c + 0x165667B1u) * 0xC2B2AE3Du);
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    h *= 0x297A2D39u;
+    h ^= h >> 15;
+    return h;
+}
+
+// [0, 1), the same on every platform unlike <random>'s distributions
+float unit(std::uint32_t seed, std::uint32_t n)
+{
+    return (hash(seed, n, 0x5EED) >> 8) * (1.0f / (1 << 24));
+}
+
+float lerp(float a, float b, float t)
+{
+    return a + (b - a) * t;
+}
+
+int band_rows(unsigned num_bands, int num_rows)
+{
+    return (num_bands == 0) ? DEFAULT_BAND_ROWS
+        : (num_rows + static_cast<int>(num_bands) - 1) / static_cast<int>(num_bands);
+}
+
+bool is_ppm(const char* path)
+{
+    const std::string p(path);
+    return p.size() >= 4 && (p.compare(p.size() - 4, 4, ".ppm") == 0 || p.compare(p.size() - 4, 4, ".PPM") == 0);
+}
+} // anonymous namespace
+
+namespace svm
+{
+namespace synthetic
+{
+RoomParams random_room(std::uint32_t seed, int width, int height)
+{
+    RoomParams params;
+    params.width = width;
+    params.height = height;
+    params.seed = seed;
+
+    const float rear_width = lerp(0.25f, 0.55f, unit(seed, 0));
+    const float rear_height = lerp(0.3f, 0.6f, unit(seed, 1));
+    params.top_left.x = lerp(0.1f, 0.9f - rear_width, unit(seed, 2));
+    params.bot_right.y = lerp(0.1f, 0.9f - rear_height, unit(seed, 3));
+    params.bot_right.x = params.top_left.x + rear_width;
+    params.top_left.y = params.bot_right.y + rear_height;
+    // inside the rear wall, or the camera would stand outside the room
+    params.vanishing.x = params.top_left.x + rear_width * lerp(0.2f, 0.8f, unit(seed, 4));
+    params.vanishing.y = params.bot_right.y + rear_height * lerp(0.2f, 0.8f, unit(seed, 5));
+    params.fovy = lerp(40.0f, 70.0f, unit(seed, 6));
+    return params;
+}
+
+RoomRenderer::RoomRenderer(const RoomParams& params)
+    : m_params(params)
+    , m_box(depth::make_box_model(params.top_left, params.bot_right, params.vanishing, params.fovy,
+        static_cast<float>(params.width) / params.height))
+    , m_mapper(m_box, params.width, params.height)
+    , m_rear_width(m_box.rear_height * (params.bot_right.x - params.top_left.x) * m_box.aspect
+        / (params.top_left.y - params.bot_right.y))
+{
+}
+
+const RoomParams& RoomRenderer::params() const
+{
+    return m_params;
+}
+
+const depth::BoxModel& RoomRenderer::box() const
+{
+    return m_box;
+}
+
+void RoomRenderer::render(unsigned char* rgb, unsigned num_bands) const
+{
+    const std::size_t row_bytes = static_cast<std::size_t>(m_params.width) * 3;
+    jobs::JobSystem::instance().parallel_for(0, m_params.height, band_rows(num_bands, m_params.height),
+        [this, rgb, row_bytes](int begin, int end)
+    {
+        render_rows(rgb + begin * row_bytes, begin, end);
+    });
+}
+
+void RoomRenderer::render_rows(unsigned char* rgb, int row_begin, int row_end) const
+{
+    const int width = m_params.width;
+    const std::uint32_t seed = m_params.seed;
+    const float rear_height = m_box.rear_height;
+    const float camera_z = m_box.camera.z;
+
+    int base[num_surfaces][3];
+    for (int s = 0; s < num_surfaces; ++s)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            base[s][c] = BASE_COLORS[s][c] + static_cast<int>(hash(seed, s, c) % 41) - 20;
+        }
+    }
+
+    std::vector<float> depth(width);
+    for (int row = row_begin; row < row_end; ++row)
+    {
+        // the mapper counts rows from the bottom
+        const int y = m_params.height - 1 - row;
+        m_mapper.compute_rows(depth.data(), y, y + 1);
+        unsigned char* out = rgb + static_cast<std::size_t>(row - row_begin) * width * 3;
+        for (int x = 0; x < width; ++x, out += 3)
+        {
+            const glm::vec3 p = m_mapper.point(x, y, depth[x]);
+            // whichever boundary the point lies on; the rear wall's depth is exactly the camera's
+            Surface surface;
+            float u, v;
+            if (depth[x] >= camera_z)
+            {
+                surface = rear_wall;
+                u = p.x;
+                v = p.y;
+            }
+            else if (std::min(p.y, rear_height - p.y) <= std::min(p.x, m_rear_width - p.x))
+            {
+                surface = (p.y < rear_height / 2) ? floor_surface : ceiling;
+                u = p.x;
+                v = p.z;
+            }
+            else
+            {
+                surface = (p.x < m_rear_width / 2) ? left_wall : right_wall;
+                u = p.z;
+                v = p.y;
+            }
+
+            const float tu = std::floor(u / TILE_SIZE);
+            const float tv = std::floor(v / TILE_SIZE);
+            const bool grout = (u - tu * TILE_SIZE < GROUT_WIDTH) || (v - tv * TILE_SIZE < GROUT_WIDTH);
+            const float shade = grout ? 0.45f
+                : 0.8f + 0.2f * unit(seed ^ (surface * 0x1000193u), hash(static_cast<std::uint32_t>(tu),
+                    static_cast<std::uint32_t>(tv), surface));
+            const int noise = static_cast<int>(hash(seed, x, y) & 15) - 8;
+            for (int c = 0; c < 3; ++c)
+            {
+                const int value = static_cast<int>(base[surface][c] * shade) + noise;
+                out[c] = static_cast<unsigned char>(std::min(std::max(value, 0), 255));
+            }
+        }
+    }
+}
+
+void write_room(const RoomParams& params, const char* image_path, const char* truth_path)
+{
+    const RoomRenderer renderer(params);
+    const std::size_t row_bytes = static_cast<std::size_t>(params.width) * 3;
+
+    if (is_ppm(image_path))
+    {
+        std::ofstream out(image_path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            throw std::runtime_error(std::string("could not open file: ") + image_path);
+        }
+        out << "P6\n" << params.width << ' ' << params.height << "\n255\n";
+
+        const int rows_per_write = std::min(params.height, ROWS_PER_WRITE);
+        std::vector<unsigned char> band(row_bytes * rows_per_write);
+        for (int band_begin = 0; band_begin < params.height; band_begin += rows_per_write)
+        {
+            const int band_end = std::min(params.height, band_begin + rows_per_write);
+            jobs::JobSystem::instance().parallel_for(band_begin, band_end, DEFAULT_BAND_ROWS, [&](int begin, int end)
+            {
+                renderer.render_rows(band.data() + (begin - band_begin) * row_bytes, begin, end);
+            });
+            out.write(reinterpret_cast<const char*>(band.data()),
+                static_cast<std::streamsize>(row_bytes * (band_end - band_begin)));
+        }
+        if (!out)
+        {
+            throw std::runtime_error(std::string("could not write file: ") + image_path);
+        }
+    }
+    else
+    {
+        // stb_image_write indexes with ints
+        if (row_bytes * params.height > static_cast<std::size_t>(INT_MAX))
+        {
+            throw std::runtime_error(std::string("too large to encode in memory, write a .ppm instead: ")
+                + image_path);
+        }
+        std::vector<unsigned char> rgb(row_bytes * params.height);
+        renderer.render(rgb.data());
+        image::write_file(image_path, rgb.data(), params.width, params.height, 3);
+    }
+
+    if (truth_path)
+    {
+        write_ground_truth(truth_path, params, image_path);
+    }
+}
+
+void write_ground_truth(const char* path, const RoomParams& params, const std::string& image_path)
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+    {
+        throw std::runtime_error(std::string("could not open file: ") + path);
+    }
+    const depth::BoxModel box = depth::make_box_model(params.top_left, params.bot_right, params.vanishing,
+        params.fovy, static_cast<float>(params.width) / params.height);
+
+    // enough digits to read back the same floats
+    out << std::setprecision(std::numeric_limits<float>::max_digits10);
+    out << "image " << image_path << "\n"
+        << "size " << params.width << ' ' << params.height << "\n"
+        << "top_left " << params.top_left.x << ' ' << params.top_left.y << "\n"
+        << "bot_right " << params.bot_right.x << ' ' << params.bot_right.y << "\n"
+        << "vanishing " << params.vanishing.x << ' ' << params.vanishing.y << "\n"
+        << "fovy " << params.fovy << "\n"
+        << "seed " << params.seed << "\n"
+        << "camera " << box.camera.x << ' ' << box.camera.y << ' ' << box.camera.z << "\n";
+    if (!out)
+    {
+        throw std::runtime_error(std::string("could not write file: ") + path);
+    }
+}
+
+RoomParams read_ground_truth(const char* path, std::string* image_path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        throw std::runtime_error(std::string("could not open file: ") + path);
+    }
+    RoomParams params;
+    bool has_size = false;
+    std::string key;
+    while (in >> key)
+    {
+        if (key == "image")
+        {
+            std::string value;
+            std::getline(in >> std::ws, value);
+            if (image_path)
+            {
+                *image_path = value;
+            }
+            continue;
+        }
+        if (key == "size")
+        {
+            in >> params.width >> params.height;
+            has_size = true;
+        }
+        else if (key == "top_left")
+        {
+            in >> params.top_left.x >> params.top_left.y;
+        }
+        else if (key == "bot_right")
+        {
+            in >> params.bot_right.x >> params.bot_right.y;
+        }
+        else if (key == "vanishing")
+        {
+            in >> params.vanishing.x >> params.vanishing.y;
+        }
+        else if (key == "fovy")
+        {
+            in >> params.fovy;
+        }
+        else if (key == "seed")
+        {
+            in >> params.seed;
+        }
+        // anything else, like the camera, is derived and only there for reading
+        in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (!in)
+        {
+            break;
+        }
+    }
+    if (in.bad() || (in.fail() && !in.eof()) || !has_size)
+    {
+        throw std::runtime_error(std::string("invalid ground truth file: ") + path);
+    }
+    return params;
+}
+} // namespace synthetic
+} // namespace svm
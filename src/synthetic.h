@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <glm/vec2.hpp>
+
+#include "depth_map.h"
+
+namespace svm
+{
+namespace synthetic
+{
+// A procedurally textured room and the handles that reconstruct it exactly: the rear wall corners
+// and vanishing point are texture coords (0 to 1, v up) and fovy is in degrees, as
+// Background::set_user_params takes them
+struct RoomParams
+{
+    int width = 3000;
+    int height = 2000;
+    glm::vec2 top_left = glm::vec2(0.3f, 0.7f);
+    glm::vec2 bot_right = glm::vec2(0.7f, 0.3f);
+    glm::vec2 vanishing = glm::vec2(0.5f, 0.45f);
+    float fovy = 54;
+    // picks the colors and tile shading
+    std::uint32_t seed = 1;
+};
+
+// A room with its rear wall, vanishing point and field of view drawn from seed, for building a
+// corpus of width x height images
+RoomParams random_room(std::uint32_t seed, int width, int height);
+
+// Renders rooms under the same pinhole box model depth::DepthMapper uses, so the handles in
+// RoomParams place the box on the image's edges. Every wall, the floor and the ceiling are tiled
+// in their own color, with grout lines and a little per-pixel noise for edge detectors to find.
+// Pixels are a hash of their position, so any band of rows renders the same on its own.
+class RoomRenderer
+{
+public:
+    // Throws if the rear wall is empty or the vanishing point puts the camera behind it
+    explicit RoomRenderer(const RoomParams& params);
+
+    const RoomParams& params() const;
+    const depth::BoxModel& box() const;
+
+    // Fills width x height RGB pixels, top-down rows as image::write_file takes them, splitting
+    // the rows into num_bands bands on the shared job system (0 picks a few rows per band)
+    void render(unsigned char* rgb, unsigned num_bands = 0) const;
+    // Rows [row_begin, row_end) from the top only, on the calling thread; rgb points at row_begin
+    void render_rows(unsigned char* rgb, int row_begin, int row_end) const;
+
+private:
+    RoomParams m_params;
+    depth::BoxModel m_box;
+    depth::DepthMapper m_mapper;
+    float m_rear_width;
+};
+
+// Renders the room to image_path and its parameters to truth_path (skipped if null). PNG and JPEG
+// are encoded in memory; a path ending in .ppm is streamed to disk a few hundred rows at a time,
+// which is the only way to write images too big to hold. Throws on failure.
+void write_room(const RoomParams& params, const char* image_path, const char* truth_path);
+
+// Plain text, one "key values..." line per field. Throws on failure.
+void write_ground_truth(const char* path, const RoomParams& params, const std::string& image_path);
+RoomParams read_ground_truth(const char* path, std::string* image_path = nullptr);
+} // namespace synthetic
+} // namespace svm
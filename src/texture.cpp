@@ -1,11 +1,21 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
+#include <algorithm>
+#include <memory>
 #include <stdexcept>
 #include <string>
 
+#include "image.h"
+#include "jpeg_reader.h"
 #include "scope_guard.h"
 #include "texture.h"
 
+namespace
+{
+// size of each pixel-unpack buffer the streaming decoder fills
+constexpr const size_t STREAM_BAND_BYTES = 4 * 1024 * 1024;
+} // anonymous namespace
+
 namespace svm
 {
 namespace texture
@@ -15,6 +25,7 @@ Texture2D::Texture2D(Texture2D&& other)
     , m_width(other.m_width)
     , m_height(other.m_height)
     , m_num_chan(other.m_num_chan)
+    , m_mem(std::move(other.m_mem))
 {
     other.m_handle = 0;
 }
@@ -30,6 +41,7 @@ Texture2D& Texture2D::operator=(Texture2D&& other)
     m_width = other.m_width;
     m_height = other.m_height;
     m_num_chan = other.m_num_chan;
+    m_mem = std::move(other.m_mem);
     other.m_handle = 0;
     return *this;
 }
@@ -44,6 +56,69 @@ int Texture2D::height() const
     return static_cast<int>(m_height);
 }
 
+int Texture2D::num_channels() const
+{
+    return static_cast<int>(m_num_chan);
+}
+
+void Texture2D::update_pixels(const void* pixels)
+{
+    glBindTexture(GL_TEXTURE_2D, m_handle);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    const GLenum pix_type = (m_num_chan == 4) ? GL_RGBA : GL_RGB;
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, pix_type, GL_UNSIGNED_BYTE, pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+void Texture2D::update_region(const unsigned char* pixels, int x, int y, int width, int height)
+{
+    glBindTexture(GL_TEXTURE_2D, m_handle);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, m_width);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, x);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, y);
+    const GLenum pix_type = (m_num_chan == 4) ? GL_RGBA : GL_RGB;
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, pix_type, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+    GLint prev_read_fbo, prev_draw_fbo;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prev_read_fbo);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev_draw_fbo);
+    GLuint fbos[2];
+    glGenFramebuffers(2, fbos);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbos[0]);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[1]);
+    tools::ScopeGuard restore([&fbos, prev_read_fbo, prev_draw_fbo]()
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(prev_read_fbo));
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(prev_draw_fbo));
+        glDeleteFramebuffers(2, fbos);
+    });
+
+    // the region's footprint on each level, rounded outwards
+    int x0 = x, y0 = y, x1 = x + width, y1 = y + height;
+    int src_width = m_width, src_height = m_height;
+    for (int level = 1; src_width > 1 || src_height > 1; ++level)
+    {
+        const int dst_width = std::max(1, src_width / 2);
+        const int dst_height = std::max(1, src_height / 2);
+        x0 /= 2;
+        y0 /= 2;
+        x1 = std::min(dst_width, (x1 + 1) / 2);
+        y1 = std::min(dst_height, (y1 + 1) / 2);
+
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_handle, level - 1);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_handle, level);
+        glBlitFramebuffer(2 * x0, 2 * y0, std::min(src_width, 2 * x1), std::min(src_height, 2 * y1),
+            x0, y0, x1, y1, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+        src_width = dst_width;
+        src_height = dst_height;
+    }
+}
+
 void Texture2D::insert_to_unit_spot(GLenum spot)
 {
     glActiveTexture(spot);
@@ -58,38 +133,106 @@ Texture2D::~Texture2D()
     }
 }
 
-Texture2D* Texture2D::from_memory(void*, size_t)
+Texture2D* Texture2D::from_memory(void* image_buf, size_t image_len)
 {
-    throw std::logic_error("not implemented");
+    const image::Image img = image::decode_memory(image_buf, image_len);
+    return from_pixels(img.pixels.get(), img.width, img.height, img.num_channels);
 }
 
 Texture2D* Texture2D::from_file(const char* image_path)
 {
-    int width, height, num_channels;
-    stbi_set_flip_vertically_on_load(true); //flip loaded texture's on the y-axis.
-    unsigned char *rgb_data = stbi_load(image_path, &width, &height, &num_channels, 0);
-    if (!rgb_data)
+#ifdef SVM_HAVE_LIBJPEG
+    if (image::is_jpeg_file(image_path))
     {
-        throw std::runtime_error(std::string("could not open file: ") + image_path);
+        return from_jpeg_streaming(image_path);
     }
-    else if (num_channels < 3 || num_channels > 4)
+#endif
+
+    const image::Image img = image::decode_file(image_path);
+    return from_pixels(img.pixels.get(), img.width, img.height, img.num_channels);
+}
+
+Texture2D* Texture2D::from_pixels(const unsigned char* rgb_data, int width, int height, int num_channels)
+{
+    if (num_channels < 3 || num_channels > 4)
     {
-        stbi_image_free(rgb_data);   
         throw std::runtime_error("unexpected number of channels: " + std::to_string(num_channels));
     }
     return new Texture2D(rgb_data, width, height, num_channels);
 }
 
-Texture2D::Texture2D(unsigned char* rgb_data, GLsizei width, GLsizei height, GLsizei num_channels)
+Texture2D* Texture2D::with_storage(int width, int height, int num_channels)
+{
+    if (num_channels < 3 || num_channels > 4)
+    {
+        throw std::runtime_error("unexpected number of channels: " + std::to_string(num_channels));
+    }
+    return new Texture2D(nullptr, width, height, num_channels);
+}
+
+Texture2D* Texture2D::from_jpeg_streaming(const char* image_path)
+{
+    image::JpegReader reader(image_path);
+    const int width = reader.width();
+    const int height = reader.height();
+    const int num_channels = reader.num_channels();
+
+    // allocates storage only; the bands below fill it in
+    std::unique_ptr<Texture2D> tex(new Texture2D(nullptr, width, height, num_channels));
+
+    const std::ptrdiff_t row_bytes = static_cast<std::ptrdiff_t>(width) * num_channels;
+    const int band_rows = std::max(1, std::min(height, static_cast<int>(STREAM_BAND_BYTES / row_bytes)));
+    const GLsizeiptr band_bytes = band_rows * row_bytes;
+
+    // two buffers, so the driver can copy one band into the texture while we decode the next
+    GLuint pbos[2];
+    glGenBuffers(2, pbos);
+    resources::Tracked pbo_mem(resources::Kind::buffer, 2 * band_bytes);
+    tools::ScopeGuard pbo_free([&pbos]()
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(2, pbos);
+    });
+
+    const GLenum pix_type = (num_channels == 4) ? GL_RGBA : GL_RGB;
+    for (int band = 0; reader.rows_read() < height; ++band)
+    {
+        const int top_row = reader.rows_read();
+        const int rows = std::min(band_rows, height - top_row);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[band % 2]);
+        // orphan the previous contents so mapping doesn't wait for the last copy out of it
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, band_bytes, NULL, GL_STREAM_DRAW);
+        unsigned char* dst = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+            rows * row_bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+        if (dst == nullptr)
+        {
+            throw std::runtime_error("could not map pixel unpack buffer");
+        }
+        {
+            tools::ScopeGuard unmap([]()
+            {
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            });
+            // JPEG rows come top-down but textures are bottom-up, so write the band backwards
+            reader.read_rows(dst + (rows - 1) * row_bytes, rows, -row_bytes);
+        }
+
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, height - top_row - rows, width, rows, pix_type,
+            GL_UNSIGNED_BYTE, NULL);
+    }
+
+    glGenerateMipmap(GL_TEXTURE_2D);
+    return tex.release();
+}
+
+Texture2D::Texture2D(const unsigned char* rgb_data, GLsizei width, GLsizei height, GLsizei num_channels)
     : m_handle()
     , m_width(width)
     , m_height(height)
     , m_num_chan(num_channels)
+    , m_mem(resources::Kind::texture, resources::texture_bytes(width, height, num_channels, true))
 {
-    tools::ScopeGuard rgb_free([rgb_data](){
-        stbi_image_free(rgb_data);
-    });
-
     glGenTextures(1, &m_handle);
     glBindTexture(GL_TEXTURE_2D, m_handle);
     // set the texture wrapping parameters
@@ -99,9 +242,15 @@ Texture2D::Texture2D(unsigned char* rgb_data, GLsizei width, GLsizei height, GLs
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+    // RGB rows are generally not a multiple of 4 bytes long
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
     const GLenum pix_type = (num_channels == 4) ? GL_RGBA : GL_RGB;
     glTexImage2D(GL_TEXTURE_2D, 0, pix_type, width, height, 0, pix_type, GL_UNSIGNED_BYTE, rgb_data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    if (rgb_data != nullptr)
+    {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
 }
 } // namespace texture
 } // namespace svm
@@ -2,6 +2,8 @@
 
 #include <glad/glad.h>
 
+#include "resource_registry.h"
+
 namespace svm
 {
 namespace texture
@@ -23,15 +25,36 @@ public:
     ~Texture2D();
 
     static Texture2D* from_memory(void* image_buf, size_t image_len);
+    // JPEGs are decoded in bands straight into mapped pixel-unpack buffers when built with
+    // libjpeg, so the full decoded image is never held in host memory
     static Texture2D* from_file(const char* image_path);
+    // Uploads already decoded, bottom-up rows of 3 or 4 channel pixels; the caller keeps ownership
+    static Texture2D* from_pixels(const unsigned char* rgb_data, int width, int height, int num_channels);
+    // Allocates uninitialized storage, to be filled in with update_pixels()
+    static Texture2D* with_storage(int width, int height, int num_channels);
+
+    int num_channels() const;
+
+    // Replaces the whole image with bottom-up rows in the texture's size and format. While a
+    // GL_PIXEL_UNPACK_BUFFER is bound, `pixels` is an offset into it instead.
+    void update_pixels(const void* pixels);
+    // Replaces one region: pixels holds bottom-up rows of a whole image in the texture's size and
+    // format, of which only the region is read. The mip levels are brought up to date over the
+    // region alone, each by blitting from the level below with linear filtering, which for the
+    // even sizes of all but the smallest levels is the same 2x2 box filter glGenerateMipmap uses.
+    void update_region(const unsigned char* pixels, int x, int y, int width, int height);
 
 private:
-    Texture2D(unsigned char* rgb_data, GLsizei width, GLsizei height, GLsizei num_channels);
+    static Texture2D* from_jpeg_streaming(const char* image_path);
+
+    // A null rgb_data allocates uninitialized storage and skips mipmap generation
+    Texture2D(const unsigned char* rgb_data, GLsizei width, GLsizei height, GLsizei num_channels);
 
     GLuint m_handle;
     GLsizei m_width;
     GLsizei m_height;
     GLsizei m_num_chan;
+    resources::Tracked m_mem;
 };
 } // namespace texture
 } // namespace svm
@@ -0,0 +1,448 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "jobs.h"
+#include "undistort.h"
+
+namespace
+{
+// bilinear weights are in 1/128ths, so a horizontally blended channel (at most 255 * 128) still
+// fits a signed 16-bit lane
+constexpr const int WEIGHT_BITS = 7;
+constexpr const int WEIGHT_ONE = 1 << WEIGHT_BITS;
+// texel index of output pixels that sample outside the photo
+constexpr const std::uint32_t OUTSIDE = 0xFFFFFFFFu;
+// rows per job by default; small enough for idle workers to steal a share of the image
+constexpr const int DEFAULT_BAND_ROWS = 16;
+
+int band_rows(unsigned num_bands, int num_rows)
+{
+    return (num_bands == 0) ? DEFAULT_BAND_ROWS
+        : (num_rows + static_cast<int>(num_bands) - 1) / static_cast<int>(num_bands);
+}
+
+// One pixel from its 2x2 footprint; the SIMD paths round the same way, so they match exactly
+template <int N>
+inline void blend(const unsigned char* lower_row, const unsigned char* upper_row, int wx, int wy, unsigned char* out)
+{
+    for (int c = 0; c < N; ++c)
+    {
+        const int lower = lower_row[c] * (WEIGHT_ONE - wx) + lower_row[N + c] * wx;
+        const int upper = upper_row[c] * (WEIGHT_ONE - wx) + upper_row[N + c] * wx;
+        out[c] = static_cast<unsigned char>((lower * (WEIGHT_ONE - wy) + upper * wy
+            + (1 << (2 * WEIGHT_BITS - 1))) >> (2 * WEIGHT_BITS));
+    }
+}
+#if defined(__SSE2__)
+// _mm_mullo_epi32 is SSE4.1; SSE2 only multiplies the even lanes into 64 bits
+inline __m128i mullo(__m128i a, __m128i b)
+{
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+        _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// no _mm_min_epi32 in SSE2
+inline __m128i clamp_max(__m128i v, __m128i max)
+{
+    const __m128i over = _mm_cmpgt_epi32(v, max);
+    return _mm_or_si128(_mm_and_si128(over, max), _mm_andnot_si128(over, v));
+}
+#endif
+} // anonymous namespace
+
+namespace svm
+{
+namespace undistort
+{
+bool LensModel::is_identity() const
+{
+    return k1 == 0 && k2 == 0 && k3 == 0 && p1 == 0 && p2 == 0;
+}
+
+bool parse_lens(const char* text, LensModel& lens)
+{
+    LensModel parsed;
+    float* const coeffs[] = { &parsed.k1, &parsed.k2, &parsed.k3, &parsed.p1, &parsed.p2 };
+    const char* p = text;
+    for (float* coeff: coeffs)
+    {
+        char* end;
+        *coeff = std::strtof(p, &end);
+        if (end == p)
+        {
+            return false;
+        }
+        p = end;
+        if (*p == '\0')
+        {
+            lens = parsed;
+            return true;
+        }
+        if (*p++ != ',')
+        {
+            return false;
+        }
+    }
+    return false;
+}
+
+UndistortMap::UndistortMap(const LensModel& lens, int width, int height)
+    : m_width(width)
+    , m_height(height)
+    , m_texels()
+    , m_wx()
+    , m_wy()
+    , m_mem()
+{
+    const std::size_t num_pixels = static_cast<std::size_t>(width) * height;
+    if (width < 2 || height < 2 || num_pixels >= OUTSIDE)
+    {
+        throw std::runtime_error("lens correction needs an image at least 2x2 and under 4 gigapixels");
+    }
+    m_texels.resize(num_pixels);
+    m_wx.resize(num_pixels);
+    m_wy.resize(num_pixels);
+    m_mem = resources::Tracked(resources::Kind::host_image, num_pixels * 6);
+
+    jobs::JobSystem::instance().parallel_for(0, height, DEFAULT_BAND_ROWS, [this, &lens](int begin, int end)
+    {
+        build_rows(lens, begin, end);
+    });
+}
+
+int UndistortMap::width() const
+{
+    return m_width;
+}
+
+int UndistortMap::height() const
+{
+    return m_height;
+}
+
+void UndistortMap::build_rows(const LensModel& lens, int row_begin, int row_end)
+{
+    const int width = m_width;
+    const int height = m_height;
+    const float cx = 0.5f * width;
+    const float cy = 0.5f * height;
+    const float radius = 0.5f * std::sqrt(static_cast<float>(width) * width + static_cast<float>(height) * height);
+    const float inv_radius = 1.0f / radius;
+
+    for (int row = row_begin; row < row_end; ++row)
+    {
+        // the model's y points down; rows are stored bottom-up
+        const float yn = (height - row - 0.5f - cy) * inv_radius;
+        const std::size_t offset = static_cast<std::size_t>(row) * width;
+        std::uint32_t* texels = &m_texels[offset];
+        std::uint8_t* wxs = &m_wx[offset];
+        std::uint8_t* wys = &m_wy[offset];
+
+        int x = 0;
+#if defined(__SSE2__)
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 k1 = _mm_set1_ps(lens.k1), k2 = _mm_set1_ps(lens.k2), k3 = _mm_set1_ps(lens.k3);
+        const __m128 p1 = _mm_set1_ps(lens.p1), p2 = _mm_set1_ps(lens.p2);
+        const __m128 y = _mm_set1_ps(yn);
+        const __m128 yy = _mm_mul_ps(y, y);
+        const __m128 rad = _mm_set1_ps(radius);
+        const __m128 inv_rad = _mm_set1_ps(inv_radius);
+        const __m128 min_coord = _mm_set1_ps(-0.5f);
+        const __m128 max_x = _mm_set1_ps(width - 0.5f);
+        const __m128 max_y = _mm_set1_ps(height - 0.5f);
+        const __m128 last_x = _mm_set1_ps(static_cast<float>(width - 1));
+        const __m128 last_y = _mm_set1_ps(static_cast<float>(height - 1));
+        const __m128i max_x0 = _mm_set1_epi32(width - 2);
+        const __m128i max_y0 = _mm_set1_epi32(height - 2);
+        const __m128i size = _mm_set1_epi32(width);
+        const __m128 weight_one = _mm_set1_ps(static_cast<float>(WEIGHT_ONE));
+        const __m128i lanes = _mm_set_epi32(3, 2, 1, 0);
+        for (; x + 4 <= width; x += 4)
+        {
+            const __m128 xs = _mm_add_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x), lanes)), half);
+            const __m128 xn = _mm_mul_ps(_mm_sub_ps(xs, _mm_set1_ps(cx)), inv_rad);
+            const __m128 xx = _mm_mul_ps(xn, xn);
+            const __m128 xy = _mm_mul_ps(xn, y);
+            const __m128 r2 = _mm_add_ps(xx, yy);
+            const __m128 radial = _mm_add_ps(one, _mm_mul_ps(r2, _mm_add_ps(k1, _mm_mul_ps(r2,
+                _mm_add_ps(k2, _mm_mul_ps(r2, k3))))));
+            const __m128 xd = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xn, radial), _mm_mul_ps(_mm_mul_ps(two, p1), xy)),
+                _mm_mul_ps(p2, _mm_add_ps(r2, _mm_mul_ps(two, xx))));
+            const __m128 yd = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, radial), _mm_mul_ps(p1, _mm_add_ps(r2,
+                _mm_mul_ps(two, yy)))), _mm_mul_ps(_mm_mul_ps(two, p2), xy));
+
+            const __m128 sx = _mm_add_ps(_mm_mul_ps(xd, rad), _mm_set1_ps(cx - 0.5f));
+            const __m128 sy = _mm_sub_ps(_mm_set1_ps(height - 0.5f - cy), _mm_mul_ps(yd, rad));
+            const __m128i inside = _mm_castps_si128(_mm_and_ps(
+                _mm_and_ps(_mm_cmpge_ps(sx, min_coord), _mm_cmple_ps(sx, max_x)),
+                _mm_and_ps(_mm_cmpge_ps(sy, min_coord), _mm_cmple_ps(sy, max_y))));
+            const __m128 px = _mm_min_ps(_mm_max_ps(sx, zero), last_x);
+            const __m128 py = _mm_min_ps(_mm_max_ps(sy, zero), last_y);
+            const __m128i x0 = clamp_max(_mm_cvttps_epi32(px), max_x0);
+            const __m128i y0 = clamp_max(_mm_cvttps_epi32(py), max_y0);
+
+            const __m128i texel = _mm_add_epi32(mullo(y0, size), x0);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(texels + x),
+                _mm_or_si128(_mm_and_si128(inside, texel), _mm_andnot_si128(inside, _mm_set1_epi32(-1))));
+            const __m128i wx = _mm_and_si128(inside, _mm_cvttps_epi32(_mm_add_ps(
+                _mm_mul_ps(_mm_sub_ps(px, _mm_cvtepi32_ps(x0)), weight_one), half)));
+            const __m128i wy = _mm_and_si128(inside, _mm_cvttps_epi32(_mm_add_ps(
+                _mm_mul_ps(_mm_sub_ps(py, _mm_cvtepi32_ps(y0)), weight_one), half)));
+            const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(wx, wy), _mm_setzero_si128());
+            const std::uint32_t wx4 = static_cast<std::uint32_t>(_mm_cvtsi128_si32(packed));
+            const std::uint32_t wy4 = static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(packed, 4)));
+            std::memcpy(wxs + x, &wx4, 4);
+            std::memcpy(wys + x, &wy4, 4);
+        }
+#elif defined(__ARM_NEON)
+        const float32x4_t one = vdupq_n_f32(1.0f);
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        const float32x4_t half = vdupq_n_f32(0.5f);
+        const float32x4_t k1 = vdupq_n_f32(lens.k1), k2 = vdupq_n_f32(lens.k2), k3 = vdupq_n_f32(lens.k3);
+        const float32x4_t y = vdupq_n_f32(yn);
+        const float32x4_t yy = vmulq_f32(y, y);
+        const float32x4_t last_x = vdupq_n_f32(static_cast<float>(width - 1));
+        const float32x4_t last_y = vdupq_n_f32(static_cast<float>(height - 1));
+        const int32x4_t max_x0 = vdupq_n_s32(width - 2);
+        const int32x4_t max_y0 = vdupq_n_s32(height - 2);
+        const int32x4_t size = vdupq_n_s32(width);
+        const float lanes_init[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+        const float32x4_t lanes = vld1q_f32(lanes_init);
+        for (; x + 4 <= width; x += 4)
+        {
+            const float32x4_t xs = vaddq_f32(vdupq_n_f32(static_cast<float>(x)), lanes);
+            const float32x4_t xn = vmulq_n_f32(vsubq_f32(xs, vdupq_n_f32(cx)), inv_radius);
+            const float32x4_t xx = vmulq_f32(xn, xn);
+            const float32x4_t xy = vmulq_f32(xn, y);
+            const float32x4_t r2 = vaddq_f32(xx, yy);
+            const float32x4_t radial = vaddq_f32(one, vmulq_f32(r2, vaddq_f32(k1, vmulq_f32(r2,
+                vaddq_f32(k2, vmulq_f32(r2, k3))))));
+            const float32x4_t xd = vaddq_f32(vaddq_f32(vmulq_f32(xn, radial), vmulq_n_f32(xy, 2.0f * lens.p1)),
+                vmulq_n_f32(vaddq_f32(r2, vaddq_f32(xx, xx)), lens.p2));
+            const float32x4_t yd = vaddq_f32(vaddq_f32(vmulq_f32(y, radial), vmulq_n_f32(vaddq_f32(r2,
+                vaddq_f32(yy, yy)), lens.p1)), vmulq_n_f32(xy, 2.0f * lens.p2));
+
+            const float32x4_t sx = vaddq_f32(vmulq_n_f32(xd, radius), vdupq_n_f32(cx - 0.5f));
+            const float32x4_t sy = vsubq_f32(vdupq_n_f32(height - 0.5f - cy), vmulq_n_f32(yd, radius));
+            const uint32x4_t inside = vandq_u32(
+                vandq_u32(vcgeq_f32(sx, vdupq_n_f32(-0.5f)), vcleq_f32(sx, vdupq_n_f32(width - 0.5f))),
+                vandq_u32(vcgeq_f32(sy, vdupq_n_f32(-0.5f)), vcleq_f32(sy, vdupq_n_f32(height - 0.5f))));
+            const float32x4_t px = vminq_f32(vmaxq_f32(sx, zero), last_x);
+            const float32x4_t py = vminq_f32(vmaxq_f32(sy, zero), last_y);
+            const int32x4_t x0 = vminq_s32(vcvtq_s32_f32(px), max_x0);
+            const int32x4_t y0 = vminq_s32(vcvtq_s32_f32(py), max_y0);
+
+            vst1q_u32(texels + x, vorrq_u32(vandq_u32(inside, vreinterpretq_u32_s32(vmlaq_s32(x0, y0, size))),
+                vmvnq_u32(inside)));
+            const uint32x4_t wx = vandq_u32(inside, vcvtq_u32_f32(vaddq_f32(
+                vmulq_n_f32(vsubq_f32(px, vcvtq_f32_s32(x0)), static_cast<float>(WEIGHT_ONE)), half)));
+            const uint32x4_t wy = vandq_u32(inside, vcvtq_u32_f32(vaddq_f32(
+                vmulq_n_f32(vsubq_f32(py, vcvtq_f32_s32(y0)), static_cast<float>(WEIGHT_ONE)), half)));
+            const uint8x8_t packed = vmovn_u16(vcombine_u16(vmovn_u32(wx), vmovn_u32(wy)));
+            const std::uint32_t wx4 = vget_lane_u32(vreinterpret_u32_u8(packed), 0);
+            const std::uint32_t wy4 = vget_lane_u32(vreinterpret_u32_u8(packed), 1);
+            std::memcpy(wxs + x, &wx4, 4);
+            std::memcpy(wys + x, &wy4, 4);
+        }
+#endif
+        for (; x < width; ++x)
+        {
+            // the same operations in the same order as the vector paths
+            const float xn = (x + 0.5f - cx) * inv_radius;
+            const float xx = xn * xn;
+            const float xy = xn * yn;
+            const float r2 = xx + yn * yn;
+            const float radial = 1.0f + r2 * (lens.k1 + r2 * (lens.k2 + r2 * lens.k3));
+            const float xd = xn * radial + 2.0f * lens.p1 * xy + lens.p2 * (r2 + 2.0f * xx);
+            const float yd = yn * radial + lens.p1 * (r2 + 2.0f * (yn * yn)) + 2.0f * lens.p2 * xy;
+
+            // texel coords in the photo, bottom-up
+            const float sx = xd * radius + (cx - 0.5f);
+            const float sy = height - 0.5f - cy - yd * radius;
+            if (!(sx >= -0.5f && sx <= width - 0.5f && sy >= -0.5f && sy <= height - 0.5f))
+            {
+                texels[x] = OUTSIDE;
+                wxs[x] = 0;
+                wys[x] = 0;
+                continue;
+            }
+            const float px = std::min(std::max(sx, 0.0f), static_cast<float>(width - 1));
+            const float py = std::min(std::max(sy, 0.0f), static_cast<float>(height - 1));
+            const int x0 = std::min(static_cast<int>(px), width - 2);
+            const int y0 = std::min(static_cast<int>(py), height - 2);
+            texels[x] = static_cast<std::uint32_t>(y0 * static_cast<std::size_t>(width) + x0);
+            wxs[x] = static_cast<std::uint8_t>((px - x0) * WEIGHT_ONE + 0.5f);
+            wys[x] = static_cast<std::uint8_t>((py - y0) * WEIGHT_ONE + 0.5f);
+        }
+    }
+}
+
+void UndistortMap::apply(const unsigned char* src, unsigned char* dst, int num_channels, unsigned num_bands) const
+{
+    if (num_channels != 3 && num_channels != 4)
+    {
+        throw std::runtime_error("lens correction needs 3 or 4 channels");
+    }
+    jobs::JobSystem::instance().parallel_for(0, m_height, band_rows(num_bands, m_height),
+        [this, src, dst, num_channels](int begin, int end)
+    {
+        if (num_channels == 3)
+        {
+            apply_rows<3>(src, dst, begin, end);
+        }
+        else
+        {
+            apply_rows<4>(src, dst, begin, end);
+        }
+    });
+}
+
+template <int N>
+void UndistortMap::apply_rows(const unsigned char* src, unsigned char* dst, int row_begin, int row_end) const
+{
+    const std::size_t stride = static_cast<std::size_t>(m_width) * N;
+    // the vector paths load 8 bytes per row of the footprint, 2 more than it covers with 3 channels
+    const std::size_t last_safe_load = stride * m_height - 8;
+
+    for (int row = row_begin; row < row_end; ++row)
+    {
+        const std::size_t offset = static_cast<std::size_t>(row) * m_width;
+        const std::uint32_t* texels = &m_texels[offset];
+        const std::uint8_t* wxs = &m_wx[offset];
+        const std::uint8_t* wys = &m_wy[offset];
+        unsigned char* out = dst + offset * N;
+
+        for (int x = 0; x < m_width; ++x, out += N)
+        {
+            if (texels[x] == OUTSIDE)
+            {
+                std::memset(out, 0, N);
+                if (N == 4)
+                {
+                    out[3] = 255;
+                }
+                continue;
+            }
+            const std::size_t lower_byte = static_cast<std::size_t>(texels[x]) * N;
+            const unsigned char* lower_row = src + lower_byte;
+            const unsigned char* upper_row = lower_row + stride;
+            const int wx = wxs[x];
+            const int wy = wys[x];
+            if (lower_byte + stride > last_safe_load)
+            {
+                blend<N>(lower_row, upper_row, wx, wy, out);
+                continue;
+            }
+#if defined(__SSE2__)
+            // both taps of a footprint row widened to 16 bits, then the right tap shifted down
+            // onto the left one's lanes
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i t = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(lower_row)), zero);
+            const __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(upper_row)), zero);
+            const __m128i w_left = _mm_set1_epi16(static_cast<short>(WEIGHT_ONE - wx));
+            const __m128i w_right = _mm_set1_epi16(static_cast<short>(wx));
+            const __m128i lower = _mm_add_epi16(_mm_mullo_epi16(t, w_left), _mm_mullo_epi16(_mm_srli_si128(t, 2 * N), w_right));
+            const __m128i upper = _mm_add_epi16(_mm_mullo_epi16(b, w_left), _mm_mullo_epi16(_mm_srli_si128(b, 2 * N), w_right));
+            // the vertical blend as one multiply-add of interleaved (lower, upper) pairs
+            const __m128i sum = _mm_madd_epi16(_mm_unpacklo_epi16(lower, upper),
+                _mm_set1_epi32((wy << 16) | (WEIGHT_ONE - wy)));
+            const __m128i rounded = _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1 << (2 * WEIGHT_BITS - 1))),
+                2 * WEIGHT_BITS);
+            const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(rounded, zero), zero);
+            const std::uint32_t pixel = static_cast<std::uint32_t>(_mm_cvtsi128_si32(packed));
+            std::memcpy(out, &pixel, N);
+#elif defined(__ARM_NEON)
+            const uint16x8_t t = vmovl_u8(vld1_u8(lower_row));
+            const uint16x8_t b = vmovl_u8(vld1_u8(upper_row));
+            const uint16_t w_left = static_cast<uint16_t>(WEIGHT_ONE - wx);
+            const uint16_t w_right = static_cast<uint16_t>(wx);
+            const uint16x4_t lower = vget_low_u16(vmlaq_n_u16(vmulq_n_u16(t, w_left), vextq_u16(t, t, N), w_right));
+            const uint16x4_t upper = vget_low_u16(vmlaq_n_u16(vmulq_n_u16(b, w_left), vextq_u16(b, b, N), w_right));
+            const uint32x4_t sum = vmlal_n_u16(vmull_n_u16(lower, static_cast<uint16_t>(WEIGHT_ONE - wy)), upper,
+                static_cast<uint16_t>(wy));
+            const uint16x4_t rounded = vrshrn_n_u32(sum, 2 * WEIGHT_BITS);
+            const std::uint32_t pixel = vget_lane_u32(vreinterpret_u32_u8(vqmovn_u16(vcombine_u16(rounded, rounded))), 0);
+            std::memcpy(out, &pixel, N);
+#else
+            blend<N>(lower_row, upper_row, wx, wy, out);
+#endif
+        }
+    }
+}
+
+constexpr const std::size_t Undistorter::MAX_MAPS;
+
+Undistorter::Undistorter(const LensModel& lens)
+    : m_lens(lens)
+    , m_mutex()
+    , m_maps()
+{
+}
+
+const LensModel& Undistorter::lens() const
+{
+    return m_lens;
+}
+
+std::shared_ptr<const UndistortMap> Undistorter::map_for(int width, int height) const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_maps.begin(); it != m_maps.end(); ++it)
+        {
+            if ((*it)->width() == width && (*it)->height() == height)
+            {
+                std::shared_ptr<const UndistortMap> map = *it;
+                m_maps.erase(it);
+                m_maps.push_back(map);
+                return map;
+            }
+        }
+    }
+
+    // built without the lock so other sizes aren't held up; if another thread built the same one
+    // meanwhile, both are kept until it ages out
+    std::shared_ptr<const UndistortMap> map = std::make_shared<UndistortMap>(m_lens, width, height);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_maps.size() >= MAX_MAPS)
+    {
+        m_maps.erase(m_maps.begin());
+    }
+    m_maps.push_back(map);
+    return map;
+}
+
+image::Image Undistorter::apply(const image::Image& img) const
+{
+    const std::size_t bytes = resources::texture_bytes(img.width, img.height, img.num_channels, false);
+    image::Image res;
+    res.pixels = std::shared_ptr<unsigned char>(new unsigned char[bytes], std::default_delete<unsigned char[]>());
+    res.width = img.width;
+    res.height = img.height;
+    res.num_channels = img.num_channels;
+    res.scale_denom = img.scale_denom;
+    res.mem = resources::Tracked(resources::Kind::host_image, bytes);
+    apply(img.pixels.get(), res.pixels.get(), img.width, img.height, img.num_channels);
+    return res;
+}
+
+void Undistorter::apply(const unsigned char* src, unsigned char* dst, int width, int height, int num_channels) const
+{
+    map_for(width, height)->apply(src, dst, num_channels);
+}
+} // namespace undistort
+} // namespace svm
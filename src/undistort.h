@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "image.h"
+#include "resource_registry.h"
+
+namespace svm
+{
+namespace undistort
+{
+// Brown-Conrady radial (k1, k2, k3) and tangential (p1, p2) lens distortion, as OpenCV and most
+// calibration tools define it. Coordinates are relative to the image centre with y down and scaled
+// so half the image diagonal is 1, which makes the same coefficients fit the image at any scale,
+// previews included.
+struct LensModel
+{
+    float k1 = 0;
+    float k2 = 0;
+    float k3 = 0;
+    float p1 = 0;
+    float p2 = 0;
+
+    bool is_identity() const;
+};
+
+// "k1,k2,k3,p1,p2", trailing coefficients optional. Returns false if text isn't such a list.
+bool parse_lens(const char* text, LensModel& lens);
+
+// Where every pixel of the corrected image samples the photo, for one lens at one image size:
+// the top-left texel of the 2x2 footprint and the bilinear weights of the right and upper taps in
+// 1/128ths, 6 bytes per pixel. Output pixels whose sample falls outside the photo are black.
+class UndistortMap
+{
+public:
+    // width and height must be at least 2. The table is built on the shared job system.
+    UndistortMap(const LensModel& lens, int width, int height);
+
+    int width() const;
+    int height() const;
+
+    // src and dst are width x height images with num_channels channels (3 or 4) in bottom-up rows,
+    // like image::Image; they must not overlap. Rows are split into num_bands bands that run on
+    // the shared job system, 0 picking a few rows per band.
+    void apply(const unsigned char* src, unsigned char* dst, int num_channels, unsigned num_bands = 0) const;
+
+private:
+    void build_rows(const LensModel& lens, int row_begin, int row_end);
+    template <int N>
+    void apply_rows(const unsigned char* src, unsigned char* dst, int row_begin, int row_end) const;
+
+    int m_width;
+    int m_height;
+    std::vector<std::uint32_t> m_texels;
+    std::vector<std::uint8_t> m_wx;
+    std::vector<std::uint8_t> m_wy;
+    resources::Tracked m_mem;
+};
+
+// Corrects images for one lens, building a map the first time it sees an image size and keeping
+// the few most recently used. Safe to call from any thread.
+class Undistorter
+{
+public:
+    static constexpr const std::size_t MAX_MAPS = 4;
+
+    explicit Undistorter(const LensModel& lens);
+
+    const LensModel& lens() const;
+
+    std::shared_ptr<const UndistortMap> map_for(int width, int height) const;
+
+    // The corrected copy of img
+    image::Image apply(const image::Image& img) const;
+    // Corrects decoded pixels (see UndistortMap::apply) into dst, e.g. a mapped GL buffer
+    void apply(const unsigned char* src, unsigned char* dst, int width, int height, int num_channels) const;
+
+private:
+    LensModel m_lens;
+    mutable std::mutex m_mutex;
+    // most recently used last
+    mutable std::vector<std::shared_ptr<const UndistortMap>> m_maps;
+};
+} // namespace undistort
+} // namespace svm
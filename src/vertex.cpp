@@ -4,6 +4,21 @@ namespace svm
 {
 namespace vertex
 {
+namespace
+{
+std::size_t num_draw_calls = 0;
+} // anonymous namespace
+
+std::size_t draw_call_count()
+{
+    return num_draw_calls;
+}
+
+void count_draw_calls(std::size_t num_calls)
+{
+    num_draw_calls += num_calls;
+}
+
 VertexArrayBuffer::VertexArrayBuffer
 (
     const vertex3_element* verts,
@@ -16,6 +31,7 @@ VertexArrayBuffer::VertexArrayBuffer
     , m_ebo(0)
     , m_draw_mode(GL_TRIANGLES)
     , m_num_elements(3 * num_triangles)
+    , m_mem(resources::Kind::buffer, sizeof(vertex3_element) * num_verts + sizeof(indexed_triangle) * num_triangles)
 {
     // Generate buffer and vertex array buffers
     glGenVertexArrays(1, &m_vao);
@@ -53,6 +69,7 @@ VertexArrayBuffer::VertexArrayBuffer
     , m_ebo(0)
     , m_draw_mode(GL_LINES)
     , m_num_elements(2 * num_lines)
+    , m_mem(resources::Kind::buffer, sizeof(vertex3_element) * num_verts + sizeof(indexed_line) * num_lines)
 {
     // Generate buffer and vertex array buffers
     glGenVertexArrays(1, &m_vao);
@@ -85,6 +102,7 @@ VertexArrayBuffer::VertexArrayBuffer(VertexArrayBuffer&& other)
     m_ebo = other.m_ebo;
     m_draw_mode = other.m_draw_mode;
     m_num_elements = other.m_num_elements;
+    m_mem = std::move(other.m_mem);
     other.m_vao = 0;
 }
 
@@ -93,9 +111,10 @@ VertexArrayBuffer& VertexArrayBuffer::operator=(VertexArrayBuffer&& other)
     destroy();
     m_vao = other.m_vao;
     m_vbo = other.m_vbo;
-    m_ebo = other.m_vbo;
+    m_ebo = other.m_ebo;
     m_draw_mode = other.m_draw_mode;
     m_num_elements = other.m_num_elements;
+    m_mem = std::move(other.m_mem);
     other.m_vao = 0;
     return *this;
 }
@@ -104,9 +123,30 @@ void VertexArrayBuffer::draw_elements()
 {
     glBindVertexArray(m_vao);
     glDrawElements(m_draw_mode, m_num_elements, GL_UNSIGNED_INT, NULL);
+    count_draw_calls();
     glBindVertexArray(0);
 }
 
+void VertexArrayBuffer::draw_elements_instanced(GLsizei num_instances)
+{
+    glBindVertexArray(m_vao);
+    glDrawElementsInstanced(m_draw_mode, m_num_elements, GL_UNSIGNED_INT, NULL, num_instances);
+    count_draw_calls();
+    glBindVertexArray(0);
+}
+
+bool VertexArrayBuffer::empty() const
+{
+    return m_vao == 0;
+}
+
+void VertexArrayBuffer::update_vertices(const vertex3_element* verts, GLsizei num_verts)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertex3_element) * num_verts, verts);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 void VertexArrayBuffer::destroy()
 {
     if (m_vao != 0)
@@ -115,6 +155,7 @@ void VertexArrayBuffer::destroy()
         glDeleteBuffers(1, &m_ebo);
         glDeleteBuffers(1, &m_vbo);
         m_vao = 0;
+        m_mem.reset();
     }
 }
 
@@ -4,6 +4,8 @@
 #include <glad/glad.h>
 #include <utility>
 
+#include "resource_registry.h"
+
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
 
 namespace svm
@@ -21,6 +23,11 @@ using indexed_line = std::pair<GLuint, GLuint>;
 static_assert(sizeof(indexed_line) == 2 * sizeof(GLuint),
     "Pair packing will not work in this configuration");
 
+// Draw calls issued on the GL thread so far. VertexArrayBuffer counts its own; code that calls
+// glDraw* directly reports its calls with count_draw_calls().
+std::size_t draw_call_count();
+void count_draw_calls(std::size_t num_calls = 1);
+
 class VertexArrayBuffer
 {
 public:
@@ -49,17 +56,23 @@ public:
     VertexArrayBuffer& operator=(VertexArrayBuffer&&);
 
     void draw_elements();
+    void draw_elements_instanced(GLsizei num_instances);
+
+    bool empty() const;
+    // Overwrites the first num_verts vertices in place, keeping the index buffer
+    void update_vertices(const vertex3_element* verts, GLsizei num_verts);
 
     ~VertexArrayBuffer();
 
 private:
     void destroy();
 
-    GLuint m_vao;
-    GLuint m_vbo;
-    GLuint m_ebo;
-    GLint m_draw_mode;
-    GLsizei m_num_elements;
+    GLuint m_vao = 0;
+    GLuint m_vbo = 0;
+    GLuint m_ebo = 0;
+    GLint m_draw_mode = GL_TRIANGLES;
+    GLsizei m_num_elements = 0;
+    resources::Tracked m_mem;
 };
 } // namespace window
 } // namespace svm
\ No newline at end of file
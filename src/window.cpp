@@ -1,6 +1,15 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <mutex>
 #include <string>
+#include <iostream>
+#include <thread>
 
+#include "alloc_counter.h"
+#include "shader.h"
 #include "window.h"
 
 namespace
@@ -16,14 +25,34 @@ svm::window::glfw_error make_current_error(const std::string& prefix = "")
     return svm::window::glfw_error(svm::window::glfw_errno, svm::window::glfw_errmsg, prefix);
 }
 
-void initialize_glfw_idempotent()
+bool is_headless_backend(svm::window::ContextBackend backend)
+{
+    return backend == svm::window::ContextBackend::egl_headless
+        || backend == svm::window::ContextBackend::osmesa_headless;
+}
+
+// frames after a reset_allocation_warmup() that may still allocate (lazy GL setup and the like)
+constexpr const int ALLOCATION_WARMUP_FRAMES = 10;
+// a frame that takes the GPU longer than this is given up on rather than waited for
+constexpr const GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+
+void initialize_glfw_idempotent(svm::window::ContextBackend backend)
 {
     static std::once_flag flag_init_glfw;;
 
-    std::call_once(flag_init_glfw, []()
+    std::call_once(flag_init_glfw, [backend]()
     {
         glfwSetErrorCallback(glfw_set_errno);
 
+        if (is_headless_backend(backend))
+        {
+#ifdef GLFW_PLATFORM_NULL
+            glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#else
+            throw std::runtime_error("headless GL backends need GLFW 3.4 or newer");
+#endif
+        }
+
         if (GLFW_TRUE != glfwInit())
         {
             throw make_current_error("failed to initialize GLFW");
@@ -44,14 +73,76 @@ namespace window
 thread_local int glfw_errno = 0;
 thread_local std::string glfw_errmsg = "";
 
-Window::Window(int width, int height, const char* title)
+ContextBackend backend_from_env(ContextBackend fallback)
+{
+    const char* name = std::getenv("SVM_GL_BACKEND");
+    if (name == nullptr || *name == '\0')
+    {
+        return fallback;
+    }
+    else if (std::strcmp(name, "window") == 0)
+    {
+        return ContextBackend::window;
+    }
+    else if (std::strcmp(name, "hidden") == 0)
+    {
+        return ContextBackend::hidden_window;
+    }
+    else if (std::strcmp(name, "egl") == 0)
+    {
+        return ContextBackend::egl_headless;
+    }
+    else if (std::strcmp(name, "osmesa") == 0)
+    {
+        return ContextBackend::osmesa_headless;
+    }
+    throw std::runtime_error(std::string("unknown SVM_GL_BACKEND: ") + name);
+}
+
+constexpr const int Window::MAX_FRAMES_IN_FLIGHT;
+
+Window::Window(int width, int height, const char* title, ContextBackend backend)
     : m_handle(nullptr)
+    , m_backend(backend)
+    , m_width(width)
+    , m_height(height)
+    , m_fb_width(width)
+    , m_fb_height(height)
+    , m_events()
+    , m_input_latency(-1.0)
+    , m_latency_stats()
+    , m_max_frames_in_flight(0)
+    , m_in_flight()
+    , m_in_flight_begin(0)
+    , m_in_flight_count(0)
+    , m_recorder()
+    , m_replayer()
+    , m_replay_realtime(false)
+    , m_record_initial_size(false)
+    , m_log_start(0)
+    , m_replayed_frames(0)
+    , m_frame_arena()
+    , m_frame_alloc_mark(tools::allocation_count())
+    , m_alloc_warmup_frames(ALLOCATION_WARMUP_FRAMES)
     , m_key_cb()
     , m_mouse_cb()
     , m_resize_cb()
 {
-    initialize_glfw_idempotent();
+    initialize_glfw_idempotent(backend);
 
+    glfwWindowHint(GLFW_VISIBLE, backend == ContextBackend::window ? GLFW_TRUE : GLFW_FALSE);
+    if (backend == ContextBackend::egl_headless)
+    {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    }
+    else if (backend == ContextBackend::osmesa_headless)
+    {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    }
+    else
+    {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_NATIVE_CONTEXT_API);
+    }
     m_handle = glfwCreateWindow(width, height, title, NULL, NULL);
     if (m_handle == NULL)
     {
@@ -63,17 +154,26 @@ Window::Window(int width, int height, const char* title)
     {
         throw std::runtime_error("Failed to initialize GLAD");
     }
+    shader::init_parallel_compile((GLADloadproc) glfwGetProcAddress);
 
-    glViewport(0, 0, width, height);
+    glfwGetWindowSize(m_handle, &m_width, &m_height);
+    glfwGetFramebufferSize(m_handle, &m_fb_width, &m_fb_height);
+    glViewport(0, 0, m_fb_width, m_fb_height);
 
     glfwSetKeyCallback(m_handle, key_callback_outer);
+    glfwSetMouseButtonCallback(m_handle, mouse_button_callback);
     glfwSetCursorPosCallback(m_handle, cursor_pos_callback);
+    glfwSetWindowSizeCallback(m_handle, window_size_callback);
     glfwSetFramebufferSizeCallback(m_handle, framebuffer_size_callback);
     glfwSetWindowUserPointer(m_handle, this);
 }
 
 Window::~Window()
 {
+    for (int i = 0; i < m_in_flight_count; ++i)
+    {
+        glDeleteSync(m_in_flight[(m_in_flight_begin + i) % MAX_FRAMES_IN_FLIGHT].fence);
+    }
     glfwDestroyWindow(m_handle);
 }
 
@@ -89,17 +189,139 @@ void Window::notify_should_close()
 
 void Window::swap_buffers()
 {
+#ifdef SVM_ALLOC_COUNTER
+    const std::size_t frame_allocs = tools::allocation_count() - m_frame_alloc_mark;
+    if (m_alloc_warmup_frames > 0)
+    {
+        --m_alloc_warmup_frames;
+    }
+    else if (frame_allocs != 0)
+    {
+        std::cerr << "steady-state frame made " << frame_allocs << " heap allocations" << std::endl;
+        assert(frame_allocs == 0);
+    }
+#endif
+
     glfwSwapBuffers(m_handle);
+    const double swap_time = now();
+    const double latency = m_events.mark_presented(swap_time);
+    if (m_max_frames_in_flight == 0)
+    {
+        if (latency >= 0)
+        {
+            record_latency(latency);
+        }
+    }
+    else
+    {
+        // retire what already finished first, so its latency is measured close to when it did
+        while (m_in_flight_count > 0 && retire_frame(false))
+        {}
+
+        InFlightFrame& frame = m_in_flight[(m_in_flight_begin + m_in_flight_count) % MAX_FRAMES_IN_FLIGHT];
+        frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frame.input_time = (latency >= 0) ? swap_time - latency : -1.0;
+        ++m_in_flight_count;
+
+        // the next frame counts against the cap as soon as it starts
+        while (m_in_flight_count >= m_max_frames_in_flight)
+        {
+            retire_frame(true);
+        }
+    }
+    m_frame_arena.reset();
+}
+
+void Window::begin_render()
+{
+    m_frame_alloc_mark = tools::allocation_count();
+}
+
+void Window::set_frame_pacing(int swap_interval, int max_frames_in_flight)
+{
+    glfwSwapInterval(swap_interval);
+    m_max_frames_in_flight = std::min(std::max(max_frames_in_flight, 0), MAX_FRAMES_IN_FLIGHT);
+    while (m_in_flight_count > 0 && m_in_flight_count >= std::max(m_max_frames_in_flight, 1))
+    {
+        retire_frame(true);
+    }
+}
+
+void Window::latch_input()
+{
+    // a log only marks frame boundaries, so input picked up mid-frame would replay at the start
+    // of its frame instead
+    if (m_max_frames_in_flight > 0 && !m_replayer && !m_recorder)
+    {
+        glfwPollEvents();
+    }
+}
+
+void Window::record_latency(double latency)
+{
+    m_input_latency = latency;
+    ++m_latency_stats.frames;
+    m_latency_stats.total += latency;
+    m_latency_stats.max = std::max(m_latency_stats.max, latency);
+}
+
+bool Window::retire_frame(bool wait)
+{
+    InFlightFrame& frame = m_in_flight[m_in_flight_begin];
+    const GLenum res = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? FENCE_TIMEOUT_NS : 0);
+    if (res == GL_TIMEOUT_EXPIRED && !wait)
+    {
+        return false;
+    }
+    // a timed out or failed wait retires the frame too rather than stall the loop
+    glDeleteSync(frame.fence);
+    if (frame.input_time >= 0 && res != GL_TIMEOUT_EXPIRED && res != GL_WAIT_FAILED)
+    {
+        record_latency(now() - frame.input_time);
+    }
+    m_in_flight_begin = (m_in_flight_begin + 1) % MAX_FRAMES_IN_FLIGHT;
+    --m_in_flight_count;
+    return true;
+}
+
+tools::FrameArena& Window::frame_arena()
+{
+    return m_frame_arena;
+}
+
+void Window::reset_allocation_warmup()
+{
+    m_alloc_warmup_frames = ALLOCATION_WARMUP_FRAMES;
+}
+
+ContextBackend Window::backend() const
+{
+    return m_backend;
+}
+
+bool Window::is_headless() const
+{
+    return is_headless_backend(m_backend);
 }
 
 void Window::get_window_size(int& width, int& height)
 {
-    glfwGetWindowSize(m_handle, &width, &height);
+    width = m_width;
+    height = m_height;
 }
 
 void Window::set_window_size(int width, int height)
 {
     glfwSetWindowSize(m_handle, width, height);
+    // the window manager may adjust this, in which case window_size_callback corrects it
+    m_width = width;
+    m_height = height;
+}
+
+void Window::get_framebuffer_size(int& width, int& height)
+{
+    width = m_fb_width;
+    height = m_fb_height;
 }
 
 void Window::enforce_aspect_ratio(int num, int denom)
@@ -109,10 +331,23 @@ void Window::enforce_aspect_ratio(int num, int denom)
 
 void Window::screen_2_gl(double screen_x, double screen_y, float& gl_x, float& gl_y)
 {
-    int width, height;
-    get_window_size(width, height);
-    gl_x = static_cast<float>(screen_x) / static_cast<float>(width) * 2.0f - 1.0f;
-    gl_y = (1.0f - static_cast<float>(screen_y) / static_cast<float>(height)) * 2.0f - 1.0f;
+    gl_x = static_cast<float>(screen_x) / static_cast<float>(m_width) * 2.0f - 1.0f;
+    gl_y = (1.0f - static_cast<float>(screen_y) / static_cast<float>(m_height)) * 2.0f - 1.0f;
+}
+
+input::EventQueue& Window::events()
+{
+    return m_events;
+}
+
+double Window::last_input_latency() const
+{
+    return m_input_latency;
+}
+
+const LatencyStats& Window::latency_stats() const
+{
+    return m_latency_stats;
 }
 
 bool Window::key_is_pressed(int key)
@@ -139,39 +374,237 @@ void Window::get_cursor_pos(double& xpos, double& ypos)
 
 void Window::poll_events()
 {
+    if (m_recorder)
+    {
+        m_recorder->write_frame(now() - m_log_start);
+        if (m_record_initial_size)
+        {
+            // inside the first frame, so the replay applies it on its first poll too
+            m_recorder->write_window_size(m_width, m_height);
+            m_record_initial_size = false;
+        }
+    }
+
+    // still pumped while replaying so the window stays responsive, but real input is dropped
     glfwPollEvents();
+
+    if (m_replayer)
+    {
+        replay_frame();
+    }
+
+    m_frame_alloc_mark = tools::allocation_count();
 }
 
-void Window::key_callback_outer(GLFWwindow* window, int key, int scancode, int action, int mods)
+double Window::now()
 {
-    Window* window_outer = static_cast<Window*>(glfwGetWindowUserPointer(window));
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+    return glfwGetTime();
+}
+
+void Window::start_recording(const std::string& path)
+{
+    m_recorder.reset(new input::InputRecorder(path));
+    m_log_start = now();
+    m_record_initial_size = true;
+}
+
+void Window::start_replay(const std::string& path, bool realtime)
+{
+    m_replayer.reset(new input::InputReplayer(path));
+    m_replay_realtime = realtime;
+    m_log_start = now();
+    m_replayed_frames = 0;
+}
+
+bool Window::is_replaying() const
+{
+    return m_replayer != nullptr;
+}
+
+std::size_t Window::replayed_frames() const
+{
+    return m_replayed_frames;
+}
+
+std::size_t Window::replay_length() const
+{
+    return m_replayer ? m_replayer->num_frames() : 0;
+}
+
+void Window::replay_frame()
+{
+    input::Record rec;
+
+    // logs from before the initial window size moved into the first frame have records ahead of
+    // its marker; they belong to the first frame
+    if (!m_replayer->at_end() && m_replayer->peek_type() == input::RecordType::frame)
+    {
+        m_replayer->next(rec);
+        if (m_replay_realtime)
+        {
+            const double wait = rec.timestamp - (now() - m_log_start);
+            if (wait > 0)
+            {
+                std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+            }
+        }
+    }
+
+    while (!m_replayer->at_end() && m_replayer->peek_type() != input::RecordType::frame)
+    {
+        m_replayer->next(rec);
+        if (rec.type == input::RecordType::window_size)
+        {
+            // the real window follows, but its size callbacks are ignored while replaying
+            glfwSetWindowSize(m_handle, rec.event.width, rec.event.height);
+            apply_window_size(rec.event.width, rec.event.height);
+            continue;
+        }
+        rec.event.timestamp = now();
+        if (rec.type == input::RecordType::resize)
+        {
+            apply_framebuffer_size(rec.event);
+            continue;
+        }
+        dispatch(rec.event);
+    }
+    ++m_replayed_frames;
+
+    if (m_replayer->at_end())
+    {
+        notify_should_close();
+    }
+}
+
+void Window::receive(const input::Event& ev)
+{
+    if (!m_replayer)
     {
-        window_outer->notify_should_close();
+        dispatch(ev);
     }
-    else if (window_outer->m_key_cb)
+    else if (ev.type == input::EventType::key && ev.code == GLFW_KEY_ESCAPE && ev.action == GLFW_PRESS)
     {
-        window_outer->m_key_cb(key, scancode, action, mods);
+        // let the operator abort a replay
+        notify_should_close();
     }
 }
 
+void Window::dispatch(const input::Event& ev)
+{
+    m_events.push(ev);
+    if (m_recorder)
+    {
+        m_recorder->write_event(ev);
+    }
+
+    switch (ev.type)
+    {
+    case input::EventType::key:
+        if (ev.code == GLFW_KEY_ESCAPE && ev.action == GLFW_PRESS)
+        {
+            notify_should_close();
+        }
+        else if (m_key_cb)
+        {
+            m_key_cb(ev.code, ev.scancode, ev.action, ev.mods);
+        }
+        break;
+    case input::EventType::cursor_pos:
+        if (m_mouse_cb)
+        {
+            m_mouse_cb(ev.x, ev.y);
+        }
+        break;
+    case input::EventType::resize:
+        if (m_resize_cb)
+        {
+            m_resize_cb(ev.width, ev.height);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void Window::key_callback_outer(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    Window* window_outer = static_cast<Window*>(glfwGetWindowUserPointer(window));
+
+    input::Event ev = {};
+    ev.type = input::EventType::key;
+    ev.timestamp = now();
+    ev.code = key;
+    ev.scancode = scancode;
+    ev.action = action;
+    ev.mods = mods;
+    window_outer->receive(ev);
+}
+
+void Window::mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
+{
+    Window* window_outer = static_cast<Window*>(glfwGetWindowUserPointer(window));
+
+    input::Event ev = {};
+    ev.type = input::EventType::mouse_button;
+    ev.timestamp = now();
+    ev.code = button;
+    ev.action = action;
+    ev.mods = mods;
+    glfwGetCursorPos(window, &ev.x, &ev.y);
+    window_outer->receive(ev);
+}
+
 void Window::cursor_pos_callback(GLFWwindow* window, double x_pos, double y_pos)
 {
     Window* window_outer = static_cast<Window*>(glfwGetWindowUserPointer(window));
-    if (window_outer->m_mouse_cb)
+
+    input::Event ev = {};
+    ev.type = input::EventType::cursor_pos;
+    ev.timestamp = now();
+    ev.x = x_pos;
+    ev.y = y_pos;
+    window_outer->receive(ev);
+}
+
+void Window::apply_window_size(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+
+    if (m_recorder)
+    {
+        m_recorder->write_window_size(width, height);
+    }
+}
+
+void Window::apply_framebuffer_size(const input::Event& ev)
+{
+    glViewport(0, 0, ev.width, ev.height);
+    m_fb_width = ev.width;
+    m_fb_height = ev.height;
+    dispatch(ev);
+}
+
+void Window::window_size_callback(GLFWwindow* window, int width, int height)
+{
+    Window* window_outer = static_cast<Window*>(glfwGetWindowUserPointer(window));
+    if (!window_outer->m_replayer)
     {
-        window_outer->m_mouse_cb(x_pos, y_pos);
+        window_outer->apply_window_size(width, height);
     }
 }
 
 void Window::framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
-
     Window* window_outer = static_cast<Window*>(glfwGetWindowUserPointer(window));
-    if (window_outer->m_resize_cb)
+    if (!window_outer->m_replayer)
     {
-        window_outer->m_resize_cb(width, height);
+        input::Event ev = {};
+        ev.type = input::EventType::resize;
+        ev.timestamp = now();
+        ev.width = width;
+        ev.height = height;
+        window_outer->apply_framebuffer_size(ev);
     }
 }
 } // namespace window
@@ -2,11 +2,16 @@
 
 #include <stdexcept>
 #include <string>
-#include <functional>
+#include <memory>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include "frame_arena.h"
+#include "inline_function.h"
+#include "input.h"
+#include "input_log.h"
+
 namespace svm 
 {
 namespace window
@@ -30,21 +35,91 @@ private:
     int m_code;
 };
 
+// Where the GL context comes from. The headless backends use GLFW's null platform, so they need
+// neither a display nor a GPU (Mesa llvmpipe works); they have no usable default framebuffer, so
+// render into a framebuffer::Framebuffer instead.
+enum class ContextBackend
+{
+    window,
+    hidden_window,
+    egl_headless,       // EGL surfaceless context
+    osmesa_headless
+};
+
+// Input-to-present latency over all frames that consumed input, in seconds
+struct LatencyStats
+{
+    std::size_t frames = 0;
+    double total = 0;
+    double max = 0;
+};
+
+// Reads SVM_GL_BACKEND ("window", "hidden", "egl" or "osmesa"), returning `fallback` if unset
+ContextBackend backend_from_env(ContextBackend fallback = ContextBackend::window);
+
 class Window
 {
 public:
-    Window(int width, int height, const char* title);
+    // GLFW is initialized on the first construction, so the platform picked by that window's
+    // backend applies to all later ones.
+    Window(int width, int height, const char* title, ContextBackend backend = ContextBackend::window);
 
     bool should_close();
     void notify_should_close();
 
+    // Marks the end of a frame: presents it, resets the frame arena and, when built with
+    // SVM_ALLOC_CHECK, checks that the frame's render section didn't heap allocate on this thread
     void swap_buffers();
+    // Starts the render section: the per-frame scene work from here to swap_buffers(), which the
+    // allocation check covers. Work that only happens on some frames, like decoding, file output or
+    // picking up finished readbacks, goes before it. Without a call, the section starts at
+    // poll_events().
+    void begin_render();
+
+    // Low-latency presentation. Sets the swap interval and, unless max_frames_in_flight is 0, makes
+    // swap_buffers() wait on fences so the GPU never has more than that many frames (1 to
+    // MAX_FRAMES_IN_FLIGHT) queued, and lets latch_input() pick up late input.
+    static constexpr const int MAX_FRAMES_IN_FLIGHT = 4;
+    void set_frame_pacing(int swap_interval, int max_frames_in_flight);
+    // Delivers input that arrived since poll_events() to events(), so a scene can apply it right
+    // before it submits its draws. A no-op without frame pacing, and while recording or replaying,
+    // which deliver input once per frame.
+    void latch_input();
+
+    // Scratch memory for the current frame, released at swap_buffers()
+    tools::FrameArena& frame_arena();
+    // Exempts the next few frames from the allocation check, for the lazy GL setup of the first
+    // frames after a scene's setup()
+    void reset_allocation_warmup();
+
+    ContextBackend backend() const;
+    bool is_headless() const;
 
     void get_window_size(int& width, int& height);
     void set_window_size(int width, int height);
+    void get_framebuffer_size(int& width, int& height);
     void enforce_aspect_ratio(int num, int denom);
     void screen_2_gl(double screen_x, double screen_y, float& gl_x, float& gl_y);
 
+    // All key, button, cursor and resize events received since the last time a scene drained it
+    input::EventQueue& events();
+    // Seconds between the oldest event a frame consumed and its presentation, for the latest frame
+    // that consumed input, or a negative value if none has yet. Presentation is the
+    // swap_buffers() call, or with frame pacing the GPU finishing the frame.
+    double last_input_latency() const;
+    const LatencyStats& latency_stats() const;
+
+    // Writes all input, window size changes and frame boundaries to a binary log, starting with the
+    // current window size in the first frame
+    void start_recording(const std::string& path);
+    // Ignores real input and instead feeds a recorded log through the same path, one recorded
+    // frame per poll_events(). With `realtime` the original frame timing is reproduced, otherwise
+    // frames are replayed as fast as the loop runs. The window asks to close at the end of the log.
+    void start_replay(const std::string& path, bool realtime);
+    bool is_replaying() const;
+    std::size_t replayed_frames() const;
+    std::size_t replay_length() const;
+
     bool key_is_pressed(int key);
 
     void set_cursor_enabled(bool enabled);
@@ -54,19 +129,19 @@ public:
     template <class CbFunc>
     void set_keyboard_callback(CbFunc&& cb)
     {
-        m_key_cb = cb;
+        m_key_cb = std::forward<CbFunc>(cb);
     }
 
     template <class CbFunc>
     void set_cursor_pos_callback(CbFunc&& cb)
     {
-        m_mouse_cb = cb;
+        m_mouse_cb = std::forward<CbFunc>(cb);
     }
 
     template <class CbFunc>
     void set_resize_callback(CbFunc&& cb)
     {
-        m_resize_cb = cb;
+        m_resize_cb = std::forward<CbFunc>(cb);
     }
 
     Window(const Window&) = delete;
@@ -76,18 +151,62 @@ public:
 
     ~Window();
 
-    static void poll_events();
+    void poll_events();
+    static double now();
 
 private:
+    struct InFlightFrame
+    {
+        GLsync fence;
+        double input_time;  // oldest input the frame consumed, negative if none
+    };
+
+    void record_latency(double latency);
+    // Retires the oldest in-flight frame if its fence has signalled, or with `wait` once it has
+    bool retire_frame(bool wait);
+    void replay_frame();
+    // entry point for events from GLFW; dropped while replaying
+    void receive(const input::Event& ev);
+    // queues and records an event and runs the registered callbacks
+    void dispatch(const input::Event& ev);
+    // Size changes, from GLFW or from a replayed log; GLFW's are dropped while replaying
+    void apply_window_size(int width, int height);
+    void apply_framebuffer_size(const input::Event& ev);
+
     static void key_callback_outer(GLFWwindow*, int, int, int, int);
+    static void mouse_button_callback(GLFWwindow*, int, int, int);
     static void cursor_pos_callback(GLFWwindow*, double, double);
+    static void window_size_callback(GLFWwindow*, int, int);
     static void framebuffer_size_callback(GLFWwindow*, int, int);
 
     GLFWwindow* m_handle;
+    ContextBackend m_backend;
+    int m_width;
+    int m_height;
+    int m_fb_width;
+    int m_fb_height;
+    input::EventQueue m_events;
+    double m_input_latency;
+    LatencyStats m_latency_stats;
+    int m_max_frames_in_flight;
+    // ring of frames submitted but not known to be finished
+    InFlightFrame m_in_flight[MAX_FRAMES_IN_FLIGHT];
+    int m_in_flight_begin;
+    int m_in_flight_count;
+    std::unique_ptr<input::InputRecorder> m_recorder;
+    std::unique_ptr<input::InputReplayer> m_replayer;
+    bool m_replay_realtime;
+    // the window size goes into the first recorded frame
+    bool m_record_initial_size;
+    double m_log_start;
+    std::size_t m_replayed_frames;
+    tools::FrameArena m_frame_arena;
+    std::size_t m_frame_alloc_mark;
+    int m_alloc_warmup_frames;
     // https://www.glfw.org/docs/latest/input_guide.html
-    std::function<void(int, int, int, int)> m_key_cb;
-    std::function<void(double, double)> m_mouse_cb;
-    std::function<void(int, int)> m_resize_cb;
+    tools::InlineFunction<void(int, int, int, int)> m_key_cb;
+    tools::InlineFunction<void(double, double)> m_mouse_cb;
+    tools::InlineFunction<void(int, int)> m_resize_cb;
 };
 }
 }
\ No newline at end of file
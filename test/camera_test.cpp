@@ -0,0 +1,119 @@
+#include <cmath>
+#include <glm/glm.hpp>
+#include <gtest/gtest.h>
+
+#include "camera.h"
+
+using namespace svm;
+
+namespace
+{
+void expect_near(const glm::mat4& a, const glm::mat4& b, float tolerance = 1e-5f)
+{
+    for (int col = 0; col < 4; ++col)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            EXPECT_NEAR(a[col][row], b[col][row], tolerance) << "[" << col << "][" << row << "]";
+        }
+    }
+}
+
+void expect_near(const glm::vec3& a, const glm::vec3& b, float tolerance = 1e-5f)
+{
+    EXPECT_NEAR(a.x, b.x, tolerance);
+    EXPECT_NEAR(a.y, b.y, tolerance);
+    EXPECT_NEAR(a.z, b.z, tolerance);
+}
+} // anonymous namespace
+
+TEST(CameraTest, ViewProjectionIsProjectionTimesView)
+{
+    camera::Camera camera;
+    camera.set_position(glm::vec3(1.0f, 2.0f, 3.0f));
+    camera.set_orientation(-60.0f, 10.0f);
+    camera.set_screen(800, 600);
+    expect_near(camera.get_view_projection(), camera.get_projection() * camera.get_view());
+}
+
+TEST(CameraTest, CachedMatricesFollowEveryChange)
+{
+    camera::Camera camera;
+    camera.set_screen(800, 600);
+    const glm::mat4 before = camera.get_projection();
+
+    // a fresh camera given the same state is what the cache must agree with
+    const auto expect_matches_fresh = [](const camera::Camera& cached)
+    {
+        camera::Camera fresh;
+        fresh.set_position(cached.position());
+        fresh.set_orientation(cached.yaw(), cached.pitch());
+        fresh.set_fovy(cached.fovy());
+        fresh.set_screen(800, 600);
+        expect_near(cached.get_view_projection(), fresh.get_view_projection());
+    };
+
+    camera.set_position(glm::vec3(0.0f, 0.0f, 5.0f));
+    expect_matches_fresh(camera);
+    camera.set_orientation(-45.0f, 20.0f);
+    expect_matches_fresh(camera);
+    camera.set_fovy(70.0f);
+    expect_matches_fresh(camera);
+
+    camera.set_screen(1600, 600);
+    const glm::mat4 wide = camera.get_projection();
+    EXPECT_NE(wide[0][0], before[0][0]);
+    // the same size again keeps the cached projection
+    camera.set_screen(1600, 600);
+    EXPECT_EQ(camera.get_projection(), wide);
+}
+
+TEST(CameraTest, YawAndPitchTurnTheBasis)
+{
+    camera::Camera camera;
+    // -90 degrees looks down -z
+    expect_near(camera.direction(), glm::vec3(0.0f, 0.0f, -1.0f));
+
+    camera.set_orientation(0.0f, 0.0f);
+    expect_near(camera.direction(), glm::vec3(1.0f, 0.0f, 0.0f));
+    expect_near(camera.up(), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    camera.set_orientation(0.0f, 30.0f);
+    EXPECT_NEAR(camera.direction().y, 0.5f, 1e-5f);
+    // pitch doesn't tilt right() out of the horizontal plane
+    EXPECT_NEAR(camera.right().y, 0.0f, 1e-5f);
+
+    // pitch is clamped short of straight up
+    camera.pitch_up(90.0f);
+    EXPECT_FLOAT_EQ(camera.pitch(), 80.0f);
+}
+
+TEST(CameraTest, MovesAlongItsBasis)
+{
+    camera::Camera camera;
+    camera.set_orientation(0.0f, 0.0f);
+    camera.move_forward(2.0f);
+    expect_near(camera.position(), glm::vec3(2.0f, 0.0f, 0.0f));
+    camera.strafe_left(1.0f);
+    expect_near(camera.position(), glm::vec3(2.0f, 0.0f, -1.0f));
+}
+
+TEST(CameraTest, PoseSweepMatchesTheCamera)
+{
+    camera::Camera camera;
+    camera.set_screen(800, 600);
+    const camera::Camera::Pose poses[2] =
+    {
+        { glm::vec3(1.0f, 2.0f, 3.0f), -30.0f, 15.0f },
+        { glm::vec3(-4.0f, 0.5f, 9.0f), 120.0f, -40.0f },
+    };
+    glm::mat4 out[2];
+    camera.get_view_projections(poses, 2, out);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        camera.set_position(poses[i].position);
+        camera.set_orientation(poses[i].yaw, poses[i].pitch);
+        expect_near(out[i], camera.get_view_projection());
+    }
+}
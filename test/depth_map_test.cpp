@@ -0,0 +1,134 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "depth_map.h"
+
+using namespace svm;
+
+namespace
+{
+constexpr const int WIDTH = 103;
+constexpr const int HEIGHT = 61;
+
+// A square image whose middle half is the rear wall, seen from the middle of the room
+depth::BoxModel centered_box()
+{
+    depth::BoxModel box;
+    box.top_left = glm::vec2(0.25f, 0.75f);
+    box.bot_right = glm::vec2(0.75f, 0.25f);
+    box.aspect = 1.0f;
+    box.rear_height = 20.0f;
+    box.camera = glm::vec3(10.0f, 10.0f, 30.0f);
+    return box;
+}
+} // anonymous namespace
+
+TEST(DepthMapTest, RearWallIsAtCameraDistance)
+{
+    const depth::DepthMapper mapper(centered_box(), WIDTH, HEIGHT);
+    std::vector<float> depth(WIDTH * HEIGHT);
+    mapper.compute(depth.data());
+
+    EXPECT_FLOAT_EQ(depth[(HEIGHT / 2) * WIDTH + WIDTH / 2], 30.0f);
+    const glm::vec3 p = mapper.point(WIDTH / 2, HEIGHT / 2, depth[(HEIGHT / 2) * WIDTH + WIDTH / 2]);
+    EXPECT_NEAR(p.x, 10.0f, 0.2f);
+    EXPECT_NEAR(p.y, 10.0f, 0.4f);
+    EXPECT_NEAR(p.z, 0.0f, 1e-4f);
+}
+
+TEST(DepthMapTest, PointsLieOnTheBox)
+{
+    const depth::DepthMapper mapper(centered_box(), WIDTH, HEIGHT);
+    std::vector<float> depth(WIDTH * HEIGHT);
+    mapper.compute(depth.data());
+
+    for (int y = 0; y < HEIGHT; ++y)
+    {
+        for (int x = 0; x < WIDTH; ++x)
+        {
+            const float d = depth[y * WIDTH + x];
+            ASSERT_GT(d, 0.0f);
+            ASSERT_LE(d, 30.0f);
+            const glm::vec3 p = mapper.point(x, y, d);
+            // on the rear wall, floor, ceiling or a side wall
+            const bool on_box = std::fabs(p.z) < 1e-3f || std::fabs(p.y) < 1e-3f
+                || std::fabs(p.y - 20.0f) < 1e-3f || std::fabs(p.x) < 1e-3f || std::fabs(p.x - 20.0f) < 1e-3f;
+            ASSERT_TRUE(on_box) << "at " << x << ", " << y;
+        }
+    }
+    // the bottom row sees the floor closer than the rear wall
+    const glm::vec3 floor = mapper.point(WIDTH / 2, 0, depth[WIDTH / 2]);
+    EXPECT_NEAR(floor.y, 0.0f, 1e-3f);
+    EXPECT_GT(floor.z, 0.0f);
+}
+
+TEST(DepthMapTest, ThreadCountDoesNotChangeOutput)
+{
+    depth::BoxModel box = centered_box();
+    box.camera = glm::vec3(4.0f, 13.0f, 25.0f);
+    const depth::DepthMapper mapper(box, WIDTH, HEIGHT);
+    std::vector<float> single(WIDTH * HEIGHT);
+    std::vector<float> many(WIDTH * HEIGHT);
+    mapper.compute(single.data(), 1);
+    mapper.compute(many.data(), 7);
+    EXPECT_EQ(single, many);
+}
+
+TEST(DepthMapTest, WritesOneVertexPerPixel)
+{
+    const depth::DepthMapper mapper(centered_box(), WIDTH, HEIGHT);
+    std::vector<float> depth(WIDTH * HEIGHT);
+    mapper.compute(depth.data());
+    std::vector<unsigned char> pixels(WIDTH * HEIGHT * 3, 200);
+    pixels[0] = 17;
+
+    const std::string path = ::testing::TempDir() + "depth_map_test.ply";
+    depth::write_point_cloud(path.c_str(), mapper, depth.data(), pixels.data(), 3, 3);
+    std::ifstream in(path, std::ios::binary);
+    const std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::remove(path.c_str());
+
+    const std::string end_header = "end_header\n";
+    const std::size_t body = contents.find(end_header) + end_header.size();
+    ASSERT_NE(contents.find("element vertex " + std::to_string(WIDTH * HEIGHT) + "\n"), std::string::npos);
+    ASSERT_EQ(contents.size() - body, static_cast<std::size_t>(WIDTH * HEIGHT) * 15);
+
+    float xyz[3];
+    std::memcpy(xyz, contents.data() + body, sizeof(xyz));
+    const glm::vec3 first = mapper.point(0, 0, depth[0]);
+    EXPECT_FLOAT_EQ(xyz[0], first.x);
+    EXPECT_FLOAT_EQ(xyz[1], first.y);
+    EXPECT_FLOAT_EQ(xyz[2], first.z);
+    EXPECT_EQ(static_cast<unsigned char>(contents[body + 12]), 17);
+}
+
+TEST(DepthMapTest, RejectsCameraBehindTheWall)
+{
+    depth::BoxModel box = centered_box();
+    box.camera.z = -1.0f;
+    EXPECT_THROW(depth::DepthMapper(box, WIDTH, HEIGHT), std::runtime_error);
+}
+
+TEST(DepthMapTest, RejectsCameraOutsideTheBox)
+{
+    depth::BoxModel box = centered_box();
+    box.camera.x = -0.5f;
+    EXPECT_THROW(depth::DepthMapper(box, WIDTH, HEIGHT), std::runtime_error);
+    box.camera.x = 20.5f;
+    EXPECT_THROW(depth::DepthMapper(box, WIDTH, HEIGHT), std::runtime_error);
+    box.camera.x = 10.0f;
+    box.camera.y = 21.0f;
+    EXPECT_THROW(depth::DepthMapper(box, WIDTH, HEIGHT), std::runtime_error);
+
+    // on the box's edge is still inside
+    box.camera.x = 0.0f;
+    box.camera.y = 20.0f;
+    EXPECT_NO_THROW(depth::DepthMapper(box, WIDTH, HEIGHT));
+}
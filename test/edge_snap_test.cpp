@@ -0,0 +1,125 @@
+#include <cstdint>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include "edge_snap.h"
+#include "image.h"
+
+using namespace svm;
+
+namespace
+{
+constexpr const int WIDTH = 200;
+constexpr const int HEIGHT = 150;
+
+// Dark image with a bright rectangle covering rows [top, bottom) and columns [left, right),
+// counted top-down
+image::Image rectangle_image(int top, int bottom, int left, int right, int num_channels = 3)
+{
+    image::Image img;
+    img.width = WIDTH;
+    img.height = HEIGHT;
+    img.num_channels = num_channels;
+    img.pixels = std::shared_ptr<unsigned char>(new unsigned char[WIDTH * HEIGHT * num_channels](),
+        std::default_delete<unsigned char[]>());
+    for (int y = top; y < bottom; ++y)
+    {
+        // image rows are stored bottom-up
+        unsigned char* row = img.pixels.get() + (HEIGHT - 1 - y) * WIDTH * num_channels;
+        for (int x = left * num_channels; x < right * num_channels; ++x)
+        {
+            row[x] = 220;
+        }
+    }
+    return img;
+}
+} // anonymous namespace
+
+TEST(EdgeSnapTest, SobelMatchesReference)
+{
+    // odd width, so both the vector loop and the scalar tail run
+    const int width = 37;
+    const int height = 9;
+    std::vector<std::uint8_t> gray(width * height);
+    std::srand(7);
+    for (std::uint8_t& p: gray)
+    {
+        p = static_cast<std::uint8_t>(std::rand() & 0xFF);
+    }
+
+    edges::Gradient grad;
+    edges::sobel(gray.data(), width, height, grad);
+
+    const auto at = [&gray, width](int x, int y) { return static_cast<int>(gray[y * width + x]); };
+    for (int y = 1; y < height - 1; ++y)
+    {
+        for (int x = 1; x < width - 1; ++x)
+        {
+            const int gx = (at(x + 1, y - 1) + 2 * at(x + 1, y) + at(x + 1, y + 1))
+                - (at(x - 1, y - 1) + 2 * at(x - 1, y) + at(x - 1, y + 1));
+            const int gy = (at(x - 1, y + 1) + 2 * at(x, y + 1) + at(x + 1, y + 1))
+                - (at(x - 1, y - 1) + 2 * at(x, y - 1) + at(x + 1, y - 1));
+            ASSERT_EQ(gx, grad.gx[y * width + x]) << x << ", " << y;
+            ASSERT_EQ(gy, grad.gy[y * width + x]) << x << ", " << y;
+        }
+    }
+}
+
+TEST(EdgeSnapTest, SnapsToNearbyRectangleEdges)
+{
+    std::shared_ptr<const edges::EdgeIndex> index = edges::EdgeIndex::build(rectangle_image(40, 110, 30, 170), 0);
+    ASSERT_EQ(WIDTH, index->width());
+    ASSERT_EQ(HEIGHT, index->height());
+
+    float snapped = -1;
+    ASSERT_TRUE(index->snap_horizontal(45, 30, 170, 8, snapped));
+    EXPECT_NEAR(40, snapped, 1.0f);
+    ASSERT_TRUE(index->snap_horizontal(104, 30, 170, 8, snapped));
+    EXPECT_NEAR(110, snapped, 1.0f);
+    ASSERT_TRUE(index->snap_vertical(25, 40, 110, 8, snapped));
+    EXPECT_NEAR(30, snapped, 1.0f);
+    ASSERT_TRUE(index->snap_vertical(174, 40, 110, 8, snapped));
+    EXPECT_NEAR(170, snapped, 1.0f);
+}
+
+TEST(EdgeSnapTest, SnapsOnGrayImages)
+{
+    for (int num_channels = 1; num_channels <= 2; ++num_channels)
+    {
+        std::shared_ptr<const edges::EdgeIndex> index =
+            edges::EdgeIndex::build(rectangle_image(40, 110, 30, 170, num_channels), 0);
+
+        float snapped = -1;
+        ASSERT_TRUE(index->snap_horizontal(45, 30, 170, 8, snapped)) << num_channels << " channels";
+        EXPECT_NEAR(40, snapped, 1.0f);
+        ASSERT_TRUE(index->snap_vertical(174, 40, 110, 8, snapped)) << num_channels << " channels";
+        EXPECT_NEAR(170, snapped, 1.0f);
+    }
+}
+
+TEST(EdgeSnapTest, IgnoresEdgesOutOfReachOrUnsupported)
+{
+    std::shared_ptr<const edges::EdgeIndex> index = edges::EdgeIndex::build(rectangle_image(40, 110, 30, 170), 0);
+
+    float snapped = -1;
+    EXPECT_FALSE(index->snap_horizontal(70, 30, 170, 8, snapped));
+    // the rectangle's top edge covers too little of this line
+    EXPECT_FALSE(index->snap_horizontal(40, 0, 200 * 8, 8, snapped));
+
+    std::shared_ptr<const edges::EdgeIndex> flat = edges::EdgeIndex::build(rectangle_image(0, 0, 0, 0), 0);
+    EXPECT_EQ(0u, flat->num_segments());
+    EXPECT_FALSE(flat->snap_horizontal(40, 30, 170, 8, snapped));
+}
+
+TEST(EdgeSnapTest, AnalysesAtMostMaxHeight)
+{
+    std::shared_ptr<const edges::EdgeIndex> index = edges::EdgeIndex::build(rectangle_image(40, 110, 30, 170), 80);
+    EXPECT_EQ(WIDTH / 2, index->width());
+    EXPECT_EQ(HEIGHT / 2, index->height());
+
+    float snapped = -1;
+    ASSERT_TRUE(index->snap_horizontal(23, 15, 85, 4, snapped));
+    EXPECT_NEAR(20, snapped, 1.0f);
+}
@@ -0,0 +1,70 @@
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <new>
+
+#include "frame_arena.h"
+#include "inline_function.h"
+
+using namespace svm;
+
+TEST(FrameArenaTest, AllocationsAreAlignedAndDisjoint)
+{
+    tools::FrameArena arena(1024);
+    char* a = static_cast<char*>(arena.allocate(3, 1));
+    double* b = arena.allocate_array<double>(4);
+    void* c = arena.allocate(8, 64);
+
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(b) % alignof(double), 0u);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(c) % 64, 0u);
+    EXPECT_GE(reinterpret_cast<char*>(b), a + 3);
+    EXPECT_GE(static_cast<char*>(c), reinterpret_cast<char*>(b + 4));
+    // allocate_array value-initializes
+    EXPECT_EQ(b[3], 0.0);
+}
+
+TEST(FrameArenaTest, ResetReusesTheBlockAndKeepsTheHighWaterMark)
+{
+    tools::FrameArena arena(1024);
+    void* first = arena.allocate(100, 16);
+    arena.allocate(200, 16);
+    const std::size_t used = arena.used();
+    EXPECT_GE(used, 300u);
+
+    arena.reset();
+    EXPECT_EQ(arena.used(), 0u);
+    EXPECT_EQ(arena.high_water_mark(), used);
+    EXPECT_EQ(arena.allocate(10, 16), first);
+    EXPECT_EQ(arena.high_water_mark(), used);
+}
+
+TEST(FrameArenaTest, ThrowsWhenTheFrameOutgrowsIt)
+{
+    tools::FrameArena arena(256);
+    arena.allocate(200, 1);
+    EXPECT_THROW(arena.allocate(100, 1), std::bad_alloc);
+    // a failed allocation leaves the arena as it was
+    EXPECT_EQ(arena.used(), 200u);
+    EXPECT_NO_THROW(arena.allocate(56, 1));
+}
+
+TEST(FrameArenaTest, InlineFunctionMovesItsCallable)
+{
+    auto counter = std::make_shared<int>(0);
+    tools::InlineFunction<int(int)> f = [counter](int n)
+    {
+        return *counter += n;
+    };
+    EXPECT_TRUE(static_cast<bool>(f));
+    EXPECT_EQ(f(2), 2);
+
+    tools::InlineFunction<int(int)> g(std::move(f));
+    EXPECT_FALSE(static_cast<bool>(f));
+    EXPECT_EQ(g(3), 5);
+    EXPECT_EQ(counter.use_count(), 2);
+
+    // the captured shared_ptr is released with the callable
+    g = nullptr;
+    EXPECT_FALSE(static_cast<bool>(g));
+    EXPECT_EQ(counter.use_count(), 1);
+}
@@ -0,0 +1,128 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+
+#include "hot_reload.h"
+
+using namespace svm;
+
+namespace
+{
+constexpr const int WIDTH = 300;
+constexpr const int HEIGHT = 200;
+
+image::Image gray_image(int width = WIDTH, int height = HEIGHT, int num_channels = 3)
+{
+    image::Image img;
+    const std::size_t bytes = static_cast<std::size_t>(width) * height * num_channels;
+    img.pixels = std::shared_ptr<unsigned char>(new unsigned char[bytes], std::default_delete<unsigned char[]>());
+    std::memset(img.pixels.get(), 100, bytes);
+    img.width = width;
+    img.height = height;
+    img.num_channels = num_channels;
+    return img;
+}
+
+image::Image copy_of(const image::Image& src)
+{
+    image::Image img = gray_image(src.width, src.height, src.num_channels);
+    std::memcpy(img.pixels.get(), src.pixels.get(), static_cast<std::size_t>(src.width) * src.height * src.num_channels);
+    return img;
+}
+
+void touch(image::Image& img, int x, int y)
+{
+    img.pixels.get()[(static_cast<std::size_t>(y) * img.width + x) * img.num_channels + 1] ^= 0xFF;
+}
+
+void write_file(const std::string& path, const char* contents)
+{
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << contents;
+}
+} // anonymous namespace
+
+TEST(HotReloadTest, SameImageHasNoDirtyRects)
+{
+    const image::Image before = gray_image();
+    EXPECT_TRUE(reload::find_dirty_rects(before, copy_of(before)).empty());
+}
+
+TEST(HotReloadTest, ChangedPixelsDirtyTheirTiles)
+{
+    const image::Image before = gray_image();
+    image::Image after = copy_of(before);
+    touch(after, 10, 10);
+    // the right edge's tiles are narrower than TILE
+    touch(after, WIDTH - 1, 70);
+    // two tiles next to each other in two tile rows make one rect
+    touch(after, 130, 140);
+    touch(after, 200, 140);
+    touch(after, 130, 199);
+    touch(after, 200, 199);
+
+    const std::vector<reload::Rect> rects = reload::find_dirty_rects(before, after);
+    ASSERT_EQ(rects.size(), 3u);
+    EXPECT_EQ(rects[0], (reload::Rect{ 0, 0, reload::TILE, reload::TILE }));
+    EXPECT_EQ(rects[1], (reload::Rect{ 4 * reload::TILE, reload::TILE, WIDTH - 4 * reload::TILE, reload::TILE }));
+    EXPECT_EQ(rects[2], (reload::Rect{ 2 * reload::TILE, 2 * reload::TILE, 2 * reload::TILE, HEIGHT - 2 * reload::TILE }));
+
+    // bands don't change the answer
+    EXPECT_EQ(reload::find_dirty_rects(before, after, 1), rects);
+}
+
+TEST(HotReloadTest, MostlyChangedOrResizedImagesAreWhole)
+{
+    const image::Image before = gray_image();
+    image::Image after = copy_of(before);
+    // 15 of the 20 tiles
+    for (int y = 0; y < 3 * reload::TILE; y += reload::TILE)
+    {
+        for (int x = 0; x < WIDTH; x += reload::TILE)
+        {
+            touch(after, x, y);
+        }
+    }
+    const reload::Rect whole = { 0, 0, WIDTH, HEIGHT };
+    EXPECT_EQ(reload::find_dirty_rects(before, after), std::vector<reload::Rect>{ whole });
+
+    const image::Image resized = gray_image(WIDTH, HEIGHT + 1);
+    EXPECT_EQ(reload::find_dirty_rects(before, resized), (std::vector<reload::Rect>{ { 0, 0, WIDTH, HEIGHT + 1 } }));
+    EXPECT_EQ(reload::find_dirty_rects(before, gray_image(WIDTH, HEIGHT, 4)), std::vector<reload::Rect>{ whole });
+    EXPECT_EQ(reload::find_dirty_rects(image::Image(), before), std::vector<reload::Rect>{ whole });
+}
+
+#if defined(__linux__)
+TEST(HotReloadTest, WatcherSeesWritesAndRenames)
+{
+    const std::string path = testing::TempDir() + "svm_hot_reload.ppm";
+    const std::string other = testing::TempDir() + "svm_hot_reload_other.ppm";
+    const std::string temp = testing::TempDir() + "svm_hot_reload.ppm.tmp";
+    write_file(path, "a");
+
+    reload::FileWatcher watcher;
+    watcher.watch(path);
+    EXPECT_EQ(watcher.path(), path);
+    EXPECT_FALSE(watcher.poll());
+
+    write_file(path, "b");
+    write_file(path, "c");
+    EXPECT_TRUE(watcher.poll());
+    EXPECT_FALSE(watcher.poll());
+
+    // other files in the directory don't count, but renaming one over the path does
+    write_file(other, "d");
+    write_file(temp, "e");
+    EXPECT_FALSE(watcher.poll());
+    ASSERT_EQ(std::rename(temp.c_str(), path.c_str()), 0);
+    EXPECT_TRUE(watcher.poll());
+
+    watcher.watch(other);
+    write_file(path, "f");
+    EXPECT_FALSE(watcher.poll());
+
+    std::remove(path.c_str());
+    std::remove(other.c_str());
+}
+#endif
@@ -0,0 +1,147 @@
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <string>
+
+#include "input_log.h"
+#include "window.h"
+
+using namespace svm;
+
+namespace
+{
+input::Event event(input::EventType type)
+{
+    input::Event ev = {};
+    ev.type = type;
+    return ev;
+}
+} // anonymous namespace
+
+TEST(InputLogTest, RecordsReadBackInOrder)
+{
+    const std::string path = testing::TempDir() + "svm_input_log.bin";
+    {
+        input::InputRecorder recorder(path);
+        recorder.write_frame(0.0);
+        recorder.write_window_size(800, 600);
+        input::Event key = event(input::EventType::key);
+        key.code = GLFW_KEY_W;
+        key.scancode = 17;
+        key.action = GLFW_PRESS;
+        key.mods = GLFW_MOD_SHIFT;
+        recorder.write_event(key);
+        input::Event button = event(input::EventType::mouse_button);
+        button.code = GLFW_MOUSE_BUTTON_LEFT;
+        button.action = GLFW_RELEASE;
+        button.x = 12.5;
+        button.y = 40;
+        recorder.write_event(button);
+        recorder.write_frame(0.25);
+        input::Event cursor = event(input::EventType::cursor_pos);
+        cursor.x = -3;
+        cursor.y = 7.75;
+        recorder.write_event(cursor);
+        input::Event resize = event(input::EventType::resize);
+        resize.width = 1600;
+        resize.height = 1200;
+        recorder.write_event(resize);
+    }
+
+    input::InputReplayer replayer(path);
+    EXPECT_EQ(replayer.num_frames(), 2u);
+    input::Record rec;
+
+    ASSERT_TRUE(replayer.next(rec));
+    EXPECT_EQ(rec.type, input::RecordType::frame);
+    EXPECT_EQ(rec.timestamp, 0.0);
+    ASSERT_TRUE(replayer.next(rec));
+    EXPECT_EQ(rec.type, input::RecordType::window_size);
+    EXPECT_EQ(rec.event.width, 800);
+    EXPECT_EQ(rec.event.height, 600);
+    ASSERT_TRUE(replayer.next(rec));
+    EXPECT_EQ(rec.type, input::RecordType::key);
+    EXPECT_EQ(rec.event.code, GLFW_KEY_W);
+    EXPECT_EQ(rec.event.scancode, 17);
+    EXPECT_EQ(rec.event.action, GLFW_PRESS);
+    EXPECT_EQ(rec.event.mods, GLFW_MOD_SHIFT);
+    ASSERT_TRUE(replayer.next(rec));
+    EXPECT_EQ(rec.type, input::RecordType::mouse_button);
+    EXPECT_EQ(rec.event.code, GLFW_MOUSE_BUTTON_LEFT);
+    EXPECT_EQ(rec.event.action, GLFW_RELEASE);
+    EXPECT_EQ(rec.event.x, 12.5);
+    EXPECT_EQ(rec.event.y, 40);
+
+    EXPECT_EQ(replayer.peek_type(), input::RecordType::frame);
+    ASSERT_TRUE(replayer.next(rec));
+    EXPECT_EQ(rec.timestamp, 0.25);
+    ASSERT_TRUE(replayer.next(rec));
+    EXPECT_EQ(rec.type, input::RecordType::cursor_pos);
+    EXPECT_EQ(rec.event.x, -3);
+    EXPECT_EQ(rec.event.y, 7.75);
+    ASSERT_TRUE(replayer.next(rec));
+    EXPECT_EQ(rec.type, input::RecordType::resize);
+    EXPECT_EQ(rec.event.width, 1600);
+    EXPECT_EQ(rec.event.height, 1200);
+
+    EXPECT_TRUE(replayer.at_end());
+    EXPECT_FALSE(replayer.next(rec));
+    std::remove(path.c_str());
+}
+
+TEST(InputLogTest, TruncatedLogThrows)
+{
+    const std::string path = testing::TempDir() + "svm_input_log_truncated.bin";
+    {
+        input::InputRecorder recorder(path);
+        recorder.write_frame(0.0);
+    }
+    {
+        // drop the last byte of the frame's timestamp
+        std::ifstream in(path, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        bytes.pop_back();
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << bytes;
+    }
+    EXPECT_THROW(input::InputReplayer replayer(path), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+// Records a few frames from one window and replays them into another, on a headless context
+TEST(InputLogTest, WindowReplaysOneRecordedFramePerPoll)
+{
+    const std::string path = testing::TempDir() + "svm_input_log_window.bin";
+    const window::ContextBackend backend = window::backend_from_env(window::ContextBackend::egl_headless);
+    constexpr int NUM_FRAMES = 3;
+    {
+        window::Window recording(320, 240, "input_log_test", backend);
+        recording.start_recording(path);
+        for (int i = 0; i < NUM_FRAMES; ++i)
+        {
+            recording.poll_events();
+        }
+    }
+
+    window::Window replaying(200, 100, "input_log_test", backend);
+    replaying.start_replay(path, false);
+    EXPECT_EQ(replaying.replay_length(), static_cast<std::size_t>(NUM_FRAMES));
+
+    // the recorded size arrives with the first frame, not a frame early
+    replaying.poll_events();
+    EXPECT_EQ(replaying.replayed_frames(), 1u);
+    int width, height;
+    replaying.get_window_size(width, height);
+    EXPECT_EQ(width, 320);
+    EXPECT_EQ(height, 240);
+
+    for (int i = 1; i < NUM_FRAMES; ++i)
+    {
+        EXPECT_FALSE(replaying.should_close());
+        replaying.poll_events();
+    }
+    EXPECT_EQ(replaying.replayed_frames(), static_cast<std::size_t>(NUM_FRAMES));
+    EXPECT_TRUE(replaying.should_close());
+    std::remove(path.c_str());
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include "input.h"
+
+using namespace svm;
+
+namespace
+{
+input::Event key_event(int code, double timestamp)
+{
+    input::Event ev = {};
+    ev.type = input::EventType::key;
+    ev.timestamp = timestamp;
+    ev.code = code;
+    return ev;
+}
+} // anonymous namespace
+
+TEST(InputTest, CapacityRoundsUpToAPowerOfTwo)
+{
+    EXPECT_EQ(input::EventQueue(5).capacity(), 8u);
+    EXPECT_EQ(input::EventQueue(8).capacity(), 8u);
+    EXPECT_EQ(input::EventQueue().capacity(), input::EventQueue::DEFAULT_CAPACITY);
+}
+
+TEST(InputTest, PopsInPushOrderAcrossTheWrap)
+{
+    input::EventQueue queue(4);
+    input::Event ev;
+    EXPECT_FALSE(queue.pop(ev));
+
+    int next_pushed = 0;
+    int next_popped = 0;
+    // keep the ring partly full so head and tail wrap around several times
+    for (int round = 0; round < 10; ++round)
+    {
+        for (int i = 0; i < 3; ++i, ++next_pushed)
+        {
+            queue.push(key_event(next_pushed, next_pushed));
+        }
+        for (int i = 0; i < 2; ++i, ++next_popped)
+        {
+            ASSERT_TRUE(queue.pop(ev));
+            EXPECT_EQ(ev.code, next_popped);
+        }
+        // drain before the ring overflows
+        while (queue.size() > 1)
+        {
+            ASSERT_TRUE(queue.pop(ev));
+            EXPECT_EQ(ev.code, next_popped++);
+        }
+    }
+    EXPECT_EQ(queue.dropped(), 0u);
+}
+
+TEST(InputTest, OverflowDropsTheOldest)
+{
+    input::EventQueue queue(4);
+    for (int i = 0; i < 6; ++i)
+    {
+        queue.push(key_event(i, i));
+    }
+    EXPECT_EQ(queue.size(), 4u);
+    EXPECT_EQ(queue.dropped(), 2u);
+
+    input::Event ev;
+    for (int expected = 2; expected < 6; ++expected)
+    {
+        ASSERT_TRUE(queue.pop(ev));
+        EXPECT_EQ(ev.code, expected);
+    }
+    EXPECT_TRUE(queue.empty());
+
+    queue.push(key_event(7, 7));
+    queue.clear();
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.pop(ev));
+}
+
+TEST(InputTest, MarkPresentedMeasuresFromTheOldestPoppedEvent)
+{
+    input::EventQueue queue(8);
+    EXPECT_LT(queue.mark_presented(1.0), 0.0);
+
+    queue.push(key_event(0, 2.0));
+    queue.push(key_event(1, 2.5));
+    input::Event ev;
+    while (queue.pop(ev))
+    {
+    }
+    EXPECT_DOUBLE_EQ(queue.mark_presented(3.0), 1.0);
+    // consumed events only count once
+    EXPECT_LT(queue.mark_presented(4.0), 0.0);
+}
@@ -0,0 +1,172 @@
+#include <atomic>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "jobs.h"
+
+using namespace svm;
+
+TEST(JobsTest, ParallelForCoversEveryTileOnce)
+{
+    jobs::JobSystem pool(4);
+    const int width = 1000, height = 333;
+    std::vector<std::atomic<int>> hits(width * height);
+    pool.parallel_for_2d(width, height, 64, 16, [&hits, width](int x0, int y0, int x1, int y1)
+    {
+        for (int y = y0; y < y1; ++y)
+        {
+            for (int x = x0; x < x1; ++x)
+            {
+                ++hits[y * width + x];
+            }
+        }
+    });
+    for (const std::atomic<int>& hit: hits)
+    {
+        ASSERT_EQ(hit.load(), 1);
+    }
+}
+
+TEST(JobsTest, DependenciesRunFirst)
+{
+    jobs::JobSystem pool(3);
+    std::atomic<int> stage(0);
+    std::atomic<bool> in_order(true);
+    std::vector<jobs::TaskHandle> first;
+    for (int i = 0; i < 8; ++i)
+    {
+        first.push_back(pool.submit([&stage]()
+        {
+            ++stage;
+        }));
+    }
+    const jobs::TaskHandle last = pool.submit([&stage, &in_order]()
+    {
+        in_order = in_order && stage.load() == 8;
+    }, first);
+    pool.wait(last);
+    EXPECT_TRUE(in_order);
+    EXPECT_TRUE(jobs::JobSystem::is_done(last));
+}
+
+TEST(JobsTest, NestedWaitsDontDeadlock)
+{
+    // more nested waits than workers; waiting threads run the queued tasks themselves
+    jobs::JobSystem pool(1);
+    std::atomic<int> sum(0);
+    pool.parallel_for(0, 16, 1, [&pool, &sum](int, int)
+    {
+        pool.parallel_for(0, 16, 1, [&sum](int begin, int end)
+        {
+            sum += end - begin;
+        });
+    });
+    EXPECT_EQ(sum.load(), 256);
+}
+
+TEST(JobsTest, FuturesAndErrorsComeBack)
+{
+    jobs::JobSystem pool(2);
+    std::future<int> answer = pool.async([]()
+    {
+        return 42;
+    });
+    EXPECT_EQ(answer.get(), 42);
+
+    const jobs::TaskHandle failing = pool.submit([]()
+    {
+        throw std::runtime_error("boom");
+    });
+    EXPECT_THROW(pool.wait(failing), std::runtime_error);
+    EXPECT_THROW(pool.parallel_for(0, 10, 1, [](int begin, int)
+    {
+        if (begin == 7)
+        {
+            throw std::runtime_error("boom");
+        }
+    }), std::runtime_error);
+}
+
+TEST(JobsTest, MainThreadTasksRunWhenPolled)
+{
+    jobs::JobSystem pool(2);
+    int result = 0;
+    const jobs::TaskHandle task = pool.submit([&pool, &result]()
+    {
+        pool.post_to_main([&result]()
+        {
+            result = 7;
+        });
+    });
+    pool.wait(task);
+    EXPECT_EQ(result, 0);
+    EXPECT_EQ(pool.run_main_thread_tasks(), 1u);
+    EXPECT_EQ(result, 7);
+    EXPECT_EQ(pool.run_main_thread_tasks(), 0u);
+}
+
+TEST(JobsTest, IdleWorkersSteal)
+{
+    jobs::JobSystem pool(4);
+    // everything lands in worker 0's deque, so the others only get work by stealing
+    const jobs::TaskHandle root = pool.submit([&pool]()
+    {
+        pool.parallel_for(0, 256, 1, [](int, int)
+        {
+            volatile int spin = 0;
+            for (int i = 0; i < 200000; ++i)
+            {
+                spin = spin + i;
+            }
+        });
+    });
+    pool.wait(root);
+
+    std::uint64_t run = 0, stolen = 0;
+    for (unsigned i = 0; i < pool.num_workers(); ++i)
+    {
+        run += pool.worker_stats(i).tasks_run;
+        stolen += pool.worker_stats(i).tasks_stolen;
+    }
+    EXPECT_GT(run, 0u);
+    EXPECT_GT(stolen, 0u);
+}
+
+TEST(JobsTest, OutsideThreadsOnlyRunWhatTheyWaitFor)
+{
+    jobs::JobSystem pool(1);
+    std::atomic<bool> started(false), release(false), other_ran(false);
+    // keep the only worker busy so everything after this stays queued
+    const jobs::TaskHandle blocker = pool.submit([&started, &release]()
+    {
+        started = true;
+        while (!release)
+        {
+            std::this_thread::yield();
+        }
+    });
+    while (!started)
+    {
+        std::this_thread::yield();
+    }
+
+    const jobs::TaskHandle other = pool.submit([&other_ran]()
+    {
+        other_ran = true;
+    });
+    bool awaited_ran = false;
+    const jobs::TaskHandle awaited = pool.submit([&awaited_ran]()
+    {
+        awaited_ran = true;
+    });
+    pool.wait(awaited);
+    EXPECT_TRUE(awaited_ran);
+    EXPECT_FALSE(other_ran.load());
+
+    release = true;
+    pool.wait(other);
+    pool.wait(blocker);
+    EXPECT_TRUE(other_ran.load());
+}
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+#include "panorama.h"
+
+using namespace svm;
+
+namespace
+{
+constexpr const int FACE_SIZE = 32;
+constexpr const int WIDTH = 4 * FACE_SIZE;
+constexpr const int HEIGHT = WIDTH / 2;
+
+std::vector<unsigned char> solid_faces()
+{
+    // a distinct red per face, in GL's face order
+    std::vector<unsigned char> faces(6 * FACE_SIZE * FACE_SIZE * 4, 255);
+    for (int face = 0; face < 6; ++face)
+    {
+        for (int i = 0; i < FACE_SIZE * FACE_SIZE; ++i)
+        {
+            faces[(face * FACE_SIZE * FACE_SIZE + i) * 4] = static_cast<unsigned char>(40 * face);
+        }
+    }
+    return faces;
+}
+
+std::vector<unsigned char> random_faces()
+{
+    std::srand(448);
+    std::vector<unsigned char> faces(6 * FACE_SIZE * FACE_SIZE * 4);
+    for (unsigned char& c: faces)
+    {
+        c = static_cast<unsigned char>(std::rand() % 256);
+    }
+    return faces;
+}
+
+unsigned char red_at(const std::vector<unsigned char>& rgb, int x, int y)
+{
+    return rgb[(y * WIDTH + x) * 3];
+}
+
+// Straight from the GL spec's cube map selection table, in double precision
+double reference_sample(const std::vector<unsigned char>& faces, double dx, double dy, double dz, int c)
+{
+    const double ax = std::fabs(dx), ay = std::fabs(dy), az = std::fabs(dz);
+    int face;
+    double ma, sc, tc;
+    if (ax >= ay && ax >= az)
+    {
+        face = dx > 0 ? 0 : 1; ma = ax; sc = dx > 0 ? -dz : dz; tc = -dy;
+    }
+    else if (ay >= az)
+    {
+        face = dy > 0 ? 2 : 3; ma = ay; sc = dx; tc = dy > 0 ? dz : -dz;
+    }
+    else
+    {
+        face = dz > 0 ? 4 : 5; ma = az; sc = dz > 0 ? dx : -dx; tc = -dy;
+    }
+    const double s = std::min(std::max((sc / ma + 1) / 2 * FACE_SIZE - 0.5, 0.0), FACE_SIZE - 1.0);
+    const double t = std::min(std::max((tc / ma + 1) / 2 * FACE_SIZE - 0.5, 0.0), FACE_SIZE - 1.0);
+    const int x0 = std::min(static_cast<int>(s), FACE_SIZE - 2);
+    const int y0 = std::min(static_cast<int>(t), FACE_SIZE - 2);
+    const auto at = [&](int x, int y)
+    {
+        return static_cast<double>(faces[((face * FACE_SIZE + y) * FACE_SIZE + x) * 4 + c]);
+    };
+    const double fx = s - x0, fy = t - y0;
+    return (at(x0, y0) * (1 - fx) + at(x0 + 1, y0) * fx) * (1 - fy)
+        + (at(x0, y0 + 1) * (1 - fx) + at(x0 + 1, y0 + 1) * fx) * fy;
+}
+} // anonymous namespace
+
+TEST(PanoramaTest, FacesLandWhereExpected)
+{
+    const std::vector<unsigned char> faces = solid_faces();
+    const panorama::EquirectRemapper remapper(WIDTH);
+    ASSERT_EQ(remapper.height(), HEIGHT);
+
+    std::vector<unsigned char> rgb(WIDTH * HEIGHT * 3);
+    remapper.remap(faces.data(), FACE_SIZE, rgb.data());
+
+    const int mid = HEIGHT / 2;
+    EXPECT_EQ(red_at(rgb, WIDTH / 2, mid), 40 * 5);        // centre looks down -z
+    EXPECT_EQ(red_at(rgb, WIDTH / 4, mid), 40 * 1);        // a quarter turn left is -x
+    EXPECT_EQ(red_at(rgb, 3 * WIDTH / 4, mid), 40 * 0);    // a quarter turn right is +x
+    EXPECT_EQ(red_at(rgb, 0, mid), 40 * 4);                // behind is +z
+    EXPECT_EQ(red_at(rgb, WIDTH / 2, 0), 40 * 2);          // top row is +y
+    EXPECT_EQ(red_at(rgb, WIDTH / 2, HEIGHT - 1), 40 * 3); // bottom row is -y
+}
+
+TEST(PanoramaTest, MatchesReferenceLookup)
+{
+    const std::vector<unsigned char> faces = random_faces();
+    const panorama::EquirectRemapper remapper(WIDTH);
+    std::vector<unsigned char> rgb(WIDTH * HEIGHT * 3);
+    remapper.remap(faces.data(), FACE_SIZE, rgb.data());
+
+    const double pi = std::acos(-1.0);
+    for (int y = 0; y < HEIGHT; ++y)
+    {
+        const double lat = (0.5 - (y + 0.5) / HEIGHT) * pi;
+        for (int x = 0; x < WIDTH; ++x)
+        {
+            const double lon = ((x + 0.5) / WIDTH * 2 - 1) * pi;
+            const double dx = std::cos(lat) * std::sin(lon);
+            const double dy = std::sin(lat);
+            const double dz = -std::cos(lat) * std::cos(lon);
+            for (int c = 0; c < 3; ++c)
+            {
+                // 8-bit weights and float directions put a texel or so of slack on each tap
+                ASSERT_NEAR(rgb[(y * WIDTH + x) * 3 + c], reference_sample(faces, dx, dy, dz, c), 4.0)
+                    << "at " << x << ", " << y;
+            }
+        }
+    }
+}
+
+TEST(PanoramaTest, ThreadCountDoesNotChangeOutput)
+{
+    const std::vector<unsigned char> faces = random_faces();
+    const panorama::EquirectRemapper remapper(WIDTH);
+    std::vector<unsigned char> single(WIDTH * HEIGHT * 3);
+    std::vector<unsigned char> many(WIDTH * HEIGHT * 3);
+    remapper.remap(faces.data(), FACE_SIZE, single.data(), 1);
+    remapper.remap(faces.data(), FACE_SIZE, many.data(), 7);
+    EXPECT_EQ(single, many);
+}
+
+TEST(PanoramaTest, RejectsUnsupportedWidths)
+{
+    EXPECT_THROW(panorama::EquirectRemapper(0), std::runtime_error);
+    EXPECT_THROW(panorama::EquirectRemapper(1001), std::runtime_error);
+    EXPECT_THROW(panorama::EquirectRemapper(panorama::MAX_WIDTH + 2), std::runtime_error);
+    EXPECT_NO_THROW(panorama::EquirectRemapper(panorama::MAX_WIDTH));
+}
@@ -0,0 +1,218 @@
+#include <stb/stb_image_write.h>
+#include <stb/stb_image.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "background.h"
+#include "framebuffer.h"
+#include "mesh.h"
+#include "texture.h"
+#include "window.h"
+
+// Renders Mesh and Background at fixed poses into an offscreen framebuffer and compares the result
+// with the PNGs in test/golden/. Runs on a headless EGL context by default (SVM_GL_BACKEND
+// overrides it), so it works on CI machines with Mesa llvmpipe and no display.
+//
+// A test whose golden image is not in test/golden/ yet is skipped. To add one, or after an intended
+// rendering change, set SVM_UPDATE_GOLDEN=1 to write the current renders into SVM_GOLDEN_OUT_DIR in
+// the build tree instead of comparing, then copy the ones that look right into test/golden/.
+
+using namespace svm;
+
+namespace
+{
+constexpr int RENDER_WIDTH = 256;
+constexpr int RENDER_HEIGHT = 192;
+constexpr int TEX_WIDTH = 64;
+constexpr int TEX_HEIGHT = 48;
+
+// a pixel counts as different if any channel is off by more than this
+constexpr int CHANNEL_TOLERANCE = 16;
+// and the render fails if more than this fraction of pixels are different
+constexpr double MAX_DIFFERENT_FRACTION = 0.005;
+
+const std::shared_ptr<window::Window>& gl_window()
+{
+    static std::shared_ptr<window::Window> window(new window::Window(RENDER_WIDTH, RENDER_HEIGHT,
+        "render_golden_test", window::backend_from_env(window::ContextBackend::egl_headless)));
+    return window;
+}
+
+// Checkerboard over a color gradient, so misplaced geometry or texture coordinates show up
+std::shared_ptr<texture::Texture2D> test_texture()
+{
+    gl_window();
+    std::vector<unsigned char> pixels(TEX_WIDTH * TEX_HEIGHT * 3);
+    for (int y = 0; y < TEX_HEIGHT; ++y)
+    {
+        for (int x = 0; x < TEX_WIDTH; ++x)
+        {
+            const bool dark = ((x / 8) + (y / 8)) % 2 == 0;
+            unsigned char* px = &pixels[(y * TEX_WIDTH + x) * 3];
+            px[0] = static_cast<unsigned char>(x * 255 / TEX_WIDTH);
+            px[1] = static_cast<unsigned char>(y * 255 / TEX_HEIGHT);
+            px[2] = dark ? 64 : 192;
+        }
+    }
+    return std::shared_ptr<texture::Texture2D>(
+        texture::Texture2D::from_pixels(pixels.data(), TEX_WIDTH, TEX_HEIGHT, 3));
+}
+
+input::Event key_event(int key, int action)
+{
+    input::Event ev = {};
+    ev.type = input::EventType::key;
+    ev.code = key;
+    ev.action = action;
+    return ev;
+}
+
+input::Event cursor_event(double x, double y)
+{
+    input::Event ev = {};
+    ev.type = input::EventType::cursor_pos;
+    ev.x = x;
+    ev.y = y;
+    return ev;
+}
+
+class RenderGoldenTest: public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        window = gl_window();
+        window->events().clear();
+
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glLineWidth(1);
+
+        framebuffer.resize(RENDER_WIDTH, RENDER_HEIGHT);
+    }
+
+    // Draws one frame with `draw`, reports its time and compares it with the golden image
+    void render_and_compare(const std::string& name, const std::function<void()>& draw)
+    {
+        framebuffer.bind();
+        glViewport(0, 0, RENDER_WIDTH, RENDER_HEIGHT);
+        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        const auto start = std::chrono::steady_clock::now();
+        draw();
+        glFinish();
+        const double render_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        RecordProperty("render_ms", std::to_string(render_ms));
+        std::cout << "[  RENDER  ] " << name << ": " << render_ms << " ms" << std::endl;
+
+        std::vector<unsigned char> actual(RENDER_WIDTH * RENDER_HEIGHT * 4);
+        framebuffer.read_pixels(RENDER_WIDTH, RENDER_HEIGHT, actual.data());
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        const char* update = std::getenv("SVM_UPDATE_GOLDEN");
+        if (update && *update == '1')
+        {
+            const std::string out_path = std::string(SVM_GOLDEN_OUT_DIR) + "/" + name + ".png";
+            stbi_flip_vertically_on_write(true);
+            const int written = stbi_write_png(out_path.c_str(), RENDER_WIDTH, RENDER_HEIGHT, 4,
+                actual.data(), RENDER_WIDTH * 4);
+            stbi_flip_vertically_on_write(false);
+            ASSERT_TRUE(written) << "could not write " << out_path;
+            std::cout << "[  RENDER  ] wrote " << out_path << std::endl;
+            return;
+        }
+
+        const std::string golden_path = std::string(SVM_GOLDEN_DIR) + "/" + name + ".png";
+        int width = 0, height = 0, chans = 0;
+        stbi_set_flip_vertically_on_load(true);
+        unsigned char* golden = stbi_load(golden_path.c_str(), &width, &height, &chans, 4);
+        stbi_set_flip_vertically_on_load(false);
+        if (!golden)
+        {
+            GTEST_SKIP() << "no golden image " << golden_path
+                << "; run with SVM_UPDATE_GOLDEN=1 and copy it from " << SVM_GOLDEN_OUT_DIR;
+        }
+        std::unique_ptr<unsigned char, void(*)(void*)> golden_free(golden, stbi_image_free);
+
+        ASSERT_EQ(width, RENDER_WIDTH);
+        ASSERT_EQ(height, RENDER_HEIGHT);
+
+        int different = 0;
+        for (size_t i = 0; i < actual.size(); i += 4)
+        {
+            for (size_t c = 0; c < 4; ++c)
+            {
+                if (std::abs(static_cast<int>(actual[i + c]) - static_cast<int>(golden[i + c]))
+                    > CHANNEL_TOLERANCE)
+                {
+                    ++different;
+                    break;
+                }
+            }
+        }
+        const double different_fraction =
+            static_cast<double>(different) / (RENDER_WIDTH * RENDER_HEIGHT);
+        EXPECT_LE(different_fraction, MAX_DIFFERENT_FRACTION)
+            << different << " pixels differ from " << golden_path;
+    }
+
+    void render_background_pose(const std::string& name, const std::vector<input::Event>& events,
+        int frames)
+    {
+        background::Background bg(test_texture());
+        resolution::ResolutionParams params;
+        params.enabled = false;
+        bg.set_resolution_params(params);
+        bg.set_user_params(glm::vec2(0.3f, 0.7f), glm::vec2(0.7f, 0.35f), glm::vec2(0.52f, 0.48f),
+            54.0f);
+        bg.setup(window);
+
+        for (const input::Event& ev: events)
+        {
+            window->events().push(ev);
+        }
+        for (int i = 0; i < frames; ++i)
+        {
+            bg.process_input(window, 1);
+        }
+
+        render_and_compare(name, [&]() { bg.render(window, 1); });
+    }
+
+    std::shared_ptr<window::Window> window;
+    framebuffer::Framebuffer framebuffer;
+};
+} // anonymous namespace
+
+TEST_F(RenderGoldenTest, MeshDefaultHandles)
+{
+    mesh::Mesh mesh(test_texture());
+    mesh.setup(window);
+    render_and_compare("mesh_default", [&]() { mesh.render(window, 1); });
+}
+
+TEST_F(RenderGoldenTest, BackgroundAtVanishingPoint)
+{
+    render_background_pose("background_rest", {}, 1);
+}
+
+TEST_F(RenderGoldenTest, BackgroundMovedForward)
+{
+    render_background_pose("background_forward", { key_event(GLFW_KEY_W, GLFW_PRESS) }, 40);
+}
+
+TEST_F(RenderGoldenTest, BackgroundLookingLeftAndUp)
+{
+    render_background_pose("background_look",
+        { cursor_event(0, 0), cursor_event(-250, -120) }, 1);
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+#include "resolution.h"
+
+using namespace svm;
+
+namespace
+{
+resolution::ResolutionParams params_60hz()
+{
+    resolution::ResolutionParams params;
+    params.target_ms = 16.0;
+    params.min_scale = 0.5f;
+    params.max_scale = 1.0f;
+    params.hysteresis = 0.1f;
+    params.step_up = 0.05f;
+    return params;
+}
+} // anonymous namespace
+
+TEST(ResolutionTest, StartsAtFullScale)
+{
+    const resolution::ResolutionController controller(params_60hz());
+    EXPECT_FLOAT_EQ(controller.scale(), 1.0f);
+}
+
+TEST(ResolutionTest, ScalesDownInProportionToTheOvershoot)
+{
+    resolution::ResolutionController controller(params_60hz());
+    // four times the target in pixel cost is half the scale along each axis
+    EXPECT_NEAR(controller.update(64.0, true), 0.5f, 1e-5f);
+    // and never below min_scale
+    for (int i = 0; i < 10; ++i)
+    {
+        controller.update(500.0, true);
+    }
+    EXPECT_FLOAT_EQ(controller.scale(), 0.5f);
+}
+
+TEST(ResolutionTest, HoldsWithinTheHysteresisBand)
+{
+    resolution::ResolutionController controller(params_60hz());
+    controller.update(64.0, true);
+    const float scale = controller.scale();
+    for (int i = 0; i < 20; ++i)
+    {
+        controller.update(16.5, true);
+    }
+    EXPECT_FLOAT_EQ(controller.scale(), scale);
+}
+
+TEST(ResolutionTest, ClimbsBackWithHeadroomOrAtRest)
+{
+    resolution::ResolutionController controller(params_60hz());
+    controller.update(64.0, true);
+    // cheap frames while moving raise it a step at a time
+    for (int i = 0; i < 4; ++i)
+    {
+        controller.update(1.0, true);
+    }
+    EXPECT_NEAR(controller.scale(), 0.5f + 4 * 0.05f, 1e-5f);
+
+    // at rest it climbs however expensive frames are, up to max_scale
+    for (int i = 0; i < 20; ++i)
+    {
+        controller.update(100.0, false);
+    }
+    EXPECT_FLOAT_EQ(controller.scale(), 1.0f);
+}
+
+TEST(ResolutionTest, SetParamsClampsTheScale)
+{
+    resolution::ResolutionController controller(params_60hz());
+    resolution::ResolutionParams params = params_60hz();
+    params.max_scale = 0.75f;
+    controller.set_params(params);
+    EXPECT_FLOAT_EQ(controller.scale(), 0.75f);
+}
+
+TEST(ResolutionTest, RejectsAnEmptyScaleRange)
+{
+    resolution::ResolutionParams params = params_60hz();
+    params.min_scale = 0.8f;
+    params.max_scale = 0.6f;
+    EXPECT_THROW(resolution::ResolutionController controller(params), std::runtime_error);
+
+    resolution::ResolutionController controller(params_60hz());
+    EXPECT_THROW(controller.set_params(params), std::runtime_error);
+    EXPECT_FLOAT_EQ(controller.params().max_scale, 1.0f);
+
+    params.min_scale = 0.0f;
+    EXPECT_THROW(controller.set_params(params), std::runtime_error);
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <utility>
+
+#include "resource_registry.h"
+
+using namespace svm;
+
+namespace
+{
+resources::Registry& registry()
+{
+    return resources::Registry::instance();
+}
+} // anonymous namespace
+
+// The registry is process-wide and other tests book memory too, so these compare against what was
+// booked before they started
+TEST(ResourceRegistryTest, TrackedBooksItsLifetime)
+{
+    const resources::Usage before = registry().usage(resources::Kind::buffer);
+    const std::size_t gpu_before = registry().gpu_bytes();
+    const std::size_t host_before = registry().host_bytes();
+    {
+        resources::Tracked tracked(resources::Kind::buffer, 1000);
+        EXPECT_EQ(registry().usage(resources::Kind::buffer).count, before.count + 1);
+        EXPECT_EQ(registry().usage(resources::Kind::buffer).bytes, before.bytes + 1000);
+        EXPECT_EQ(registry().gpu_bytes(), gpu_before + 1000);
+        EXPECT_EQ(registry().host_bytes(), host_before);
+
+        tracked.resize(400);
+        EXPECT_EQ(registry().usage(resources::Kind::buffer).bytes, before.bytes + 400);
+        EXPECT_GE(registry().usage(resources::Kind::buffer).peak_bytes, before.bytes + 1000);
+
+        // moving hands the booking over rather than duplicating it
+        resources::Tracked moved(std::move(tracked));
+        EXPECT_EQ(registry().usage(resources::Kind::buffer).count, before.count + 1);
+        tracked.reset();
+        EXPECT_EQ(registry().usage(resources::Kind::buffer).bytes, before.bytes + 400);
+    }
+    EXPECT_EQ(registry().usage(resources::Kind::buffer).count, before.count);
+    EXPECT_EQ(registry().usage(resources::Kind::buffer).bytes, before.bytes);
+    EXPECT_EQ(registry().gpu_bytes(), gpu_before);
+}
+
+TEST(ResourceRegistryTest, HostImagesCountAsHostMemory)
+{
+    const std::size_t gpu_before = registry().gpu_bytes();
+    const std::size_t host_before = registry().host_bytes();
+    resources::Tracked tracked(resources::Kind::host_image, 300);
+    EXPECT_EQ(registry().host_bytes(), host_before + 300);
+    EXPECT_GE(registry().host_peak_bytes(), host_before + 300);
+    EXPECT_EQ(registry().gpu_bytes(), gpu_before);
+    EXPECT_FALSE(resources::is_gpu_kind(resources::Kind::host_image));
+    EXPECT_TRUE(resources::is_gpu_kind(resources::Kind::texture));
+}
+
+TEST(ResourceRegistryTest, TextureBytesIncludeTheMipChain)
+{
+    EXPECT_EQ(resources::texture_bytes(4, 2, 3, false), 24u);
+    // 4x2, 2x1, 1x1
+    EXPECT_EQ(resources::texture_bytes(4, 2, 3, true), 24u + 6u + 3u);
+    EXPECT_EQ(resources::texture_bytes(1, 1, 4, true), 4u);
+}
+
+TEST(ResourceRegistryTest, LogsOnlyWhenDue)
+{
+    std::ostringstream out;
+    registry().set_log_interval(0);
+    registry().log_if_due(1000.0, out);
+    EXPECT_TRUE(out.str().empty());
+
+    registry().set_log_interval(5);
+    registry().log_if_due(2000.0, out);
+    EXPECT_NE(out.str().find("memory:"), std::string::npos);
+    const std::size_t logged = out.str().size();
+    registry().log_if_due(2001.0, out);
+    EXPECT_EQ(out.str().size(), logged);
+    registry().log_if_due(2005.0, out);
+    EXPECT_GT(out.str().size(), logged);
+    registry().set_log_interval(0);
+}
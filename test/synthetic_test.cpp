@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "synthetic.h"
+
+using namespace svm;
+
+namespace
+{
+constexpr const int WIDTH = 150;
+constexpr const int HEIGHT = 100;
+
+synthetic::RoomParams small_room(std::uint32_t seed = 1)
+{
+    synthetic::RoomParams params;
+    params.width = WIDTH;
+    params.height = HEIGHT;
+    params.seed = seed;
+    return params;
+}
+
+std::vector<unsigned char> render(const synthetic::RoomParams& params)
+{
+    std::vector<unsigned char> rgb(static_cast<std::size_t>(params.width) * params.height * 3);
+    synthetic::RoomRenderer(params).render(rgb.data());
+    return rgb;
+}
+
+int luma(const std::vector<unsigned char>& rgb, int x, int row)
+{
+    const unsigned char* p = &rgb[(static_cast<std::size_t>(row) * WIDTH + x) * 3];
+    return p[0] + p[1] + p[2];
+}
+} // anonymous namespace
+
+TEST(SyntheticTest, SameSeedRendersTheSameImage)
+{
+    const std::vector<unsigned char> a = render(small_room(7));
+    EXPECT_EQ(a, render(small_room(7)));
+    EXPECT_NE(a, render(small_room(8)));
+
+    // any band renders the same on its own
+    const synthetic::RoomRenderer renderer(small_room(7));
+    std::vector<unsigned char> band(WIDTH * 10 * 3);
+    renderer.render_rows(band.data(), 40, 50);
+    EXPECT_TRUE(std::equal(band.begin(), band.end(), a.begin() + 40 * WIDTH * 3));
+}
+
+TEST(SyntheticTest, RearWallCornersAreEdges)
+{
+    const synthetic::RoomParams params = small_room();
+    const std::vector<unsigned char> rgb = render(params);
+
+    // across the rear wall's left edge, halfway up, the color changes from left wall to rear wall
+    const int row = HEIGHT - 1 - static_cast<int>((params.top_left.y + params.bot_right.y) / 2 * HEIGHT);
+    const int edge = static_cast<int>(params.top_left.x * WIDTH);
+    int outside = 0, inside = 0;
+    for (int dx = 2; dx < 6; ++dx)
+    {
+        outside += luma(rgb, edge - dx, row);
+        inside += luma(rgb, edge + dx, row);
+    }
+    EXPECT_GT(std::abs(outside - inside), 4 * 60);
+}
+
+TEST(SyntheticTest, CameraMatchesTheHandles)
+{
+    const synthetic::RoomParams params = small_room();
+    const depth::BoxModel box = synthetic::RoomRenderer(params).box();
+    // the vanishing point looks straight at the camera's foot on the rear wall
+    const float rear_width = box.rear_height * (params.bot_right.x - params.top_left.x) * 1.5f
+        / (params.top_left.y - params.bot_right.y);
+    EXPECT_NEAR(box.camera.x, rear_width * 0.5f, 1e-3f);
+    EXPECT_NEAR(box.camera.y, box.rear_height * 0.375f, 1e-3f);
+    EXPECT_GT(box.camera.z, 0.0f);
+}
+
+TEST(SyntheticTest, RandomRoomsAreValid)
+{
+    for (std::uint32_t seed = 0; seed < 50; ++seed)
+    {
+        const synthetic::RoomParams params = synthetic::random_room(seed, WIDTH, HEIGHT);
+        EXPECT_LT(params.top_left.x, params.vanishing.x);
+        EXPECT_LT(params.vanishing.x, params.bot_right.x);
+        EXPECT_LT(params.bot_right.y, params.vanishing.y);
+        EXPECT_LT(params.vanishing.y, params.top_left.y);
+        EXPECT_NO_THROW(synthetic::RoomRenderer renderer(params));
+    }
+}
+
+TEST(SyntheticTest, GroundTruthRoundTrips)
+{
+    const std::string path = testing::TempDir() + "svm_synthetic_truth.txt";
+    const synthetic::RoomParams params = synthetic::random_room(12, 4000, 3000);
+    synthetic::write_ground_truth(path.c_str(), params, "rooms/room 12.png");
+
+    std::string image_path;
+    const synthetic::RoomParams read = synthetic::read_ground_truth(path.c_str(), &image_path);
+    std::remove(path.c_str());
+
+    EXPECT_EQ(image_path, "rooms/room 12.png");
+    EXPECT_EQ(read.width, 4000);
+    EXPECT_EQ(read.height, 3000);
+    EXPECT_EQ(read.top_left, params.top_left);
+    EXPECT_EQ(read.bot_right, params.bot_right);
+    EXPECT_EQ(read.vanishing, params.vanishing);
+    EXPECT_EQ(read.fovy, params.fovy);
+    EXPECT_EQ(read.seed, 12u);
+}
@@ -0,0 +1,163 @@
+#include <cmath>
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "undistort.h"
+
+using namespace svm;
+
+namespace
+{
+constexpr const int SIZE = 256;
+
+// Red counts columns and green rows (bottom-up), so a pixel's color says where it was sampled
+std::vector<unsigned char> gradient(int num_channels)
+{
+    std::vector<unsigned char> pixels(SIZE * SIZE * num_channels);
+    for (int y = 0; y < SIZE; ++y)
+    {
+        for (int x = 0; x < SIZE; ++x)
+        {
+            unsigned char* p = &pixels[(y * SIZE + x) * num_channels];
+            p[0] = static_cast<unsigned char>(x);
+            p[1] = static_cast<unsigned char>(y);
+            p[2] = 128;
+            if (num_channels == 4)
+            {
+                p[3] = 255;
+            }
+        }
+    }
+    return pixels;
+}
+
+undistort::LensModel barrel()
+{
+    undistort::LensModel lens;
+    lens.k1 = -0.12f;
+    lens.k2 = 0.02f;
+    lens.p1 = 0.004f;
+    lens.p2 = -0.003f;
+    return lens;
+}
+} // anonymous namespace
+
+TEST(UndistortTest, IdentityLensCopiesTheImage)
+{
+    const std::vector<unsigned char> src = gradient(3);
+    std::vector<unsigned char> dst(src.size());
+    undistort::UndistortMap(undistort::LensModel(), SIZE, SIZE).apply(src.data(), dst.data(), 3);
+    EXPECT_EQ(src, dst);
+}
+
+TEST(UndistortTest, SamplesWhereTheModelSays)
+{
+    const undistort::LensModel lens = barrel();
+    const std::vector<unsigned char> src = gradient(3);
+    std::vector<unsigned char> dst(src.size());
+    undistort::UndistortMap(lens, SIZE, SIZE).apply(src.data(), dst.data(), 3);
+
+    const float radius = SIZE / std::sqrt(2.0f);
+    for (int y = 0; y < SIZE; y += 7)
+    {
+        for (int x = 0; x < SIZE; x += 7)
+        {
+            // the same model, written the way OpenCV documents it, with y down
+            const float xn = (x + 0.5f - SIZE / 2) / radius;
+            const float yn = (SIZE / 2 - y - 0.5f) / radius;
+            const float r2 = xn * xn + yn * yn;
+            const float radial = 1 + lens.k1 * r2 + lens.k2 * r2 * r2 + lens.k3 * r2 * r2 * r2;
+            const float xd = xn * radial + 2 * lens.p1 * xn * yn + lens.p2 * (r2 + 2 * xn * xn);
+            const float yd = yn * radial + lens.p1 * (r2 + 2 * yn * yn) + 2 * lens.p2 * xn * yn;
+            const float sx = xd * radius + SIZE / 2 - 0.5f;
+            const float sy = SIZE / 2 - 0.5f - yd * radius;
+            const unsigned char* p = &dst[(y * SIZE + x) * 3];
+            if (sx < 0 || sy < 0 || sx > SIZE - 1 || sy > SIZE - 1)
+            {
+                continue;
+            }
+            ASSERT_NEAR(p[0], sx, 1.0f) << x << ", " << y;
+            ASSERT_NEAR(p[1], sy, 1.0f) << x << ", " << y;
+            ASSERT_EQ(p[2], 128);
+        }
+    }
+    // correcting barrel distortion crops the photo's rim, so the corners are inside it
+    EXPECT_GT(dst[0], 0);
+    EXPECT_GT(dst[1], 0);
+}
+
+TEST(UndistortTest, PincushionCornersAreBlack)
+{
+    undistort::LensModel lens;
+    lens.k1 = 0.1f;
+    const std::vector<unsigned char> src = gradient(3);
+    std::vector<unsigned char> dst(src.size());
+    undistort::UndistortMap(lens, SIZE, SIZE).apply(src.data(), dst.data(), 3);
+
+    // correcting pincushion distortion pulls the corners in from outside the photo
+    EXPECT_EQ(dst[0], 0);
+    EXPECT_EQ(dst[2], 0);
+    EXPECT_EQ(dst[(SIZE * SIZE - 1) * 3 + 2], 0);
+    EXPECT_EQ(dst[((SIZE / 2) * SIZE + SIZE / 2) * 3 + 2], 128);
+}
+
+TEST(UndistortTest, ChannelsAndBandsDontChangeOutput)
+{
+    const undistort::UndistortMap map(barrel(), SIZE, SIZE);
+    const std::vector<unsigned char> rgb = gradient(3);
+    const std::vector<unsigned char> rgba = gradient(4);
+    std::vector<unsigned char> rgb_out(rgb.size());
+    std::vector<unsigned char> rgba_out(rgba.size());
+    std::vector<unsigned char> one_band(rgb.size());
+    map.apply(rgb.data(), rgb_out.data(), 3);
+    map.apply(rgba.data(), rgba_out.data(), 4);
+    map.apply(rgb.data(), one_band.data(), 3, 1);
+
+    EXPECT_EQ(rgb_out, one_band);
+    for (int i = 0; i < SIZE * SIZE; ++i)
+    {
+        ASSERT_EQ(rgb_out[i * 3], rgba_out[i * 4]);
+        ASSERT_EQ(rgb_out[i * 3 + 1], rgba_out[i * 4 + 1]);
+        ASSERT_EQ(rgb_out[i * 3 + 2], rgba_out[i * 4 + 2]);
+        ASSERT_EQ(rgba_out[i * 4 + 3], 255);
+    }
+}
+
+TEST(UndistortTest, UndistorterKeepsMapsPerSize)
+{
+    const undistort::Undistorter undistorter(barrel());
+    const auto full = undistorter.map_for(SIZE, SIZE);
+    EXPECT_EQ(full, undistorter.map_for(SIZE, SIZE));
+    EXPECT_NE(full, undistorter.map_for(SIZE / 2, SIZE / 2));
+
+    image::Image img;
+    const std::vector<unsigned char> src = gradient(3);
+    img.pixels = std::shared_ptr<unsigned char>(new unsigned char[src.size()], std::default_delete<unsigned char[]>());
+    std::copy(src.begin(), src.end(), img.pixels.get());
+    img.width = SIZE;
+    img.height = SIZE;
+    img.num_channels = 3;
+    img.scale_denom = 2;
+    const image::Image corrected = undistorter.apply(img);
+    EXPECT_EQ(corrected.width, SIZE);
+    EXPECT_EQ(corrected.height, SIZE);
+    EXPECT_EQ(corrected.scale_denom, 2);
+}
+
+TEST(UndistortTest, ParsesCoefficientLists)
+{
+    undistort::LensModel lens;
+    ASSERT_TRUE(undistort::parse_lens("-0.1,0.02", lens));
+    EXPECT_FLOAT_EQ(lens.k1, -0.1f);
+    EXPECT_FLOAT_EQ(lens.k2, 0.02f);
+    EXPECT_EQ(lens.k3, 0.0f);
+    ASSERT_TRUE(undistort::parse_lens("0.1,0,0.001,-0.002,0.003", lens));
+    EXPECT_FLOAT_EQ(lens.p2, 0.003f);
+
+    EXPECT_FALSE(undistort::parse_lens("", lens));
+    EXPECT_FALSE(undistort::parse_lens("0.1,", lens));
+    EXPECT_FALSE(undistort::parse_lens("0.1;0.2", lens));
+    EXPECT_FALSE(undistort::parse_lens("1,2,3,4,5,6", lens));
+    // failures leave the lens alone
+    EXPECT_FLOAT_EQ(lens.p2, 0.003f);
+}
@@ -0,0 +1,130 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "synthetic.h"
+
+using namespace svm;
+
+static constexpr const char* const USAGE =
+    "usage: svm_synth_room [--size <W> <H> | --megapixels <N>] [--seed <N>] "
+    "[--count <N> | [--rear <LEFT> <TOP> <RIGHT> <BOTTOM>] [--vanishing <X> <Y>] [--fovy <DEGREES>]] <OUT>";
+
+struct Options
+{
+    synthetic::RoomParams room;
+    int count = 0;
+    const char* out_path = nullptr;
+};
+
+bool parse_options(int argc, const char* argv[], Options& opts)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 2 < argc)
+        {
+            opts.room.width = std::atoi(argv[++i]);
+            opts.room.height = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--megapixels") == 0 && i + 1 < argc)
+        {
+            // 3:2, like most cameras
+            const double pixels = std::atof(argv[++i]) * 1e6;
+            opts.room.height = static_cast<int>(std::sqrt(pixels * 2 / 3));
+            opts.room.width = opts.room.height * 3 / 2;
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            opts.room.seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+        {
+            opts.count = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--rear") == 0 && i + 4 < argc)
+        {
+            opts.room.top_left.x = static_cast<float>(std::atof(argv[++i]));
+            opts.room.top_left.y = static_cast<float>(std::atof(argv[++i]));
+            opts.room.bot_right.x = static_cast<float>(std::atof(argv[++i]));
+            opts.room.bot_right.y = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--vanishing") == 0 && i + 2 < argc)
+        {
+            opts.room.vanishing.x = static_cast<float>(std::atof(argv[++i]));
+            opts.room.vanishing.y = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--fovy") == 0 && i + 1 < argc)
+        {
+            opts.room.fovy = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (argv[i][0] != '-' && !opts.out_path)
+        {
+            opts.out_path = argv[i];
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return opts.out_path && opts.room.width > 0 && opts.room.height > 0 && opts.count >= 0;
+}
+
+// room.png -> room-0003.png, and its ground truth room-0003.txt
+std::string numbered_path(const std::string& path, int index, const char* new_extension)
+{
+    const std::size_t dot = path.find_last_of('.');
+    const std::size_t slash = path.find_last_of('/');
+    const bool has_extension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+    const std::string stem = has_extension ? path.substr(0, dot) : path;
+    const std::string extension = new_extension ? new_extension : (has_extension ? path.substr(dot) : "");
+
+    std::string res = stem;
+    if (index >= 0)
+    {
+        char suffix[16];
+        std::snprintf(suffix, sizeof(suffix), "-%04d", index);
+        res += suffix;
+    }
+    return res + extension;
+}
+
+int main(int argc, const char* argv[])
+{
+    Options opts;
+    if (!parse_options(argc, argv, opts))
+    {
+        std::cerr << "Invalid usage: " << USAGE << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        // --count draws every room from its own seed; otherwise the one room is as given
+        const int num_rooms = (opts.count > 0) ? opts.count : 1;
+        for (int i = 0; i < num_rooms; ++i)
+        {
+            const synthetic::RoomParams room = (opts.count > 0)
+                ? synthetic::random_room(opts.room.seed + i, opts.room.width, opts.room.height)
+                : opts.room;
+            const int index = (opts.count > 0) ? i : -1;
+            const std::string image_path = numbered_path(opts.out_path, index, nullptr);
+            const std::string truth_path = numbered_path(opts.out_path, index, ".txt");
+
+            const auto start = std::chrono::steady_clock::now();
+            synthetic::write_room(room, image_path.c_str(), truth_path.c_str());
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << "wrote " << image_path << " (" << room.width << "x" << room.height << ") and "
+                << truth_path << " in " << elapsed.count() << " s" << std::endl;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}